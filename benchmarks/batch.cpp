@@ -0,0 +1,119 @@
+#include "bench.hpp"
+
+#include "dsm/dsm.hpp"
+
+#include <string>
+#include <vector>
+
+/**
+ * Compares processing batches of small events through processEvents with calling processEvent on each one of them:
+ * - loop: processEvent called on each event of the batch
+ * - batch: processEvents called on the batch of events
+ * - batch (type-erased): processEvents called on a batch of pointers to events of several types, as decoded from a network frame
+ * - instance: same as loop and batch on an instance of a shared topology, which is bound once per call
+ * size is the number of events per batch
+ */
+
+using namespace dsm;
+
+struct sample : Event<sample>
+{
+    std::uint32_t value = 1;
+};
+
+struct heartbeat : Event<heartbeat> {};
+
+struct ingest_sm : StateMachine<ingest_sm> {};
+
+struct ingesting : State<ingesting, ingest_sm>
+{
+    std::uint64_t sum = 0;
+    std::uint64_t beats = 0;
+
+    void onSample(const sample& evt) { sum += evt.value; }
+    void onHeartbeat(const heartbeat&) { ++beats; }
+};
+
+void Build(ingest_sm& sm)
+{
+    sm.addState<ingesting, Entry>();
+    sm.addTransition<ingesting, sample, ingesting, &ingesting::onSample>();
+    sm.addTransition<ingesting, heartbeat, ingesting, &ingesting::onHeartbeat>();
+}
+
+template <typename StepType>
+void RunBatch(const std::string& name, std::size_t size, const bench::Options& options, StepType&& step)
+{
+    ingest_sm sm;
+    Build(sm);
+    sm.start();
+
+    bench::Run(name, size, options, [&]() {
+        return step(sm);
+    });
+
+    bench::DoNotOptimize(sm.getState<ingesting>()->sum);
+}
+
+template <typename StepType>
+void RunInstance(const std::string& name, std::size_t size, const bench::Options& options, StepType&& step)
+{
+    ingest_sm topology;
+    Build(topology);
+
+    ingest_sm::Instance instance{ topology };
+    instance.start();
+
+    bench::Run(name, size, options, [&]() {
+        return step(instance);
+    });
+}
+
+int main(int argc, char** argv)
+{
+    const auto options = bench::ParseOptions(argc, argv);
+
+    bench::PrintHeader();
+
+    for (std::size_t size : { 64, 256, 1024 })
+    {
+        const std::vector<sample> samples(size);
+
+        // One heartbeat every 16 samples
+        const heartbeat beat;
+        std::vector<const EventBase*> frame;
+        for (std::size_t i = 0; i < size; ++i) frame.push_back((0 == i % 16) ? static_cast<const EventBase*>(&beat) : &samples[i]);
+
+        RunBatch("loop", size, options, [&samples](ingest_sm& sm) {
+            for (const auto& evt : samples) sm.processEvent(evt);
+            return samples.size();
+        });
+
+        RunBatch("batch", size, options, [&samples](ingest_sm& sm) {
+            sm.processEvents(samples);
+            return samples.size();
+        });
+
+        RunBatch("loop (type-erased)", size, options, [&frame](ingest_sm& sm) {
+            for (auto evt : frame) sm.processEvent(*evt);
+            return frame.size();
+        });
+
+        RunBatch("batch (type-erased)", size, options, [&frame](ingest_sm& sm) {
+            sm.processEvents(frame);
+            return frame.size();
+        });
+
+        RunInstance("instance loop", size, options, [&samples](ingest_sm::Instance& instance) {
+            for (const auto& evt : samples) instance.processEvent(evt);
+            return samples.size();
+        });
+
+        RunInstance("instance batch", size, options, [&samples](ingest_sm::Instance& instance) {
+            instance.processEvents(samples);
+            return samples.size();
+        });
+    }
+
+    return 0;
+}
@@ -0,0 +1,202 @@
+#ifndef DSM_BENCHMARK_INCLUDED_
+#define DSM_BENCHMARK_INCLUDED_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+/**
+ * Minimal benchmarking harness shared by all benchmark executables.
+ *
+ * This header replaces the global allocation functions in order to count heap allocations,
+ * hence it must be included by exactly one translation unit per executable.
+ */
+
+namespace bench
+{
+    /**
+     * @brief   Allocations
+     * @details Process-wide heap allocations counter
+     */
+    inline std::atomic<std::uint64_t>& Allocations()
+    {
+        static std::atomic<std::uint64_t> counter{ 0 };
+        return counter;
+    }
+
+    /**
+     * @brief   DoNotOptimize
+     * @details Prevents the compiler from discarding the computation of the provided value
+     */
+    template <typename Type>
+    inline void DoNotOptimize(const Type& value)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile const void* sink;
+        sink = &value;
+#endif
+    }
+
+    /**
+     * @brief   Result
+     * @details Measures of a single benchmark run
+     */
+    struct Result
+    {
+        std::string name;
+        std::size_t size = 0;
+        double nsPerEvent = 0.0;
+        double allocsPerEvent = 0.0;
+        std::uint64_t p50 = 0;
+        std::uint64_t p99 = 0;
+        std::uint64_t p999 = 0;
+    };
+
+    /**
+     * @brief   Options
+     * @details Run options, common to all benchmarks of an executable
+     */
+    struct Options
+    {
+        std::size_t events = 200000;
+        std::size_t warmup = 10000;
+    };
+
+    inline Options ParseOptions(int argc, char** argv)
+    {
+        Options options;
+        if (argc > 1) options.events = std::max<std::size_t>(1, std::strtoull(argv[1], nullptr, 10));
+        options.warmup = std::max<std::size_t>(1, options.events / 20);
+        return options;
+    }
+
+    inline void PrintHeader()
+    {
+        std::printf("%-32s %8s %12s %14s %10s %10s %10s\n", "benchmark", "size", "ns/event", "allocs/event", "p50(ns)", "p99(ns)", "p999(ns)");
+    }
+
+    inline void Print(const Result& result)
+    {
+        std::printf("%-32s %8zu %12.1f %14.2f %10llu %10llu %10llu\n",
+            result.name.c_str(), result.size, result.nsPerEvent, result.allocsPerEvent,
+            static_cast<unsigned long long>(result.p50), static_cast<unsigned long long>(result.p99), static_cast<unsigned long long>(result.p999));
+        std::fflush(stdout);
+    }
+
+    /**
+     * @brief       Run
+     * @param[in]   name: benchmark's name
+     * @param[in]   size: topology size, for reporting purpose only
+     * @param[in]   options: run options
+     * @param[in]   step: callable performing one step. It returns the number of events it processed
+     * @details     Runs the provided step in two passes:
+     *              - a throughput pass, without any per-step timing, giving ns/event and allocations/event
+     *              - a latency pass, timing each step individually, giving the percentiles
+     * @return      The benchmark's result
+     */
+    template <typename StepType>
+    Result Run(const std::string& name, std::size_t size, const Options& options, StepType&& step)
+    {
+        using Clock = std::chrono::steady_clock;
+
+        Result result;
+        result.name = name;
+        result.size = size;
+
+        for (std::size_t i = 0; i < options.warmup; ++i) step();
+
+        // Throughput pass
+        std::size_t events = 0;
+        const auto allocsBefore = Allocations().load(std::memory_order_relaxed);
+        const auto start = Clock::now();
+        while (events < options.events) events += step();
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+        const auto allocs = Allocations().load(std::memory_order_relaxed) - allocsBefore;
+
+        result.nsPerEvent = static_cast<double>(elapsed) / static_cast<double>(events);
+        result.allocsPerEvent = static_cast<double>(allocs) / static_cast<double>(events);
+
+        // Latency pass, over as many events as the throughput pass
+        std::vector<std::uint64_t> samples;
+        samples.reserve(options.events);
+        for (events = 0; events < options.events;)
+        {
+            const auto before = Clock::now();
+            const auto count = step();
+            const auto after = Clock::now();
+            const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(after - before).count();
+            samples.push_back(static_cast<std::uint64_t>(ns) / std::max<std::size_t>(1, count));
+            events += std::max<std::size_t>(1, count);
+        }
+
+        std::sort(samples.begin(), samples.end());
+        auto percentile = [&samples](double p) { return samples[std::min(samples.size() - 1, static_cast<std::size_t>(p * static_cast<double>(samples.size())))]; };
+        result.p50 = percentile(0.50);
+        result.p99 = percentile(0.99);
+        result.p999 = percentile(0.999);
+
+        Print(result);
+
+        return result;
+    }
+}
+
+void* operator new(std::size_t size)
+{
+    bench::Allocations().fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    bench::Allocations().fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) return ptr;
+    throw std::bad_alloc();
+}
+
+#if !defined(_MSC_VER)
+// std::aligned_alloc memory is released with std::free, which MSVC does not support
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    bench::Allocations().fetch_add(1, std::memory_order_relaxed);
+    const auto align = static_cast<std::size_t>(alignment);
+    if (void* ptr = std::aligned_alloc(align, (std::max<std::size_t>(size, 1) + align - 1) / align * align)) return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+#endif
+
+// The replacements pair with the operator new above, which GCC cannot tell once they are inlined
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+#if !defined(_MSC_VER)
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+#endif
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+#endif
@@ -0,0 +1,175 @@
+#include "bench.hpp"
+
+#include "dsm/dsm.hpp"
+#include "dsm/executor.hpp"
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/**
+ * Measures the scaling of an Executor with its number of workers. Many state machines, each one with its own strand, pass hops
+ * around a ring: each hop does some work, then is posted to the next state machine until it runs out. The main thread only seeds
+ * one hop per state machine, then waits for all of them.
+ * Then measures events posted from outside the executor, as by a network thread: the main thread posts every event itself,
+ * round after round, the tasks released by the workers being recycled back to it
+ */
+
+using namespace dsm;
+
+struct hop : Event<hop>
+{
+    explicit hop(std::size_t remaining) : remaining{ remaining } {}
+
+    std::size_t remaining;
+};
+
+struct ring_sm;
+
+struct RingStore
+{
+    ring_sm* next = nullptr;
+    Strand* nextStrand = nullptr;
+    std::uint64_t work = 0;
+};
+
+struct ring_sm : StateMachine<ring_sm, RingStore> {};
+
+struct relay : State<relay, ring_sm>
+{
+    void onHop(const hop& evt)
+    {
+        // Some work per event
+        auto value = this->store()->work + evt.remaining;
+        for (int i = 0; i < 256; ++i) value ^= (value << 13) ^ (value >> 7) ^ (value << 17);
+        this->store()->work = value;
+
+        if (evt.remaining > 0) this->store()->nextStrand->postEvent(*this->store()->next, hop{ evt.remaining - 1 });
+    }
+};
+
+/**
+ * Runs Hops hops from each of Machines state machines on an executor with the provided number of workers
+ * @return  Returns the mean time per event, in nanoseconds
+ */
+double RunRing(std::size_t workers, std::size_t machineCount, std::size_t hops, double reference)
+{
+    using Clock = std::chrono::steady_clock;
+
+    Executor executor{ workers };
+
+    std::vector<std::unique_ptr<ring_sm>> machines;
+    std::vector<std::unique_ptr<Strand>> strands;
+    for (std::size_t i = 0; i < machineCount; ++i)
+    {
+        machines.push_back(std::make_unique<ring_sm>());
+        machines.back()->addState<relay, Entry>();
+        machines.back()->addTransition<relay, hop, relay, &relay::onHop>();
+        machines.back()->start();
+        strands.push_back(std::make_unique<Strand>(executor));
+    }
+
+    for (std::size_t i = 0; i < machineCount; ++i)
+    {
+        machines[i]->store()->next = machines[(i + 1) % machineCount].get();
+        machines[i]->store()->nextStrand = strands[(i + 1) % machineCount].get();
+    }
+
+    executor.resetMetrics();
+    const auto start = Clock::now();
+
+    for (std::size_t i = 0; i < machineCount; ++i) strands[i]->postEvent(*machines[i], hop{ hops });
+    executor.wait();
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    const auto events = machineCount * (hops + 1);
+    const double nsPerEvent = static_cast<double>(elapsed) / static_cast<double>(events);
+
+    double utilization = 0.0;
+    std::uint64_t latency = 0;
+    std::uint64_t maxLatency = 0;
+    std::uint64_t steals = 0;
+    const auto metrics = executor.metrics();
+    for (const auto& worker : metrics)
+    {
+        utilization += worker.utilization;
+        latency += worker.meanLatency;
+        maxLatency = std::max(maxLatency, worker.maxLatency);
+        steals += worker.steals;
+    }
+
+    std::printf("%-10zu %10zu %12.1f %10.2f %14.2f %14llu %14llu %10llu\n", workers, machineCount, nsPerEvent,
+        (reference > 0.0) ? reference / nsPerEvent : 1.0, utilization / static_cast<double>(metrics.size()),
+        static_cast<unsigned long long>(latency / metrics.size()), static_cast<unsigned long long>(maxLatency), static_cast<unsigned long long>(steals));
+    std::fflush(stdout);
+
+    std::uint64_t checksum = 0;
+    for (const auto& machine : machines) checksum += machine->store()->work;
+    bench::DoNotOptimize(checksum);
+
+    return nsPerEvent;
+}
+
+/**
+ * Posts events from the calling thread, outside the executor, to state machines doing their work without posting any further
+ */
+void RunExternal(std::size_t workers, std::size_t machineCount, std::size_t rounds, std::size_t events)
+{
+    using Clock = std::chrono::steady_clock;
+
+    Executor executor{ workers };
+
+    std::vector<std::unique_ptr<ring_sm>> machines;
+    std::vector<std::unique_ptr<Strand>> strands;
+    for (std::size_t i = 0; i < machineCount; ++i)
+    {
+        machines.push_back(std::make_unique<ring_sm>());
+        machines.back()->addState<relay, Entry>();
+        machines.back()->addTransition<relay, hop, relay, &relay::onHop>();
+        machines.back()->start();
+        strands.push_back(std::make_unique<Strand>(executor));
+    }
+
+    for (std::size_t round = 0; round < rounds; ++round)
+    {
+        const auto allocsBefore = bench::Allocations().load(std::memory_order_relaxed);
+        const auto start = Clock::now();
+
+        for (std::size_t i = 0; i < events; ++i) strands[i % machineCount]->postEvent(*machines[i % machineCount], hop{ 0 });
+        executor.wait();
+
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+        const auto allocs = bench::Allocations().load(std::memory_order_relaxed) - allocsBefore;
+
+        std::printf("%-10zu %10zu %10zu %12.1f %14.2f\n", workers, machineCount, round,
+            static_cast<double>(elapsed) / static_cast<double>(events), static_cast<double>(allocs) / static_cast<double>(events));
+        std::fflush(stdout);
+    }
+
+    std::uint64_t checksum = 0;
+    for (const auto& machine : machines) checksum += machine->store()->work;
+    bench::DoNotOptimize(checksum);
+}
+
+int main(int argc, char** argv)
+{
+    const auto options = bench::ParseOptions(argc, argv);
+
+    const std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    const std::size_t machineCount = 10000;
+    const std::size_t hops = std::max<std::size_t>(1, options.events / machineCount);
+
+    std::printf("%zu hardware threads available\n", cores);
+    std::printf("%-10s %10s %12s %10s %14s %14s %14s %10s\n", "workers", "machines", "ns/event", "speedup", "utilization", "latency(ns)", "max lat.(ns)", "steals");
+
+    const double reference = RunRing(1, machineCount, hops, 0.0);
+    for (std::size_t workers = 2; workers <= cores; workers *= 2) RunRing(workers, machineCount, hops, reference);
+    if (0 != (cores & (cores - 1))) RunRing(cores, machineCount, hops, reference);
+
+    std::printf("\nexternal producer\n");
+    std::printf("%-10s %10s %10s %12s %14s\n", "workers", "machines", "round", "ns/event", "allocs/event");
+    RunExternal(cores, 100, 5, options.events);
+
+    return 0;
+}
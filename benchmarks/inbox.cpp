@@ -0,0 +1,149 @@
+#include "bench.hpp"
+
+#include "dsm/dsm.hpp"
+#include "dsm/inbox.hpp"
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Measures event ingress from several producer threads into a single state machine:
+ * - mutex: each producer locks a mutex wrapping the state machine, then processes its event
+ * - inbox: each producer posts its event into an Inbox, drained by the owning thread, either sleeping or busy polling when empty
+ * ns/event is the wall time per event, allocations included. Percentiles are the producers' call latencies
+ */
+
+using namespace dsm;
+
+struct tick : Event<tick> {};
+
+struct counter_sm : StateMachine<counter_sm> {};
+
+struct counter : State<counter, counter_sm>
+{
+    std::uint64_t count = 0;
+
+    void onTick(const tick&) { ++count; }
+};
+
+void Build(counter_sm& sm)
+{
+    sm.addState<counter, Entry>();
+    sm.addTransition<counter, tick, counter, &counter::onTick>();
+    sm.start();
+}
+
+/**
+ * Runs Producers threads calling post, each one options.events / Producers times, while the calling thread runs consume
+ */
+template <typename PostType, typename ConsumeType>
+void RunContention(const std::string& name, std::size_t producers, const bench::Options& options, PostType&& post, ConsumeType&& consume)
+{
+    using Clock = std::chrono::steady_clock;
+
+    const std::size_t perProducer = std::max<std::size_t>(1, options.events / producers);
+
+    bench::Result result;
+    result.name = name;
+    result.size = producers;
+
+    std::vector<std::vector<std::uint64_t>> samples(producers);
+    for (auto& producerSamples : samples) producerSamples.reserve(perProducer);
+
+    std::atomic<std::size_t> ready{ 0 };
+    std::vector<std::thread> threads;
+
+    const auto allocsBefore = bench::Allocations().load(std::memory_order_relaxed);
+    const auto start = Clock::now();
+
+    for (std::size_t producer = 0; producer < producers; ++producer)
+    {
+        threads.emplace_back([&, producer]() {
+            ready.fetch_add(1);
+            while (ready.load() < producers) std::this_thread::yield();
+
+            for (std::size_t i = 0; i < perProducer; ++i)
+            {
+                const auto before = Clock::now();
+                post();
+                samples[producer].push_back(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - before).count()));
+            }
+        });
+    }
+
+    consume(threads);
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    const auto allocs = bench::Allocations().load(std::memory_order_relaxed) - allocsBefore;
+    const auto events = perProducer * producers;
+
+    std::vector<std::uint64_t> all;
+    all.reserve(events);
+    for (const auto& producerSamples : samples) all.insert(all.end(), producerSamples.begin(), producerSamples.end());
+    std::sort(all.begin(), all.end());
+    auto percentile = [&all](double p) { return all[std::min(all.size() - 1, static_cast<std::size_t>(p * static_cast<double>(all.size())))]; };
+
+    result.nsPerEvent = static_cast<double>(elapsed) / static_cast<double>(events);
+    result.allocsPerEvent = static_cast<double>(allocs) / static_cast<double>(events);
+    result.p50 = percentile(0.50);
+    result.p99 = percentile(0.99);
+    result.p999 = percentile(0.999);
+
+    bench::Print(result);
+}
+
+void RunMutex(std::size_t producers, const bench::Options& options)
+{
+    counter_sm sm;
+    Build(sm);
+    std::mutex mutex;
+
+    RunContention("mutex", producers, options,
+        [&]() {
+            std::lock_guard<std::mutex> lock{ mutex };
+            sm.processEvent(tick{});
+        },
+        [](std::vector<std::thread>& threads) {
+            for (auto& thread : threads) thread.join();
+        });
+}
+
+void RunInbox(const std::string& name, std::size_t producers, WaitPolicy policy, const bench::Options& options)
+{
+    counter_sm sm;
+    Build(sm);
+    Inbox<counter_sm> inbox{ sm, Inbox<counter_sm>::DefaultCapacity, policy };
+
+    RunContention(name, producers, options,
+        [&]() {
+            inbox.postEvent(tick{});
+        },
+        [&](std::vector<std::thread>& threads) {
+            std::thread stopper{ [&]() {
+                for (auto& thread : threads) thread.join();
+                inbox.stop();
+            } };
+            inbox.run();
+            stopper.join();
+        });
+}
+
+int main(int argc, char** argv)
+{
+    const auto options = bench::ParseOptions(argc, argv);
+
+    std::printf("size is the number of producer threads, %u hardware threads available\n", std::thread::hardware_concurrency());
+    bench::PrintHeader();
+
+    for (std::size_t producers : { 1, 2, 4, 8 })
+    {
+        RunMutex(producers, options);
+        RunInbox("inbox (block)", producers, WaitPolicy::Block, options);
+        RunInbox("inbox (busy poll)", producers, WaitPolicy::BusyPoll, options);
+    }
+
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include "bench.hpp"
+
+#include "dsm/dsm.hpp"
+
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Measures processEvent on a large topology whose memory is spread across the heap, as in a long running process:
+ * - warm: a single state machine, whose topology stays in cache
+ * - cold: many state machines built in lockstep, hence interleaved in memory, processed in turn so that each one is evicted from cache
+ * Hardware cache misses per event are reported when the platform exposes performance counters
+ */
+
+using namespace dsm;
+
+struct tick : Event<tick> {};
+
+template <typename SmType, std::size_t Index>
+struct node : State<node<SmType, Index>, SmType>
+{
+    void onTick(const tick&) {}
+};
+
+/**
+ * Comb topology: a composite root with Regions orthogonal regions, each one holding a chain of Depth composite states
+ * whose innermost state handles tick through an internal transition. Each tick walks down every chain
+ */
+template <std::size_t Regions, std::size_t Depth>
+struct comb_sm : StateMachine<comb_sm<Regions, Depth>>
+{
+    static constexpr std::size_t Chains = Regions * Depth;
+    static constexpr std::size_t States = 1 + Chains;
+
+    template <std::size_t Region, std::size_t Level>
+    using chain_t = node<comb_sm, 1 + Region * Depth + Level>;
+
+    using root_t = node<comb_sm, 0>;
+
+    /**
+     * Adds the Ith state of the topology
+     */
+    template <std::size_t I>
+    void add()
+    {
+        constexpr std::size_t region = I / Depth;
+        constexpr std::size_t level = I % Depth;
+
+        if constexpr (0 == level) this->template addState<root_t, chain_t<region, 0>, static_cast<int>(region), Entry>();
+        else this->template addState<chain_t<region, level - 1>, chain_t<region, level>, Entry>();
+
+        if constexpr (Depth - 1 == level) this->template addTransition<chain_t<region, level>, tick, chain_t<region, level>, &chain_t<region, level>::onTick>();
+    }
+};
+
+/**
+ * Builds the provided state machines in lockstep, one state at a time for all of them
+ */
+template <typename SmType, std::size_t ...Is>
+void BuildInterleaved(std::vector<std::unique_ptr<SmType>>& machines, std::index_sequence<Is...>)
+{
+    for (auto& sm : machines) sm->template addState<typename SmType::root_t, Entry>();
+    ((std::for_each(machines.begin(), machines.end(), [](auto& sm) { sm->template add<Is>(); })), ...);
+    for (auto& sm : machines) sm->start();
+}
+
+/**
+ * @brief   CacheMisses
+ * @details Hardware cache misses counter of the calling thread, if available
+ */
+class CacheMisses
+{
+public:
+    CacheMisses()
+    {
+#if defined(__linux__)
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        m_fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+
+    ~CacheMisses()
+    {
+#if defined(__linux__)
+        if (m_fd >= 0) close(m_fd);
+#endif
+    }
+
+    bool available() const
+    {
+        return m_fd >= 0;
+    }
+
+    template <typename StepType>
+    double perEvent(std::size_t events, StepType&& step)
+    {
+        std::uint64_t count = 0;
+        std::size_t processed = 0;
+
+#if defined(__linux__)
+        ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+        while (processed < events) processed += step();
+        ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (sizeof(count) != read(m_fd, &count, sizeof(count))) count = 0;
+#endif
+
+        return static_cast<double>(count) / static_cast<double>(std::max<std::size_t>(1, processed));
+    }
+
+private:
+    int m_fd = -1;
+};
+
+template <typename SmType>
+void RunComb(const char* name, std::size_t instances, CacheMisses& misses, const bench::Options& options)
+{
+    std::vector<std::unique_ptr<SmType>> machines;
+    for (std::size_t i = 0; i < instances; ++i) machines.push_back(std::make_unique<SmType>());
+    BuildInterleaved(machines, std::make_index_sequence<SmType::Chains>{});
+
+    std::size_t next = 0;
+    auto step = [&machines, &next]() {
+        machines[next]->processEvent(tick{});
+        if (++next == machines.size()) next = 0;
+        return 1;
+    };
+
+    bench::Run(name, SmType::States, options, step);
+
+    if (true == misses.available()) std::printf("%-32s %8zu %12.1f cache misses/event\n", name, SmType::States, misses.perEvent(options.events, step));
+}
+
+int main(int argc, char** argv)
+{
+    const auto options = bench::ParseOptions(argc, argv);
+
+    CacheMisses misses;
+    if (false == misses.available()) std::printf("Hardware cache counters unavailable, cache misses are not reported\n");
+
+    bench::PrintHeader();
+
+    RunComb<comb_sm<8, 12>>("comb (warm)", 1, misses, options);
+    RunComb<comb_sm<8, 12>>("comb (cold, 1024 sm)", 1024, misses, options);
+
+    RunComb<comb_sm<16, 16>>("comb (warm)", 1, misses, options);
+    RunComb<comb_sm<16, 16>>("comb (cold, 256 sm)", 256, misses, options);
+
+    return 0;
+}
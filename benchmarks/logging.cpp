@@ -0,0 +1,152 @@
+#include "bench.hpp"
+
+#define DSM_LOGGER Log::ConsoleLogger
+#define DSM_LOG_LEVEL Log::eInfo
+
+#include "dsm/dsm.hpp"
+#include "dsm/async_logger.hpp"
+#include "dsm/binary_tracer.hpp"
+
+using namespace dsm;
+
+/**
+ * Sink that only accumulates the size of the records it receives
+ */
+struct CountingSink : Log::ILogger
+{
+    std::size_t bytes = 0;
+
+    void writeLog(std::string_view module, Log::LogLevel level, std::string_view msg) override
+    {
+        bytes += module.size() + msg.size();
+    }
+};
+
+struct tick : Event<tick> {};
+
+/**
+ * Busy work of about a couple of microseconds, spacing records out as in a program doing actual work between them
+ */
+inline void Gap()
+{
+    for (int i = 0; i < 2000; ++i) bench::DoNotOptimize(i);
+}
+
+/**
+ * Prints the cost per record of a spaced out benchmark, the gap alone being subtracted
+ */
+inline void PrintSpaced(const bench::Result& spaced, const bench::Result& gap)
+{
+    std::printf("%s: %.1f ns/record over the gap\n", spaced.name.c_str(), spaced.nsPerEvent - gap.nsPerEvent);
+}
+
+int main(int argc, char** argv)
+{
+    const auto options = bench::ParseOptions(argc, argv);
+
+    using Logger = Log::Logger<DSM_LOGGER>;
+
+    CountingSink sink;
+    Logger::SetSink(&sink);
+
+    const std::string state = "some_state";
+    const tick evt;
+    int value = 42;
+
+    bench::PrintHeader();
+
+    std::vector<bench::Result> results;
+
+    // Below DSM_LOG_LEVEL: compiled out
+    results.push_back(bench::Run("disabled (compile-time)", 1, options, [&]() {
+        LOG_DEBUG_DSM("Entering state " << state << " through event " << evt.name() << " " << value);
+        return 1;
+    }));
+
+    Logger::SetLevel(Log::eOff);
+
+    // Discarded by the runtime level check
+    results.push_back(bench::Run("disabled (runtime)", 1, options, [&]() {
+        LOG_INFO_DSM("Entering state " << state << " through event " << evt.name() << " " << value);
+        return 1;
+    }));
+
+    Logger::SetLevel(Log::eInfo);
+
+    // Formatted and written to the sink
+    results.push_back(bench::Run("enabled", 1, options, [&]() {
+        LOG_INFO_DSM("Entering state " << state << " through event " << evt.name() << " " << value);
+        return 1;
+    }));
+
+    // Busy work alone, the baseline of the spaced out benchmarks
+    const auto gap = bench::Run("gap", 1, options, [&]() {
+        Gap();
+        return 1;
+    });
+    results.push_back(gap);
+
+    // Copied into the asynchronous logger's ring buffer
+    auto file = std::tmpfile();
+    {
+        Log::AsyncLogger async{ file, 1 << 16, Log::OverflowPolicy::Drop };
+        Logger::SetSink(&async);
+
+        results.push_back(bench::Run("enabled (async)", 1, options, [&]() {
+            LOG_INFO_DSM("Entering state " << state << " through event " << evt.name() << " " << value);
+            return 1;
+        }));
+
+        // Records spaced out: the background thread is asleep most of the time
+        results.push_back(bench::Run("enabled (async, spaced)", 1, options, [&]() {
+            Gap();
+            LOG_INFO_DSM("Entering state " << state << " through event " << evt.name() << " " << value);
+            return 1;
+        }));
+        PrintSpaced(results.back(), gap);
+
+        Logger::SetSink(nullptr);
+        async.flush();
+        std::printf("async: %llu records written, %llu dropped\n",
+            static_cast<unsigned long long>(async.written()), static_cast<unsigned long long>(async.dropped()));
+    }
+    if (file != nullptr) std::fclose(file);
+
+    Logger::SetSink(nullptr);
+
+    // Raw identifiers copied into the binary tracer's ring buffer
+    const std::string tracePath = "logging_bench.trace";
+    {
+        Log::BinaryTracer tracer{ tracePath, 1 << 16, Log::OverflowPolicy::Drop };
+
+        results.push_back(bench::Run("trace (binary)", 1, options, [&]() {
+            tracer.trace(Log::TracePoint::Entry, 1, state, 0, static_cast<std::uint32_t>(details::EventId<tick>()), evt.name());
+            return 1;
+        }));
+
+        results.push_back(bench::Run("trace (binary, spaced)", 1, options, [&]() {
+            Gap();
+            tracer.trace(Log::TracePoint::Entry, 1, state, 0, static_cast<std::uint32_t>(details::EventId<tick>()), evt.name());
+            return 1;
+        }));
+        PrintSpaced(results.back(), gap);
+
+        tracer.flush();
+        std::printf("trace: %llu records dropped\n", static_cast<unsigned long long>(tracer.dropped()));
+    }
+    std::remove(tracePath.c_str());
+
+    bench::DoNotOptimize(sink.bytes);
+
+    // Logging fast paths must not allocate
+    for (const auto& result : results)
+    {
+        if (result.allocsPerEvent != 0.0)
+        {
+            std::printf("FAILED: '%s' allocates\n", result.name.c_str());
+            return 1;
+        }
+    }
+
+    return 0;
+}
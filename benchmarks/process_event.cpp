@@ -0,0 +1,358 @@
+#include "bench.hpp"
+
+#include "dsm/dsm.hpp"
+
+#include <utility>
+
+using namespace dsm;
+
+struct tick : Event<tick> {};
+struct pong : Event<pong> {};
+struct go : Event<go> {};
+struct work : Event<work> {};
+struct stale : Event<stale> {};
+struct enter : Event<enter> {};
+struct leave : Event<leave> {};
+struct ignored : Event<ignored> {};
+
+/**
+ * Generic state. Each (SmType, Index) pair is a distinct state type, which allows to build topologies of arbitrary size
+ */
+template <typename SmType, std::size_t Index>
+struct node : State<node<SmType, Index>, SmType>
+{
+    void onTick(const tick&) {}
+    void onPong(const pong&) {}
+};
+
+template <std::size_t Index>
+using entry_t = std::conditional_t<Index == 0, Entry, NoEntry>;
+
+/**
+ * Flat topology: a ring of Size states, each one transiting to the next one on tick
+ */
+template <std::size_t Size>
+struct flat_sm : StateMachine<flat_sm<Size>>
+{
+    flat_sm()
+    {
+        build(std::make_index_sequence<Size>{});
+        this->start();
+    }
+
+    template <std::size_t ...Is>
+    void build(std::index_sequence<Is...>)
+    {
+        (this->template addState<node<flat_sm, Is>, entry_t<Is>>(), ...);
+        (this->template addTransition<node<flat_sm, Is>, tick, node<flat_sm, (Is + 1) % Size>>(), ...);
+    }
+};
+
+/**
+ * Nested topology: a chain of Depth composite states, with two leaves toggling on tick at the bottom
+ */
+template <std::size_t Depth>
+struct nested_sm : StateMachine<nested_sm<Depth>>
+{
+    nested_sm()
+    {
+        this->template addState<node<nested_sm, 0>, Entry>();
+        build(std::make_index_sequence<Depth - 1>{});
+        this->template addState<node<nested_sm, Depth - 1>, node<nested_sm, Depth>, Entry>();
+        this->template addState<node<nested_sm, Depth - 1>, node<nested_sm, Depth + 1>>();
+        this->template addTransition<node<nested_sm, Depth>, tick, node<nested_sm, Depth + 1>>();
+        this->template addTransition<node<nested_sm, Depth + 1>, tick, node<nested_sm, Depth>>();
+        this->start();
+    }
+
+    template <std::size_t ...Is>
+    void build(std::index_sequence<Is...>)
+    {
+        (this->template addState<node<nested_sm, Is>, node<nested_sm, Is + 1>, Entry>(), ...);
+    }
+};
+
+/**
+ * Branches topology: two chains of Depth composite states, whose leaves transit to each other on tick.
+ * Each transition exits and enters a whole chain
+ */
+template <std::size_t Depth>
+struct branches_sm : StateMachine<branches_sm<Depth>>
+{
+    branches_sm()
+    {
+        this->template addState<node<branches_sm, 0>, Entry>();
+        this->template addState<node<branches_sm, Depth>>();
+        build(std::make_index_sequence<Depth - 1>{});
+        this->template addTransition<node<branches_sm, Depth - 1>, tick, node<branches_sm, 2 * Depth - 1>>();
+        this->template addTransition<node<branches_sm, 2 * Depth - 1>, tick, node<branches_sm, Depth - 1>>();
+        this->start();
+    }
+
+    template <std::size_t ...Is>
+    void build(std::index_sequence<Is...>)
+    {
+        (this->template addState<node<branches_sm, Is>, node<branches_sm, Is + 1>, Entry>(), ...);
+        (this->template addState<node<branches_sm, Depth + Is>, node<branches_sm, Depth + Is + 1>, Entry>(), ...);
+    }
+};
+
+/**
+ * Orthogonal topology: a composite state with Regions regions, each one holding two states toggling on tick
+ */
+template <std::size_t Regions>
+struct orthogonal_sm : StateMachine<orthogonal_sm<Regions>>
+{
+    orthogonal_sm()
+    {
+        this->template addState<node<orthogonal_sm, 0>, Entry>();
+        build(std::make_index_sequence<Regions>{});
+        this->start();
+    }
+
+    template <std::size_t ...Is>
+    void build(std::index_sequence<Is...>)
+    {
+        (this->template addState<node<orthogonal_sm, 0>, node<orthogonal_sm, 1 + 2 * Is>, Is, Entry>(), ...);
+        (this->template addState<node<orthogonal_sm, 0>, node<orthogonal_sm, 2 + 2 * Is>, Is>(), ...);
+        (this->template addTransition<node<orthogonal_sm, 1 + 2 * Is>, tick, node<orthogonal_sm, 2 + 2 * Is>>(), ...);
+        (this->template addTransition<node<orthogonal_sm, 2 + 2 * Is>, tick, node<orthogonal_sm, 1 + 2 * Is>>(), ...);
+    }
+};
+
+/**
+ * History topology: an idle state and a composite state with deep history holding a chain of Depth states.
+ * Each leave/enter round trip exits then restores the whole chain
+ */
+template <std::size_t Depth>
+struct history_sm : StateMachine<history_sm<Depth>>
+{
+    history_sm()
+    {
+        this->template addState<node<history_sm, 0>, Entry>();
+        this->template addState<node<history_sm, 1>>();
+        build(std::make_index_sequence<Depth>{});
+        this->template addTransition<node<history_sm, 0>, enter, node<history_sm, 1>>();
+        this->template addTransition<node<history_sm, 1>, leave, node<history_sm, 0>>();
+        this->template setHistory<node<history_sm, 1>>(History::Deep);
+        this->start();
+    }
+
+    template <std::size_t ...Is>
+    void build(std::index_sequence<Is...>)
+    {
+        (this->template addState<node<history_sm, Is + 1>, node<history_sm, Is + 2>, Entry>(), ...);
+    }
+};
+
+struct PostStore
+{
+    std::size_t posts = 1;
+};
+
+/**
+ * Post topology: a single state posting PostStore::posts pong events on every tick
+ */
+struct post_sm : StateMachine<post_sm, PostStore> {};
+
+struct poster : State<poster, post_sm>
+{
+    void onTick(const tick&)
+    {
+        for (std::size_t i = 0; i < store()->posts; ++i) postEvent(pong{});
+    }
+
+    void onPong(const pong&) {}
+};
+
+/**
+ * Defer topology: a busy state deferring work events, that are handled by the idle state
+ */
+struct defer_sm : StateMachine<defer_sm> {};
+
+struct busy : State<busy, defer_sm>
+{
+    void onTick(const tick&) {}
+};
+
+struct idle : State<idle, defer_sm>
+{
+    void onWork(const work&) {}
+};
+
+template <typename SmType>
+bench::Result RunTick(const char* name, std::size_t size, const bench::Options& options)
+{
+    SmType sm;
+    return bench::Run(name, size, options, [&sm]() { sm.processEvent(tick{}); return 1; });
+}
+
+template <typename SmType>
+bench::Result RunCompiled(const char* name, std::size_t size, const bench::Options& options)
+{
+    SmType sm;
+    sm.stop();
+    if (false == sm.compile()) std::printf("%s: not compiled\n", name);
+    sm.start();
+    return bench::Run(name, size, options, [&sm]() { sm.processEvent(tick{}); return 1; });
+}
+
+template <typename SmType>
+bench::Result RunIgnored(const char* name, std::size_t size, const bench::Options& options)
+{
+    SmType sm;
+    return bench::Run(name, size, options, [&sm]() { sm.processEvent(ignored{}); return 1; });
+}
+
+template <std::size_t Depth>
+bench::Result RunHistory(const bench::Options& options)
+{
+    history_sm<Depth> sm;
+    return bench::Run("history", Depth, options, [&sm]() {
+        sm.processEvent(enter{});
+        sm.processEvent(leave{});
+        return 2;
+    });
+}
+
+bench::Result RunPost(std::size_t posts, const bench::Options& options)
+{
+    post_sm sm;
+    sm.addState<poster, Entry>();
+    sm.addTransition<poster, tick, poster, &poster::onTick>();
+    sm.addTransition<poster, pong, poster, &poster::onPong>();
+    sm.store()->posts = posts;
+    sm.start();
+
+    return bench::Run("postEvent", posts, options, [&sm, posts]() {
+        sm.processEvent(tick{});
+        return 1 + posts;
+    });
+}
+
+bench::Result RunDefer(const bench::Options& options)
+{
+    defer_sm sm;
+    sm.addState<busy, Entry>();
+    sm.addState<idle>();
+    sm.addTransition<busy, go, idle>();
+    sm.addTransition<idle, work, busy>();
+    sm.start();
+
+    return bench::Run("deferEvent", 1, options, [&sm]() {
+        sm.deferEvent(work{});
+        sm.processEvent(go{});
+        return 2;
+    });
+}
+
+bench::Result RunDeclaredDefer(const bench::Options& options)
+{
+    defer_sm sm;
+    sm.addState<busy, Entry>();
+    sm.addState<idle>();
+    sm.addTransition<busy, go, idle>();
+    sm.addTransition<idle, work, busy>();
+    sm.addDeferredEvent<busy, work>();
+    sm.start();
+
+    // Queued by the deferral table, without a processing attempt
+    return bench::Run("deferEvent (declared)", 1, options, [&sm]() {
+        sm.processEvent(work{});
+        sm.processEvent(go{});
+        return 2;
+    });
+}
+
+bench::Result RunDeferredBacklog(std::size_t backlog, const bench::Options& options)
+{
+    defer_sm sm;
+    sm.addState<busy, Entry>();
+    sm.addState<idle>();
+    sm.addTransition<busy, tick, busy, &busy::onTick>();
+    sm.start();
+
+    // Never handled, hence retried on every processed event
+    for (std::size_t i = 0; i < backlog; ++i) sm.deferEvent(stale{});
+
+    return bench::Run("deferred backlog", backlog, options, [&sm]() { sm.processEvent(tick{}); return 1; });
+}
+
+bench::Result RunDeferredMixed(std::size_t backlog, const bench::Options& options)
+{
+    defer_sm sm;
+    sm.addState<busy, Entry>();
+    sm.addState<idle>();
+    sm.addTransition<busy, go, idle>();
+    sm.addTransition<idle, leave, busy>();
+    sm.addTransition<idle, work, idle, &idle::onWork>();
+    sm.start();
+
+    // Never handled, hence retried on every processed event
+    for (std::size_t i = 0; i < backlog; ++i) sm.deferEvent(stale{});
+
+    // Work events are deferred behind the stale ones, then handled and removed from the middle of the backlog
+    return bench::Run("deferred mixed", backlog, options, [&sm, backlog]() {
+        for (std::size_t i = 0; i < backlog; ++i) sm.deferEvent(work{});
+        sm.processEvent(go{});
+        sm.processEvent(leave{});
+        return backlog + 2;
+    });
+}
+
+int main(int argc, char** argv)
+{
+    const auto options = bench::ParseOptions(argc, argv);
+
+    bench::PrintHeader();
+
+    RunTick<flat_sm<10>>("flat", 10, options);
+    RunTick<flat_sm<100>>("flat", 100, options);
+#ifdef DSM_BENCHMARK_LARGE_TOPOLOGIES
+    RunTick<flat_sm<1000>>("flat", 1000, options);
+#endif
+
+    RunTick<nested_sm<10>>("nested", 10, options);
+    RunTick<nested_sm<100>>("nested", 100, options);
+#ifdef DSM_BENCHMARK_LARGE_TOPOLOGIES
+    RunTick<nested_sm<1000>>("nested", 1000, options);
+#endif
+
+    RunTick<branches_sm<10>>("branches", 10, options);
+    RunTick<branches_sm<100>>("branches", 100, options);
+
+    RunTick<orthogonal_sm<10>>("orthogonal", 10, options);
+    RunTick<orthogonal_sm<100>>("orthogonal", 100, options);
+
+    RunCompiled<flat_sm<10>>("flat (compiled)", 10, options);
+    RunCompiled<flat_sm<100>>("flat (compiled)", 100, options);
+    RunCompiled<nested_sm<10>>("nested (compiled)", 10, options);
+    RunCompiled<nested_sm<100>>("nested (compiled)", 100, options);
+    RunCompiled<branches_sm<10>>("branches (compiled)", 10, options);
+    RunCompiled<orthogonal_sm<10>>("orthogonal (compiled)", 10, options);
+
+    RunIgnored<nested_sm<10>>("ignored (nested)", 10, options);
+    RunIgnored<nested_sm<100>>("ignored (nested)", 100, options);
+    RunIgnored<orthogonal_sm<10>>("ignored (orthogonal)", 10, options);
+    RunIgnored<orthogonal_sm<100>>("ignored (orthogonal)", 100, options);
+
+    RunHistory<10>(options);
+    RunHistory<100>(options);
+
+    RunPost(1, options);
+    RunPost(10, options);
+    RunPost(100, options);
+
+    RunDefer(options);
+    RunDeclaredDefer(options);
+
+    RunDeferredBacklog(10, options);
+    RunDeferredBacklog(100, options);
+    RunDeferredBacklog(1000, options);
+
+    RunDeferredMixed(10, options);
+    RunDeferredMixed(100, options);
+    RunDeferredMixed(1000, options);
+
+    return 0;
+}
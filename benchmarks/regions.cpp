@@ -0,0 +1,98 @@
+#include "bench.hpp"
+
+#include "dsm/dsm.hpp"
+#include "dsm/region_pool.hpp"
+
+#include <array>
+#include <thread>
+#include <utility>
+
+/**
+ * Measures a state with 16 orthogonal regions, each one running a heavy action on every event, the regions running either
+ * one after another or concurrently on a RegionPool. size is the number of iterations of each action
+ */
+
+using namespace dsm;
+
+constexpr int Regions = 16;
+
+struct work : Event<work> {};
+
+struct RegionsStore
+{
+    // One cache line per region, written by its action only
+    struct alignas(64) Slot
+    {
+        std::uint64_t value = 0;
+    };
+
+    std::size_t iterations = 0;
+    std::array<Slot, Regions> slots = {};
+};
+
+struct regions_sm : StateMachine<regions_sm, RegionsStore> {};
+
+struct controller : State<controller, regions_sm> {};
+
+template <int Index>
+struct worker : State<worker<Index>, regions_sm>
+{
+    void onWork(const work&)
+    {
+        auto& slot = this->store()->slots[Index];
+        auto value = slot.value + Index;
+        for (std::size_t i = 0; i < this->store()->iterations; ++i) value ^= (value << 13) ^ (value >> 7) ^ (value << 17);
+        slot.value = value;
+    }
+};
+
+template <int ...Indices>
+void Build(regions_sm& sm, std::integer_sequence<int, Indices...>)
+{
+    sm.addState<controller, Entry>();
+    (sm.addState<controller, worker<Indices>, Indices, Entry>(), ...);
+    (sm.addTransition<worker<Indices>, work, worker<Indices>, &worker<Indices>::onWork>(), ...);
+    (sm.setIndependent<controller, Indices>(), ...);
+}
+
+void RunRegions(const std::string& name, std::size_t iterations, IRegionScheduler* scheduler, const bench::Options& options)
+{
+    regions_sm sm;
+    Build(sm, std::make_integer_sequence<int, Regions>{});
+    sm.setRegionScheduler(scheduler);
+    sm.store()->iterations = iterations;
+    sm.start();
+
+    const work evt;
+    bench::Run(name, iterations, options, [&]() {
+        sm.processEvent(evt);
+        return std::size_t{ 1 };
+    });
+
+    std::uint64_t checksum = 0;
+    for (const auto& slot : sm.store()->slots) checksum += slot.value;
+    bench::DoNotOptimize(checksum);
+}
+
+int main(int argc, char** argv)
+{
+    const auto options = bench::ParseOptions(argc, argv);
+
+    RegionPool pool;
+
+    std::printf("%d regions, %zu helper threads along with the calling thread\n", Regions, pool.helpers());
+    bench::PrintHeader();
+
+    for (std::size_t iterations : { 256, 4096, 65536 })
+    {
+        // Heavier actions, fewer events
+        auto scaled = options;
+        scaled.events = std::max<std::size_t>(1, options.events * 16 / iterations);
+        scaled.warmup = std::max<std::size_t>(1, scaled.events / 20);
+
+        RunRegions("sequential", iterations, nullptr, scaled);
+        RunRegions("region pool", iterations, &pool, scaled);
+    }
+
+    return 0;
+}
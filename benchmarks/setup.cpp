@@ -0,0 +1,127 @@
+#include "bench.hpp"
+
+#include "dsm/dsm.hpp"
+
+#include <string>
+#include <utility>
+
+using namespace dsm;
+
+struct tick : Event<tick> {};
+
+/**
+ * Generic state. Each (SmType, Index) pair is a distinct state type, which allows to build topologies of arbitrary size
+ */
+template <typename SmType, std::size_t Index>
+struct node : State<node<SmType, Index>, SmType>
+{
+    void onTick(const tick&) {}
+};
+
+template <std::size_t Index>
+using entry_t = std::conditional_t<Index == 0, Entry, NoEntry>;
+
+/**
+ * Flat topology: Size states, each one transiting to the next one on tick
+ */
+template <std::size_t Size>
+struct flat_sm : StateMachine<flat_sm<Size>>
+{
+    template <std::size_t ...Is>
+    void build(std::index_sequence<Is...>)
+    {
+        (this->template addState<node<flat_sm, Is>, entry_t<Is>>(), ...);
+        (this->template addTransition<node<flat_sm, Is>, tick, node<flat_sm, (Is + 1) % Size>>(), ...);
+    }
+};
+
+/**
+ * Nested topology: a chain of Size composite states, each one with an internal transition whose action is held by the outermost state
+ */
+template <std::size_t Size>
+struct nested_sm : StateMachine<nested_sm<Size>>
+{
+    template <std::size_t ...Is>
+    void build(std::index_sequence<Is...>)
+    {
+        this->template addState<node<nested_sm, 0>, Entry>();
+        (this->template addState<node<nested_sm, Is>, node<nested_sm, Is + 1>, Entry>(), ...);
+        (this->template addTransition<node<nested_sm, Is + 1>, tick, node<nested_sm, 0>, &node<nested_sm, 0>::onTick>(), ...);
+    }
+};
+
+/**
+ * Builds then destroys the state machine. Reported per state
+ */
+template <typename SmType, std::size_t Size, std::size_t Count>
+bench::Result RunSetup(const char* name, const bench::Options& options)
+{
+    return bench::Run(name, Size, options, []() {
+        SmType sm;
+        sm.build(std::make_index_sequence<Count>{});
+        return Size;
+    });
+}
+
+/**
+ * Spawns a started state machine, then destroys it. Reported per state:
+ * - setup: builds and starts a new state machine
+ * - instance: starts a new instance of a shared topology, entering its states
+ * - clone: copies a started instance of a shared topology
+ */
+template <typename SmType, std::size_t Size, std::size_t Count>
+void RunInstantiate(const char* name, const bench::Options& options)
+{
+    const std::string prefix = name;
+
+    bench::Run(prefix + " (setup)", Size, options, []() {
+        SmType sm;
+        sm.build(std::make_index_sequence<Count>{});
+        sm.start();
+        return Size;
+    });
+
+    SmType topology;
+    topology.build(std::make_index_sequence<Count>{});
+
+    bench::Run(prefix + " (instance)", Size, options, [&topology]() {
+        typename SmType::Instance instance{ topology };
+        instance.start();
+        return Size;
+    });
+
+    typename SmType::Instance prototype{ topology };
+    prototype.start();
+
+    bench::Run(prefix + " (clone)", Size, options, [&prototype]() {
+        auto instance = prototype.clone();
+        bench::DoNotOptimize(instance);
+        return Size;
+    });
+}
+
+int main(int argc, char** argv)
+{
+    const auto options = bench::ParseOptions(argc, argv);
+
+    bench::PrintHeader();
+
+    RunSetup<flat_sm<10>, 10, 10>("setup flat", options);
+    RunSetup<flat_sm<100>, 100, 100>("setup flat", options);
+#ifdef DSM_BENCHMARK_LARGE_TOPOLOGIES
+    RunSetup<flat_sm<1000>, 1000, 1000>("setup flat", options);
+#endif
+
+    RunSetup<nested_sm<10>, 10, 9>("setup nested", options);
+    RunSetup<nested_sm<100>, 100, 99>("setup nested", options);
+#ifdef DSM_BENCHMARK_LARGE_TOPOLOGIES
+    RunSetup<nested_sm<1000>, 1000, 999>("setup nested", options);
+#endif
+
+    RunInstantiate<flat_sm<10>, 10, 10>("spawn flat", options);
+    RunInstantiate<flat_sm<100>, 100, 100>("spawn flat", options);
+    RunInstantiate<nested_sm<10>, 10, 9>("spawn nested", options);
+    RunInstantiate<nested_sm<100>, 100, 99>("spawn nested", options);
+
+    return 0;
+}
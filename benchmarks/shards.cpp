@@ -0,0 +1,156 @@
+#include "bench.hpp"
+
+#include "dsm/dsm.hpp"
+#include "dsm/executor.hpp"
+#include "dsm/shards.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/**
+ * Compares the thread-per-core ShardedRuntime with the work-stealing Executor. State machines spread over the shards, or workers,
+ * pass hops around a ring, so that most hops cross threads. Percentiles are the hop latencies, from posting to processing.
+ * size is the number of shards, or workers
+ */
+
+using namespace dsm;
+
+struct hop : Event<hop>
+{
+    hop(std::size_t remaining, std::uint64_t postedAt) : remaining{ remaining }, postedAt{ postedAt } {}
+
+    std::size_t remaining;
+    std::uint64_t postedAt;
+};
+
+/**
+ * post sends a hop to the next state machine of the ring, through the runtime under test
+ */
+struct RingStore
+{
+    std::function<void(const hop&)> post;
+    std::vector<std::uint64_t> latencies;
+    std::uint64_t work = 0;
+};
+
+struct ring_sm : StateMachine<ring_sm, RingStore> {};
+
+struct relay : State<relay, ring_sm>
+{
+    void onHop(const hop& evt)
+    {
+        const auto now = details::SteadyNow();
+        this->store()->latencies.push_back(now - std::min(now, evt.postedAt));
+
+        // Some work per event
+        auto value = this->store()->work + evt.remaining;
+        for (int i = 0; i < 64; ++i) value ^= (value << 13) ^ (value >> 7) ^ (value << 17);
+        this->store()->work = value;
+
+        if (evt.remaining > 0) this->store()->post(hop{ evt.remaining - 1, details::SteadyNow() });
+    }
+};
+
+/**
+ * Builds a ring of machineCount state machines, runs hops from each one, then reports throughput and latencies
+ */
+template <typename SetupType>
+void RunRing(const std::string& name, std::size_t threads, std::size_t machineCount, std::size_t hops, SetupType&& setup)
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<std::unique_ptr<ring_sm>> machines;
+    for (std::size_t i = 0; i < machineCount; ++i)
+    {
+        machines.push_back(std::make_unique<ring_sm>());
+        machines.back()->addState<relay, Entry>();
+        machines.back()->addTransition<relay, hop, relay, &relay::onHop>();
+        machines.back()->start();
+        machines.back()->store()->latencies.reserve(2 * hops + 16);
+    }
+
+    const auto allocsBefore = bench::Allocations().load(std::memory_order_relaxed);
+    const auto start = Clock::now();
+
+    // Seeds the hops then waits for all of them
+    setup(machines);
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    const auto allocs = bench::Allocations().load(std::memory_order_relaxed) - allocsBefore;
+
+    std::vector<std::uint64_t> latencies;
+    for (const auto& machine : machines) latencies.insert(latencies.end(), machine->store()->latencies.begin(), machine->store()->latencies.end());
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) { return latencies[std::min(latencies.size() - 1, static_cast<std::size_t>(p * static_cast<double>(latencies.size())))]; };
+
+    bench::Result result;
+    result.name = name;
+    result.size = threads;
+    result.nsPerEvent = static_cast<double>(elapsed) / static_cast<double>(latencies.size());
+    result.allocsPerEvent = static_cast<double>(allocs) / static_cast<double>(latencies.size());
+    result.p50 = percentile(0.50);
+    result.p99 = percentile(0.99);
+    result.p999 = percentile(0.999);
+    bench::Print(result);
+}
+
+void RunSharded(const std::string& name, std::size_t shards, std::size_t machineCount, std::size_t hops, WaitPolicy policy)
+{
+    RunRing(name, shards, machineCount, hops, [shards, hops, policy](auto& machines) {
+        ShardedRuntime runtime{ shards, ShardedRuntime::DefaultCapacity, policy };
+        std::vector<Endpoint> endpoints;
+        for (std::size_t i = 0; i < machines.size(); ++i) endpoints.push_back(runtime.attach(*machines[i], i % shards));
+        for (std::size_t i = 0; i < machines.size(); ++i)
+        {
+            auto next = endpoints[(i + 1) % machines.size()];
+            machines[i]->store()->post = [&runtime, next](const hop& evt) { runtime.postEvent(next, evt); };
+        }
+
+        for (std::size_t i = 0; i < machines.size(); ++i) runtime.postEvent(endpoints[i], hop{ hops, details::SteadyNow() });
+        runtime.wait();
+    });
+}
+
+void RunExecutor(std::size_t workers, std::size_t machineCount, std::size_t hops)
+{
+    RunRing("executor", workers, machineCount, hops, [workers, hops](auto& machines) {
+        Executor executor{ workers };
+        std::vector<std::unique_ptr<Strand>> strands;
+        for (std::size_t i = 0; i < machines.size(); ++i) strands.push_back(std::make_unique<Strand>(executor));
+        for (std::size_t i = 0; i < machines.size(); ++i)
+        {
+            auto strand = strands[(i + 1) % machines.size()].get();
+            auto next = machines[(i + 1) % machines.size()].get();
+            machines[i]->store()->post = [strand, next](const hop& evt) { strand->postEvent(*next, evt); };
+        }
+
+        for (std::size_t i = 0; i < machines.size(); ++i) strands[i]->postEvent(*machines[i], hop{ hops, details::SteadyNow() });
+        executor.wait();
+    });
+}
+
+int main(int argc, char** argv)
+{
+    const auto options = bench::ParseOptions(argc, argv);
+
+    const std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    const std::size_t machineCount = 64;
+    const std::size_t hops = std::max<std::size_t>(1, options.events / machineCount);
+
+    std::printf("%zu hardware threads available\n", cores);
+    bench::PrintHeader();
+
+    for (std::size_t threads = 1; threads <= cores; threads *= 2)
+    {
+        RunSharded("sharded (busy poll)", threads, machineCount, hops, WaitPolicy::BusyPoll);
+        RunSharded("sharded (block)", threads, machineCount, hops, WaitPolicy::Block);
+
+        RunExecutor(threads, machineCount, hops);
+    }
+
+    return 0;
+}
@@ -0,0 +1,232 @@
+#include "bench.hpp"
+
+#include "dsm/dsm.hpp"
+
+#include <functional>
+#include <memory>
+
+/**
+ * Compares the transition dispatch layer of dsm with the previous one, kept here for reference:
+ * - legacy: virtual EventBase::apply -> std::function -> lambda -> std::invoke of the member pointers,
+ *   the lambda capturing the transition data being too large for std::function's small buffer
+ * - inline: function pointer -> static function calling compile-time member pointers, with the transition data stored inline
+ * Both layers are reproduced standalone, then measured through StateMachine::processEvent
+ */
+
+struct tick : dsm::Event<tick> {};
+
+/**
+ * State-like target of the guard and action
+ */
+struct target
+{
+    std::uint64_t count = 0;
+
+    template <typename EventType>
+    bool allow(const EventType&) { return true; }
+
+    template <typename EventType>
+    void onTick(const EventType&) { ++count; }
+};
+
+/**
+ * Same size as dsm's transition data
+ */
+struct data_t
+{
+    void* commonAncestor;
+    void* srcOutermost;
+    void* dstOutermost;
+    void* src;
+    void* dst;
+};
+
+namespace legacy
+{
+    struct TransitionBase
+    {
+        virtual ~TransitionBase() = default;
+    };
+
+    template <typename EventType>
+    struct Transition : TransitionBase
+    {
+        explicit Transition(std::function<bool(const EventType&)> cb)
+            : m_cb{ std::move(cb) }
+        {}
+
+        bool exec(const EventType& evt) { return m_cb(evt); }
+
+        std::function<bool(const EventType&)> m_cb;
+    };
+
+    struct EventBase
+    {
+        virtual ~EventBase() = default;
+        virtual bool apply(TransitionBase* transition) const = 0;
+    };
+
+    struct tick : EventBase
+    {
+        bool apply(TransitionBase* transition) const override
+        {
+            return static_cast<Transition<tick>*>(transition)->exec(*this);
+        }
+    };
+
+    using TGuard = bool(target::*)(const tick&);
+    using TAction = void(target::*)(const tick&);
+
+    inline TransitionBase* Create(target* state, const data_t& data, TAction action, TGuard guard)
+    {
+        auto cb = [state, data, actionMember = action, guardMember = guard](const tick& evt)
+        {
+            if (guardMember != nullptr && false == std::invoke(guardMember, state, evt)) return false;
+            if (actionMember != nullptr) std::invoke(actionMember, state, evt);
+            bench::DoNotOptimize(data);
+            return true;
+        };
+
+        return new Transition<tick>{ cb };
+    }
+}
+
+namespace inline_
+{
+    struct EventBase
+    {
+        virtual ~EventBase() = default;
+    };
+
+    struct tick : EventBase {};
+
+    struct TransitionBase
+    {
+        using TExecFunc = bool(*)(const TransitionBase*, const EventBase&);
+
+        explicit TransitionBase(TExecFunc exec)
+            : m_exec{ exec }
+        {}
+
+        virtual ~TransitionBase() = default;
+
+        bool exec(const EventBase& evt) const { return m_exec(this, evt); }
+
+        TExecFunc m_exec;
+    };
+
+    template <bool(target::*guard)(const tick&), void(target::*action)(const tick&)>
+    struct Transition : TransitionBase
+    {
+        Transition(target* state, const data_t& data)
+            : TransitionBase{ &Exec }
+            , m_state{ state }
+            , m_data{ data }
+        {}
+
+        static bool Exec(const TransitionBase* base, const EventBase& evt)
+        {
+            auto transition = static_cast<const Transition*>(base);
+            const auto& event = static_cast<const tick&>(evt);
+            if constexpr (guard != nullptr)
+            {
+                if (false == (transition->m_state->*guard)(event)) return false;
+            }
+            if constexpr (action != nullptr) (transition->m_state->*action)(event);
+            bench::DoNotOptimize(transition->m_data);
+            return true;
+        }
+
+        target* m_state;
+        data_t m_data;
+    };
+}
+
+/**
+ * Single state machine with an internal transition calling a guard and an action
+ */
+struct internal_sm : dsm::StateMachine<internal_sm> {};
+
+struct counter : dsm::State<counter, internal_sm>
+{
+    std::uint64_t count = 0;
+
+    bool allow(const tick&) { return true; }
+    void onTick(const tick&) { ++count; }
+};
+
+/**
+ * Two states toggling on tick through a guarded external transition with an action
+ */
+struct external_sm : dsm::StateMachine<external_sm> {};
+
+struct ping : dsm::State<ping, external_sm>
+{
+    bool allow(const tick&) { return true; }
+    void onTick(const tick&) {}
+};
+
+struct pong : dsm::State<pong, external_sm>
+{
+    bool allow(const tick&) { return true; }
+    void onTick(const tick&) {}
+};
+
+int main(int argc, char** argv)
+{
+    const auto options = bench::ParseOptions(argc, argv);
+
+    target state;
+    const data_t data{};
+
+    bench::PrintHeader();
+
+    // Standalone dispatch layers
+    {
+        std::unique_ptr<legacy::TransitionBase> transition{ legacy::Create(&state, data, &target::onTick<legacy::tick>, &target::allow<legacy::tick>) };
+        const legacy::tick evt;
+        const legacy::EventBase& base = evt;
+        bench::Run("dispatch (legacy std::function)", 1, options, [&]() { bench::DoNotOptimize(base.apply(transition.get())); return 1; });
+    }
+
+    {
+        std::unique_ptr<inline_::TransitionBase> transition{ new inline_::Transition<&target::allow<inline_::tick>, &target::onTick<inline_::tick>>{ &state, data } };
+        const inline_::tick evt;
+        const inline_::EventBase& base = evt;
+        bench::Run("dispatch (inline)", 1, options, [&]() { bench::DoNotOptimize(transition->exec(base)); return 1; });
+    }
+
+    // Standalone creation, i.e. allocations per transition
+    bench::Run("create (legacy std::function)", 1, options, [&]() {
+        delete legacy::Create(&state, data, &target::onTick<legacy::tick>, &target::allow<legacy::tick>);
+        return 1;
+    });
+
+    bench::Run("create (inline)", 1, options, [&]() {
+        delete new inline_::Transition<&target::allow<inline_::tick>, &target::onTick<inline_::tick>>{ &state, data };
+        return 1;
+    });
+
+    // Through the state machine
+    {
+        internal_sm sm;
+        sm.addState<counter, dsm::Entry>();
+        sm.addTransition<counter, tick, counter, &counter::onTick, &counter::allow>();
+        sm.start();
+        bench::Run("processEvent (internal)", 1, options, [&sm]() { sm.processEvent(tick{}); return 1; });
+    }
+
+    {
+        external_sm sm;
+        sm.addState<ping, dsm::Entry>();
+        sm.addState<pong>();
+        sm.addTransition<ping, tick, ping, &ping::onTick, &ping::allow, pong>();
+        sm.addTransition<pong, tick, pong, &pong::onTick, &pong::allow, ping>();
+        sm.start();
+        bench::Run("processEvent (external)", 1, options, [&sm]() { sm.processEvent(tick{}); return 1; });
+    }
+
+    bench::DoNotOptimize(state.count);
+
+    return 0;
+}
@@ -0,0 +1,391 @@
+#ifndef LOG_ASYNC_LOGGER
+#define LOG_ASYNC_LOGGER
+
+#include "log.hpp"
+#include "bounded_queue.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace Log
+{
+    /**
+     * @brief   OverflowPolicy
+     * @details Behavior of AsyncLogger when its ring buffer is full
+     */
+    enum class OverflowPolicy
+    {
+        Drop = 0,   // The record is discarded and counted as dropped
+        Block = 1   // The caller waits for a free slot
+    };
+
+    /**
+     * @brief   AsyncQueue
+     * @details Preallocated lock-free ring buffer of RecordType (see dsm::details::BoundedQueue), drained by a background thread.
+     *          Producers fill records in place and never lock, except for waking up the background thread once the ring buffer
+     *          is half full. Otherwise the background thread drains it every FlushInterval, so that records spaced out cost
+     *          their producer neither a lock nor a wake-up.
+     *          The background thread hands each record to the writer, then calls it with nullptr once idle so that it may flush
+     */
+    template <typename RecordType>
+    class AsyncQueue
+    {
+    public:
+        using TWriter = std::function<void(const RecordType*)>;
+
+        static constexpr std::chrono::milliseconds FlushInterval{ 20 };
+
+        /**
+         * @brief       AsyncQueue
+         * @param[in]   capacity: number of records the ring buffer can hold, rounded up to a power of two
+         * @param[in]   policy: overflow policy
+         * @param[in]   writer: function called from the background thread for each record, and with nullptr once idle
+         */
+        AsyncQueue(std::size_t capacity, OverflowPolicy policy, TWriter writer)
+            : m_queue{ capacity }
+            , m_policy{ policy }
+            , m_writer{ std::move(writer) }
+        {
+            m_thread = std::thread{ [this]() { run(); } };
+        }
+
+        AsyncQueue(const AsyncQueue&) = delete;
+        AsyncQueue& operator=(const AsyncQueue&) = delete;
+
+        /**
+         * @brief   ~AsyncQueue
+         * @details Writes all pending records then stops the background thread
+         */
+        ~AsyncQueue()
+        {
+            m_running.store(false, std::memory_order_seq_cst);
+            wakeUp();
+            if (m_thread.joinable()) m_thread.join();
+        }
+
+        /**
+         * @brief       push
+         * @param[in]   fill: function filling the claimed record in place
+         * @return      true if the record was queued, false if it was dropped
+         */
+        template <typename FillType>
+        bool push(FillType&& fill)
+        {
+            TSlot* slot = acquire();
+            if (nullptr == slot) return false;
+
+            fill(slot->m_value);
+
+            release(slot);
+            return true;
+        }
+
+        /**
+         * @brief   flush
+         * @details Blocks until every record accepted so far has been handed to the writer and flushed
+         */
+        void flush()
+        {
+            const auto target = m_queue.enqueued();
+
+            std::unique_lock<std::mutex> lock{ m_mutex };
+            m_wakeRequested = true;
+            m_cv.notify_one();
+
+            m_flushWaiters.fetch_add(1, std::memory_order_seq_cst);
+            m_flushedCv.wait(lock, [this, target]() { return m_flushedPos.load(std::memory_order_seq_cst) >= target; });
+            m_flushWaiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        std::uint64_t dropped() const
+        {
+            return m_dropped.load(std::memory_order_relaxed);
+        }
+
+        std::uint64_t written() const
+        {
+            return m_flushedPos.load(std::memory_order_relaxed);
+        }
+
+    private:
+        using TSlot = typename dsm::details::BoundedQueue<RecordType>::Slot;
+
+        /**
+         * @brief   acquire
+         * @details Claims the next free slot, waiting for one if full under OverflowPolicy::Block
+         * @return  Pointer to the claimed slot, or nullptr if the record is dropped
+         */
+        TSlot* acquire()
+        {
+            for (;;)
+            {
+                TSlot* slot = m_queue.tryAcquire();
+                if (slot != nullptr) return slot;
+
+                // Full
+                if (OverflowPolicy::Drop == m_policy)
+                {
+                    m_dropped.fetch_add(1, std::memory_order_relaxed);
+                    return nullptr;
+                }
+
+                wakeUp();
+                std::this_thread::yield();
+            }
+        }
+
+        void release(TSlot* slot)
+        {
+            const auto pos = slot->m_sequence.load(std::memory_order_relaxed);
+            m_queue.publish(slot);
+
+            // Below half full, the background thread drains the record on its next FlushInterval
+            const auto pending = static_cast<std::intptr_t>(pos + 1 - m_flushedPos.load(std::memory_order_relaxed));
+            if (pending < static_cast<std::intptr_t>(m_queue.capacity() / 2)) return;
+
+            // Pairs with run: either the background thread sees the ring buffer half full before sleeping, or the producer sees it sleeping
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (true == m_sleeping.load(std::memory_order_relaxed)) wakeUp();
+        }
+
+        void wakeUp()
+        {
+            std::lock_guard<std::mutex> lock{ m_mutex };
+            m_wakeRequested = true;
+            m_cv.notify_one();
+        }
+
+        /**
+         * @brief   halfFull
+         * @return  true if the ring buffer holds at least half its capacity. Called by the background thread only
+         */
+        bool halfFull() const
+        {
+            return m_queue.enqueued() - m_queue.dequeued() >= m_queue.capacity() / 2;
+        }
+
+        /**
+         * @brief   run
+         * @details Background thread: drains the ring buffer into the writer, then flushes once idle
+         */
+        void run()
+        {
+            for (;;)
+            {
+                const bool running = m_running.load(std::memory_order_acquire);
+                std::size_t count = 0;
+
+                for (RecordType* record = m_queue.front(); record != nullptr; record = m_queue.front())
+                {
+                    m_writer(record);
+                    m_queue.pop();
+                    ++count;
+                }
+
+                if (count > 0)
+                {
+                    m_writer(nullptr);
+                    m_flushedPos.store(m_queue.dequeued(), std::memory_order_seq_cst);
+                    if (m_flushWaiters.load(std::memory_order_seq_cst) > 0)
+                    {
+                        std::lock_guard<std::mutex> lock{ m_mutex };
+                        m_flushedCv.notify_all();
+                    }
+                    continue;
+                }
+
+                if (false == running) break;
+
+                std::unique_lock<std::mutex> lock{ m_mutex };
+                m_sleeping.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+
+                // Wake-ups requested before sleeping are not waited for, those racing with the sleeping flag are bounded by FlushInterval
+                if (false == m_wakeRequested && true == m_running.load(std::memory_order_relaxed) && false == halfFull())
+                {
+                    m_cv.wait_for(lock, FlushInterval);
+                }
+
+                m_wakeRequested = false;
+                m_sleeping.store(false, std::memory_order_relaxed);
+            }
+        }
+
+        dsm::details::BoundedQueue<RecordType> m_queue;
+        const OverflowPolicy m_policy;
+        TWriter m_writer;
+
+        alignas(64) std::atomic<std::size_t> m_flushedPos{ 0 };
+        std::atomic<std::uint64_t> m_dropped{ 0 };
+        std::atomic<bool> m_running{ true };
+        std::atomic<bool> m_sleeping{ false };
+        std::atomic<int> m_flushWaiters{ 0 };
+
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::condition_variable m_flushedCv;
+        bool m_wakeRequested = false;   // Guarded by m_mutex
+        std::thread m_thread;
+    };
+
+    /**
+     * @brief   AsyncLogger
+     * @details ILogger implementation that copies records into an AsyncQueue. Its background thread formats them
+     *          and writes them to a file with buffered I/O, so that logging threads never wait on the output
+     */
+    class AsyncLogger : public ILogger
+    {
+    public:
+        static constexpr std::size_t DefaultCapacity = 1024;
+        static constexpr std::size_t ModuleCapacity = 32;
+
+        /**
+         * @brief   AsyncLogger
+         * @details Logs to the standard output, dropping records on overflow. The standard output's buffering is left untouched
+         */
+        AsyncLogger()
+            : AsyncLogger{ stdout, false, DefaultCapacity, OverflowPolicy::Drop }
+        {}
+
+        /**
+         * @brief       AsyncLogger
+         * @param[in]   path: output file path, truncated on opening
+         * @param[in]   capacity: number of records the ring buffer can hold, rounded up to a power of two
+         * @param[in]   policy: overflow policy
+         * @details     A file failing to open is reported on the standard error output, records being discarded
+         */
+        explicit AsyncLogger(const std::string& path, std::size_t capacity = DefaultCapacity, OverflowPolicy policy = OverflowPolicy::Drop)
+            : AsyncLogger{ std::fopen(path.c_str(), "w"), true, capacity, policy }
+        {
+            if (nullptr == m_file) std::fprintf(stderr, "Failed to open log file '%s'\n", path.c_str());
+        }
+
+        /**
+         * @brief       AsyncLogger
+         * @param[in]   file: output file, not owned
+         * @param[in]   capacity: number of records the ring buffer can hold, rounded up to a power of two
+         * @param[in]   policy: overflow policy
+         * @details     The file's buffering is left to the caller, which may set it with setvbuf before any other operation on it
+         */
+        AsyncLogger(std::FILE* file, std::size_t capacity, OverflowPolicy policy)
+            : AsyncLogger{ file, false, capacity, policy }
+        {}
+
+        /**
+         * @brief   ~AsyncLogger
+         * @details Writes all pending records then closes the output if owned
+         */
+        ~AsyncLogger() override
+        {
+            m_queue.reset();
+            if (m_file != nullptr && true == m_ownsFile) std::fclose(m_file);
+        }
+
+        using ILogger::writeLog;
+
+        /**
+         * @brief   writeLog
+         * @details Copies the record into the ring buffer. Module and message are truncated to their slot capacity
+         */
+        void writeLog(std::string_view module, LogLevel level, std::string_view msg) override
+        {
+            m_queue->push([&](Record& record) {
+                record.level = level;
+                record.moduleSize = std::min(module.size(), ModuleCapacity);
+                std::memcpy(record.module, module.data(), record.moduleSize);
+                record.msgSize = std::min(msg.size(), LineBuffer::Capacity);
+                std::memcpy(record.msg, msg.data(), record.msgSize);
+            });
+        }
+
+        /**
+         * @brief   flush
+         * @details Blocks until every record accepted so far has been written to the output
+         */
+        void flush()
+        {
+            m_queue->flush();
+        }
+
+        /**
+         * @brief   dropped
+         * @return  Returns the number of records dropped on overflow
+         */
+        std::uint64_t dropped() const
+        {
+            return m_queue->dropped();
+        }
+
+        /**
+         * @brief   written
+         * @return  Returns the number of records written to the output, records discarded for lack of output excluded
+         */
+        std::uint64_t written() const
+        {
+            return m_written.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief   opened
+         * @return  Returns true if the logger has an output to write to
+         */
+        bool opened() const
+        {
+            return m_file != nullptr;
+        }
+
+    private:
+        struct Record
+        {
+            LogLevel level = eDebug;
+            std::size_t moduleSize = 0;
+            std::size_t msgSize = 0;
+            char module[ModuleCapacity];
+            char msg[LineBuffer::Capacity];
+        };
+
+        AsyncLogger(std::FILE* file, bool ownsFile, std::size_t capacity, OverflowPolicy policy)
+            : m_file{ file }
+            , m_ownsFile{ ownsFile }
+        {
+            // Only files just opened may still be given a buffer
+            if (m_file != nullptr && true == m_ownsFile) std::setvbuf(m_file, nullptr, _IOFBF, 1 << 16);
+
+            m_queue = std::make_unique<AsyncQueue<Record>>(capacity, policy, [this](const Record* record) { write(record); });
+        }
+
+        // Called from the background thread only
+        void write(const Record* record)
+        {
+            if (nullptr == m_file) return;
+
+            if (nullptr == record)
+            {
+                std::fflush(m_file);
+                return;
+            }
+
+            std::fwrite(record->module, 1, record->moduleSize, m_file);
+            std::fputs(LevelToStr(record->level), m_file);
+            std::fwrite(record->msg, 1, record->msgSize, m_file);
+            if (std::fputc('\n', m_file) != EOF) m_written.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        std::FILE* m_file = nullptr;
+        const bool m_ownsFile = false;
+        std::atomic<std::uint64_t> m_written{ 0 };
+        std::unique_ptr<AsyncQueue<Record>> m_queue;
+    };
+}
+
+#endif
@@ -0,0 +1,348 @@
+#ifndef LOG_BINARY_TRACER
+#define LOG_BINARY_TRACER
+
+#include "async_logger.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Log
+{
+    /**
+     * @brief   TraceRecordKind
+     * @details Kind of a binary trace record
+     */
+    enum class TraceRecordKind : std::uint8_t
+    {
+        Point = 0,  // Trace point
+        StateName,  // Name of the state identifier, followed by the name's characters
+        EventName   // Name of the event identifier, followed by the name's characters
+    };
+
+    /**
+     * @brief   TraceFileHeader
+     * @details Leading bytes of a binary trace file
+     */
+    struct TraceFileHeader
+    {
+        static constexpr char Magic[4] = { 'D', 'S', 'M', 'T' };
+        static constexpr std::uint32_t CurrentVersion = 1;
+
+        char magic[4] = { Magic[0], Magic[1], Magic[2], Magic[3] };
+        std::uint32_t version = CurrentVersion;
+    };
+
+    /**
+     * @brief   TraceRecord
+     * @details Fixed size binary record, written as is in native byte order.
+     *          Name records hold the identifier in state or event, and are followed by length characters
+     */
+    struct TraceRecord
+    {
+        std::uint64_t timestamp = 0;    // Nanoseconds since the tracer's creation
+        std::uint32_t state = InvalidTraceId;
+        std::uint32_t event = InvalidTraceId;
+        std::int32_t region = 0;
+        TracePoint point = TracePoint::Entry;
+        TraceRecordKind kind = TraceRecordKind::Point;
+        std::uint16_t length = 0;
+    };
+
+    static_assert(sizeof(TraceRecord) == 24, "TraceRecord layout must be packed");
+
+    /**
+     * @brief   BinaryTracer
+     * @details ITracer implementation that copies raw identifiers into an AsyncQueue, so that a trace point costs
+     *          a clock read and a copy of a few bytes. Its background thread writes them to a binary file.
+     *          The names of state and event identifiers are written once, the first time each identifier is traced.
+     *          Identifiers are per type, hence different instances of a same state type share the first name recorded.
+     *          Use TraceReader, or the dsm_trace_decoder tool, to render the file
+     */
+    class BinaryTracer : public ITracer
+    {
+    public:
+        static constexpr std::size_t DefaultCapacity = 4096;
+        static constexpr std::size_t NameCapacity = 64;
+        static constexpr std::uint32_t MaxNamedIds = 1 << 16;   // Names of identifiers above this limit are not recorded
+
+        /**
+         * @brief   BinaryTracer
+         * @details Traces into "dsm.trace" in the working directory, dropping records on overflow
+         */
+        BinaryTracer()
+            : BinaryTracer{ "dsm.trace" }
+        {}
+
+        /**
+         * @brief       BinaryTracer
+         * @param[in]   path: output file path, truncated on opening
+         * @param[in]   capacity: number of records the ring buffer can hold, rounded up to a power of two
+         * @param[in]   policy: overflow policy
+         * @details     A file failing to open is reported on the standard error output, records being discarded
+         */
+        explicit BinaryTracer(const std::string& path, std::size_t capacity = DefaultCapacity, OverflowPolicy policy = OverflowPolicy::Drop)
+            : m_file{ std::fopen(path.c_str(), "wb") }
+            , m_epoch{ Clock::now() }
+            , m_stateNames{ new std::atomic<std::uint64_t>[MaxNamedIds / 64] }
+            , m_eventNames{ new std::atomic<std::uint64_t>[MaxNamedIds / 64] }
+        {
+            for (std::uint32_t i = 0; i < MaxNamedIds / 64; ++i)
+            {
+                m_stateNames[i].store(0, std::memory_order_relaxed);
+                m_eventNames[i].store(0, std::memory_order_relaxed);
+            }
+
+            if (m_file != nullptr)
+            {
+                std::setvbuf(m_file, nullptr, _IOFBF, 1 << 16);
+                const TraceFileHeader header;
+                std::fwrite(&header, sizeof(header), 1, m_file);
+            }
+            else
+            {
+                std::fprintf(stderr, "Failed to open trace file '%s'\n", path.c_str());
+            }
+
+            m_queue = std::make_unique<AsyncQueue<Entry>>(capacity, policy, [this](const Entry* entry) { write(entry); });
+        }
+
+        /**
+         * @brief   ~BinaryTracer
+         * @details Writes all pending records then closes the output
+         */
+        ~BinaryTracer() override
+        {
+            m_queue.reset();
+            if (m_file != nullptr) std::fclose(m_file);
+        }
+
+        void trace(TracePoint point, std::uint32_t stateId, std::string_view stateName, int region, std::uint32_t eventId, std::string_view eventName) override
+        {
+            if (true == claimName(m_stateNames.get(), stateId) && false == pushName(TraceRecordKind::StateName, stateId, stateName))
+            {
+                unclaimName(m_stateNames.get(), stateId);
+            }
+
+            if (true == claimName(m_eventNames.get(), eventId) && false == pushName(TraceRecordKind::EventName, eventId, eventName))
+            {
+                unclaimName(m_eventNames.get(), eventId);
+            }
+
+            const auto timestamp = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_epoch).count());
+
+            m_queue->push([&](Entry& entry) {
+                entry.record.timestamp = timestamp;
+                entry.record.state = stateId;
+                entry.record.event = eventId;
+                entry.record.region = region;
+                entry.record.point = point;
+                entry.record.kind = TraceRecordKind::Point;
+                entry.record.length = 0;
+            });
+        }
+
+        /**
+         * @brief   flush
+         * @details Blocks until every record accepted so far has been written to the output
+         */
+        void flush()
+        {
+            m_queue->flush();
+        }
+
+        /**
+         * @brief   dropped
+         * @return  Returns the number of records dropped on overflow
+         */
+        std::uint64_t dropped() const
+        {
+            return m_queue->dropped();
+        }
+
+        /**
+         * @brief   opened
+         * @return  Returns true if the tracer has an output to write to
+         */
+        bool opened() const
+        {
+            return m_file != nullptr;
+        }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Entry
+        {
+            TraceRecord record;
+            char name[NameCapacity];
+        };
+
+        /**
+         * @brief   claimName
+         * @return  true if the calling thread is the first one to trace the provided identifier
+         */
+        static bool claimName(std::atomic<std::uint64_t>* names, std::uint32_t id)
+        {
+            if (id >= MaxNamedIds) return false;
+
+            const std::uint64_t bit = std::uint64_t{ 1 } << (id % 64);
+            auto& word = names[id / 64];
+            if (0 != (word.load(std::memory_order_relaxed) & bit)) return false;
+
+            return 0 == (word.fetch_or(bit, std::memory_order_relaxed) & bit);
+        }
+
+        /**
+         * @brief   unclaimName
+         * @details Gives up a claim whose name record was dropped, so that the name is recorded by a later trace point
+         */
+        static void unclaimName(std::atomic<std::uint64_t>* names, std::uint32_t id)
+        {
+            names[id / 64].fetch_and(~(std::uint64_t{ 1 } << (id % 64)), std::memory_order_relaxed);
+        }
+
+        bool pushName(TraceRecordKind kind, std::uint32_t id, std::string_view name)
+        {
+            return m_queue->push([&](Entry& entry) {
+                entry.record = TraceRecord{};
+                entry.record.kind = kind;
+                if (TraceRecordKind::StateName == kind) entry.record.state = id;
+                else entry.record.event = id;
+                entry.record.length = static_cast<std::uint16_t>(std::min(name.size(), NameCapacity));
+                std::memcpy(entry.name, name.data(), entry.record.length);
+            });
+        }
+
+        void write(const Entry* entry)
+        {
+            if (nullptr == m_file) return;
+
+            if (nullptr == entry)
+            {
+                std::fflush(m_file);
+                return;
+            }
+
+            std::fwrite(&entry->record, sizeof(TraceRecord), 1, m_file);
+            if (entry->record.length > 0) std::fwrite(entry->name, 1, entry->record.length, m_file);
+        }
+
+        std::FILE* m_file = nullptr;
+        const Clock::time_point m_epoch;
+        std::unique_ptr<std::atomic<std::uint64_t>[]> m_stateNames;
+        std::unique_ptr<std::atomic<std::uint64_t>[]> m_eventNames;
+        std::unique_ptr<AsyncQueue<Entry>> m_queue;
+    };
+
+    /**
+     * @brief   TraceReader
+     * @details Loads a binary trace file written by BinaryTracer and renders its trace points as text
+     */
+    class TraceReader
+    {
+    public:
+        /**
+         * @brief       load
+         * @param[in]   path: binary trace file path
+         * @return      true if the file was successfully loaded, false otherwise.
+         *              A file truncated in the middle of a record is loaded up to its last complete record
+         */
+        bool load(const std::string& path)
+        {
+            m_points.clear();
+            m_stateNames.clear();
+            m_eventNames.clear();
+
+            std::unique_ptr<std::FILE, int(*)(std::FILE*)> file{ std::fopen(path.c_str(), "rb"), &std::fclose };
+            if (nullptr == file) return false;
+
+            TraceFileHeader header;
+            if (1 != std::fread(&header, sizeof(header), 1, file.get())) return false;
+            if (0 != std::memcmp(header.magic, TraceFileHeader::Magic, sizeof(header.magic))) return false;
+            if (TraceFileHeader::CurrentVersion != header.version) return false;
+
+            TraceRecord record;
+            while (1 == std::fread(&record, sizeof(record), 1, file.get()))
+            {
+                if (TraceRecordKind::Point == record.kind)
+                {
+                    m_points.push_back(record);
+                    continue;
+                }
+
+                std::string name(record.length, '\0');
+                if (record.length > 0 && record.length != std::fread(name.data(), 1, record.length, file.get())) break;
+
+                if (TraceRecordKind::StateName == record.kind) m_stateNames.emplace(record.state, std::move(name));
+                else m_eventNames.emplace(record.event, std::move(name));
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief   points
+         * @return  Returns the loaded trace points, in recording order
+         */
+        const std::vector<TraceRecord>& points() const
+        {
+            return m_points;
+        }
+
+        std::string stateName(std::uint32_t id) const
+        {
+            return nameOf(m_stateNames, id);
+        }
+
+        std::string eventName(std::uint32_t id) const
+        {
+            if (InvalidTraceId == id) return "anonymous";
+            return nameOf(m_eventNames, id);
+        }
+
+        /**
+         * @brief       format
+         * @param[in]   record: trace point to render
+         * @return      Returns a human readable line. Identifiers without recorded name are rendered as '#id'
+         */
+        std::string format(const TraceRecord& record) const
+        {
+            char timestamp[32];
+            std::snprintf(timestamp, sizeof(timestamp), "%14.3f us ", static_cast<double>(record.timestamp) / 1000.0);
+
+            std::string res{ timestamp };
+            res += TracePointToStr(record.point);
+            res += " state ";
+            res += stateName(record.state);
+            res += " (region ";
+            res += std::to_string(record.region);
+            res += ") event ";
+            res += eventName(record.event);
+
+            return res;
+        }
+
+    private:
+        static std::string nameOf(const std::unordered_map<std::uint32_t, std::string>& names, std::uint32_t id)
+        {
+            auto it = names.find(id);
+            if (it != names.end()) return it->second;
+            return "#" + std::to_string(id);
+        }
+
+        std::vector<TraceRecord> m_points;
+        std::unordered_map<std::uint32_t, std::string> m_stateNames;
+        std::unordered_map<std::uint32_t, std::string> m_eventNames;
+    };
+}
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef DSM_BOUNDED_QUEUE_INCLUDED_
+#define DSM_BOUNDED_QUEUE_INCLUDED_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace dsm
+{
+    namespace details
+    {
+        /**
+         * @brief       RoundUp
+         * @param[in]   capacity: requested capacity
+         * @return      Returns the smallest power of two greater than or equal to capacity, at least 2
+         */
+        inline std::size_t RoundUp(std::size_t capacity)
+        {
+            std::size_t result = 2;
+            while (result < capacity) result <<= 1;
+            return result;
+        }
+
+        /**
+         * @brief   BoundedQueue
+         * @details Preallocated lock-free ring buffer (bounded MPMC queue from D. Vyukov), restricted to a single consumer.
+         *          Producers claim a slot, fill its value in place, then publish it. The consumer reads the published values
+         *          in order and frees their slot. Waiting, on either side, is left to the owner
+         */
+        template <typename Type>
+        class BoundedQueue
+        {
+        public:
+            /**
+             * @brief   Slot
+             * @details Ring buffer cell. Its sequence number tells producers and consumer whose turn it is
+             */
+            struct Slot
+            {
+                std::atomic<std::size_t> m_sequence{ 0 };
+                Type m_value;
+            };
+
+            /**
+             * @brief       BoundedQueue
+             * @param[in]   capacity: number of values the ring buffer can hold, rounded up to a power of two
+             */
+            explicit BoundedQueue(std::size_t capacity)
+                : m_capacity{ RoundUp(capacity) }
+                , m_mask{ m_capacity - 1 }
+                , m_slots{ new Slot[m_capacity] }
+            {
+                for (std::size_t i = 0; i < m_capacity; ++i) m_slots[i].m_sequence.store(i, std::memory_order_relaxed);
+            }
+
+            BoundedQueue(const BoundedQueue&) = delete;
+            BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+            /**
+             * @brief   tryAcquire
+             * @details Claims the next free slot, from any thread
+             * @return  Pointer to the claimed slot, or nullptr if the ring buffer is full
+             */
+            Slot* tryAcquire()
+            {
+                auto pos = m_enqueuePos.load(std::memory_order_relaxed);
+                for (;;)
+                {
+                    Slot* slot = &m_slots[pos & m_mask];
+                    const auto sequence = slot->m_sequence.load(std::memory_order_acquire);
+                    const auto diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos);
+
+                    if (0 == diff)
+                    {
+                        if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) return slot;
+                    }
+                    else if (diff < 0)
+                    {
+                        return nullptr;
+                    }
+                    else
+                    {
+                        pos = m_enqueuePos.load(std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            /**
+             * @brief       publish
+             * @param[in]   slot: slot claimed by the calling thread, its value filled
+             * @details     Hands the slot's value over to the consumer
+             */
+            void publish(Slot* slot)
+            {
+                const auto pos = slot->m_sequence.load(std::memory_order_relaxed);
+                slot->m_sequence.store(pos + 1, std::memory_order_release);
+            }
+
+            /**
+             * @brief   front
+             * @return  Returns the next published value, or nullptr if none. Called by the consumer only
+             */
+            Type* front()
+            {
+                Slot& slot = m_slots[m_dequeuePos & m_mask];
+                if (slot.m_sequence.load(std::memory_order_acquire) != m_dequeuePos + 1) return nullptr;
+                return &slot.m_value;
+            }
+
+            /**
+             * @brief   pop
+             * @details Frees the slot of the value returned by front. Called by the consumer only
+             */
+            void pop()
+            {
+                m_slots[m_dequeuePos & m_mask].m_sequence.store(m_dequeuePos + m_capacity, std::memory_order_release);
+                ++m_dequeuePos;
+            }
+
+            /**
+             * @brief   ready
+             * @return  true if the next value is published, false otherwise. Called by the consumer only.
+             *          Sequentially consistent, so that a consumer going to sleep may pair it with a producer's fence
+             */
+            bool ready() const
+            {
+                return m_slots[m_dequeuePos & m_mask].m_sequence.load(std::memory_order_seq_cst) == m_dequeuePos + 1;
+            }
+
+            /**
+             * @brief   enqueued
+             * @return  Returns the number of slots claimed so far
+             */
+            std::size_t enqueued() const
+            {
+                return m_enqueuePos.load(std::memory_order_acquire);
+            }
+
+            /**
+             * @brief   dequeued
+             * @return  Returns the number of values popped so far. Called by the consumer only
+             */
+            std::size_t dequeued() const
+            {
+                return m_dequeuePos;
+            }
+
+            std::size_t capacity() const
+            {
+                return m_capacity;
+            }
+
+        private:
+            const std::size_t m_capacity;
+            const std::size_t m_mask;
+            std::unique_ptr<Slot[]> m_slots;
+
+            /**
+             * @brief   m_dequeuePos
+             * @details Position of the next value to consume, owned by the consumer
+             */
+            alignas(64) std::size_t m_dequeuePos = 0;
+
+            alignas(64) std::atomic<std::size_t> m_enqueuePos{ 0 };
+        };
+    }
+}
+
+#endif
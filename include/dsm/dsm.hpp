@@ -4,17 +4,24 @@
 #include "log.hpp"
 
 #include <string>
+#include <string_view>
 #include <sstream>
 #include <ostream>
 #include <functional>
 #include <typeindex>
+#include <atomic>
+#include <limits>
 #include <map>
-#include <queue>
-#include <deque>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <optional>
 #include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
 #include <type_traits>
+#include <utility>
 
 /**
  * Test for non-portable GNU extension compatibility.
@@ -39,22 +46,43 @@
 #define DSM_LOGGER Log::EmptyLogger
 #endif
 
-#define LOG_DSM(severity, error)  Log::Logger<DSM_LOGGER>::GetInstance()->writeLog(DSM_LOGMODULE, severity, error)
+#ifndef DSM_LOG_LEVEL
+#define DSM_LOG_LEVEL Log::eDebug
+#endif
+
+/**
+ * Log points are filtered out at compile time when below DSM_LOG_LEVEL or when DSM_LOGGER is the EmptyLogger,
+ * then at runtime against Log::Logger<DSM_LOGGER>::SetLevel. Both checks take place before any formatting
+ */
+#define DSM_LOG_ENABLED(severity) ((severity) >= (DSM_LOG_LEVEL) && Log::is_enabled_v<DSM_LOGGER>)
+
+#define LOG_DSM(severity, error) do { if constexpr (DSM_LOG_ENABLED(severity)) { \
+if (Log::Logger<DSM_LOGGER>::IsEnabled(severity)) Log::Logger<DSM_LOGGER>::GetInstance()->writeLog(DSM_LOGMODULE, severity, error); } } while (false)
+
+#define LOG_FORMAT_DSM(severity, ...) do { if constexpr (DSM_LOG_ENABLED(severity)) { \
+if (Log::Logger<DSM_LOGGER>::IsEnabled(severity)) { Log::LocalLine dsmLogLine; dsmLogLine.stream() << __VA_ARGS__; \
+Log::Logger<DSM_LOGGER>::GetInstance()->writeLog(DSM_LOGMODULE, severity, dsmLogLine.stream().view()); } } } while (false)
+
+#define LOG_DEBUG_DSM(...) LOG_FORMAT_DSM(Log::eDebug, __VA_ARGS__)
+
+#define LOG_INFO_DSM(...) LOG_FORMAT_DSM(Log::eInfo, __VA_ARGS__)
 
-#define LOG_DEBUG_DSM(...) { std::stringstream ss; ss << __VA_ARGS__; \
-Log::Logger<DSM_LOGGER>::GetInstance()->writeLog(DSM_LOGMODULE, Log::eDebug, ss.str()); }
+#define LOG_WARNING_DSM(...) LOG_FORMAT_DSM(Log::eWarning, __VA_ARGS__)
 
-#define LOG_INFO_DSM(...)  { std::stringstream ss; ss << __VA_ARGS__; \
-Log::Logger<DSM_LOGGER>::GetInstance()->writeLog(DSM_LOGMODULE, Log::eInfo, ss.str()); }
+#define LOG_ERROR_DSM(...) LOG_FORMAT_DSM(Log::eError, __VA_ARGS__)
 
-#define LOG_WARNING_DSM(...) { std::stringstream ss; ss << __VA_ARGS__; \
-Log::Logger<DSM_LOGGER>::GetInstance()->writeLog(DSM_LOGMODULE, Log::eWarning, ss.str()); }
+#define LOG_FATAL_DSM(...) LOG_FORMAT_DSM(Log::eFatal, __VA_ARGS__)
 
-#define LOG_ERROR_DSM(...) { std::stringstream ss; ss << __VA_ARGS__; \
-Log::Logger<DSM_LOGGER>::GetInstance()->writeLog(DSM_LOGMODULE, Log::eError, ss.str()); }
+#ifndef DSM_TRACER
+#define DSM_TRACER Log::EmptyTracer
+#endif
 
-#define LOG_FATAL_DSM(...) { std::stringstream ss; ss << __VA_ARGS__; \
-Log::Logger<DSM_LOGGER>::GetInstance()->writeLog(DSM_LOGMODULE, Log::eFatal, ss.str()); }
+/**
+ * Events up to this size are stored inline when posted or deferred. Larger events are stored in per-type pools
+ */
+#ifndef DSM_EVENT_INLINE_SIZE
+#define DSM_EVENT_INLINE_SIZE 64
+#endif
 
 namespace dsm
 {
@@ -73,14 +101,19 @@ namespace dsm
     namespace details
     {
         class TransitionBase;
-        template <typename EventType>
-        struct Transition;
+        class EventEnvelope;
         struct PostedTransition;
+        class FlatMachine;
+        class Layout;
+        struct Runtime;
     }
 
     // Types aliases
+    using TEventId = std::size_t;
+    using TStateId = std::size_t;
     using TStates = std::vector<StateBase*>;
     using TTransitions = std::vector<details::TransitionBase*>;
+    using TDeferredEvents = std::vector<TEventId>;
     using THistory = std::optional<History>;
     template <typename StateType, typename EventType>
     using TGuard = bool(StateType::*)(const EventType&);
@@ -122,6 +155,26 @@ namespace dsm
         virtual void visit(const StateBase* state) = 0;
     };
 
+    /**
+     * @brief   IRegionScheduler
+     * @details Interface running the independent orthogonal regions of a state concurrently, see StateMachine::setRegionScheduler
+     */
+    struct IRegionScheduler
+    {
+        using TTask = void(*)(void* context, std::size_t index);
+
+        virtual ~IRegionScheduler() = default;
+
+        /**
+         * @brief       run
+         * @param[in]   count: number of tasks
+         * @param[in]   task: the task, called with each index in [0, count). It does not throw
+         * @param[in]   context: the task's context
+         * @details     Runs the tasks, possibly concurrently, and returns once all of them completed
+         */
+        virtual void run(std::size_t count, TTask task, void* context) = 0;
+    };
+
     /**
      * @brief   History
      * @details History type: either Shallow or Deep history
@@ -137,7 +190,7 @@ namespace dsm
 
     /**
      * @brief   EventBase
-     * @details Base class for all Events. Holds the type index of the final subclass
+     * @details Base class for all Events. Holds the dense identifier of the final subclass
      */
     class EventBase
     {
@@ -150,32 +203,41 @@ namespace dsm
         template <typename DerivedType>
         friend class Event;
 
-        friend struct details::PostedTransition;
+        friend class details::EventEnvelope;
 
-        /**
-         * @brief   m_index
-         * @details Event's type index
-         */
-        std::type_index m_index;
+        friend class details::FlatMachine;
+
+        friend class details::Layout;
+
+        template <typename SmType, typename StoreType>
+        friend class StateMachine;
 
-    protected:
         /**
-         * @brief   m_name
-         * @details Event's name
+         * @brief   m_id
+         * @details Event's type identifier
          */
-        std::string m_name;
+        TEventId m_id;
 
-        EventBase(const std::type_index& index)
-            : m_index{ index }
+    protected:
+        explicit EventBase(TEventId id)
+            : m_id{ id }
         {}
 
     public:
         virtual ~EventBase() {}
 
-    private:
-        virtual bool apply(details::TransitionBase* pTransition) const = 0;
+        /**
+         * @brief   name
+         * @return  Returns the event's type name
+         */
+        virtual std::string_view name() const = 0;
 
-        virtual EventBase* clone() const = 0;
+    private:
+        /**
+         * @brief       cloneInto
+         * @param[out]  envelope: envelope receiving a copy of this event
+         */
+        virtual void cloneInto(details::EventEnvelope& envelope) const = 0;
     };
 
     // Implementation details (not supposed to be used by client code)
@@ -262,13 +324,87 @@ namespace dsm
         template <typename Type>
         static const std::type_index Index()
         {
-            static_assert(details::is_event_v<Type> || is_state_v<Type>, "Type must inherit either from Event or State");
+            static_assert(is_state_v<Type>, "Type must inherit from State");
             return std::type_index(typeid(typename Type::Derived));
         }
 
-        static const std::type_index Index()
+        /**
+         * @brief   InvalidEventId
+         * @details Identifier that no event type can hold
+         */
+        inline constexpr TEventId InvalidEventId = std::numeric_limits<TEventId>::max();
+
+        /**
+         * @brief   UnknownConfiguration
+         * @details Configuration identifier of a flat machine no longer tracking the active configuration
+         */
+        inline constexpr std::size_t UnknownConfiguration = std::numeric_limits<std::size_t>::max();
+
+        /**
+         * @brief   TNodeIndex
+         * @details Index of a state or a region in the top-sm's contiguous layout
+         */
+        using TNodeIndex = std::uint32_t;
+
+        /**
+         * @brief   InvalidNode
+         * @details Node index of a region without current sub-state, or of a state added since the layout was built
+         */
+        inline constexpr TNodeIndex InvalidNode = std::numeric_limits<TNodeIndex>::max();
+
+        /**
+         * @brief   TypeIds
+         * @details Allocates dense, process-wide identifiers to types, independently for each Category
+         */
+        template <typename Category>
+        struct TypeIds
+        {
+            /**
+             * @brief   Next
+             * @details Allocates a new identifier
+             * @return  Returns the allocated identifier
+             */
+            static std::size_t Next()
+            {
+                static std::atomic<std::size_t> counter{ 0 };
+                return counter.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            /**
+             * @brief   Of
+             * @details Holds the identifier allocated to DerivedType, once and for all
+             * @return  Returns DerivedType's identifier
+             */
+            template <typename DerivedType>
+            static std::size_t Of()
+            {
+                static const std::size_t id = Next();
+                return id;
+            }
+        };
+
+        /**
+         * @brief   EventId
+         * @details Transforms an event Type into a dense, process-wide identifier that may be used as an array index
+         * @return  Returns the Type's identifier
+         */
+        template <typename Type>
+        TEventId EventId()
+        {
+            static_assert(details::is_event_v<Type>, "Type must inherit from Event");
+            return TypeIds<EventBase>::Of<typename Type::Derived>();
+        }
+
+        /**
+         * @brief   StateId
+         * @details Transforms a state Type into a dense, process-wide identifier that may be used as an array index
+         * @return  Returns the Type's identifier
+         */
+        template <typename Type>
+        TStateId StateId()
         {
-            return std::type_index(typeid(void));
+            static_assert(details::is_state_v<Type>, "Type must inherit from State");
+            return TypeIds<StateBase>::Of<typename Type::Derived>();
         }
 
         /**
@@ -287,15 +423,27 @@ namespace dsm
             return name;
         }
 
+        /**
+         * @brief   StaticName
+         * @details Retrieves Type's name, computed once and for all on first call
+         * @return  Returns a view on the Types's name, valid until program exit
+         */
+        template <typename Type>
+        std::string_view StaticName()
+        {
+            static const std::string name = Name<Type>();
+            return name;
+        }
+
         /**
          * @brief   CheckIndex
          * @details Checks whether Type and provided type_index are matching
          * @return  True if there's a match, false otherwise
          */
         template <typename Type>
-        static constexpr bool CheckIndex(const std::type_index& index)
+        static bool CheckIndex(const std::type_index& index)
         {
-            static_assert(details::is_event_v<Type> || is_state_v<Type>, "Type must inherit either from Event or State");
+            static_assert(is_state_v<Type>, "Type must inherit from State");
             return index == Index<Type>();
         }
 
@@ -303,7 +451,8 @@ namespace dsm
 
         /**
          * @brief   TransitionBase
-         * @details Base class for all transitions. Holds the type index of the final subclass
+         * @details Base class for all transitions. Holds the identifier of the triggering event type,
+         *          and the function executing the transition, so that a dispatch costs a single indirect call
          */
         class TransitionBase
         {
@@ -316,7 +465,8 @@ namespace dsm
             template <typename SmType, typename StoreType>
             friend class dsm::StateMachine;
 
-            friend struct PostedTransition;
+            friend class FlatMachine;
+            friend class Layout;
 
             /**
                 * @brief   m_srcState
@@ -325,1260 +475,3768 @@ namespace dsm
             dsm::StateBase* m_srcState = nullptr;
 
             /**
-                * @brief   m_index
-                * @details Transition's type index
+                * @brief   m_dstState
+                * @details The transition's destination state, nullptr for internal transitions
+                */
+            dsm::StateBase* m_dstState = nullptr;
+
+            /**
+                * @brief   m_eventId
+                * @details Transition's triggering event identifier
                 */
-            std::type_index m_index;
+            TEventId m_eventId;
 
         protected:
-            explicit TransitionBase(const std::type_index& index)
-                : m_index{ index }
+            using TExecFunc = bool(*)(const TransitionBase* transition, Runtime& runtime, const EventBase& evt);
+            using TFireFunc = bool(*)(const TransitionBase* transition, const EventBase& evt);
+
+            /**
+                * @brief   m_exec
+                * @details Executes the transition with an event of type m_eventId
+                */
+            TExecFunc m_exec = nullptr;
+
+            /**
+                * @brief   m_fire
+                * @details Calls the transition's guard and action only, leaving the exit and entry sequence to the caller
+                */
+            TFireFunc m_fire = nullptr;
+
+            TransitionBase(TEventId eventId, TExecFunc exec, TFireFunc fire)
+                : m_eventId{ eventId }
+                , m_exec{ exec }
+                , m_fire{ fire }
             {}
 
         public:
             virtual ~TransitionBase() {}
-        };
-
-        /**
-         * @brief   Transition
-         * @details CRTP base class. Allows type index initialization
-         */
-        template <typename EventType>
-        struct Transition : public TransitionBase
-        {
-            using TCallbackFunc = std::function<bool(const EventType&)>;
 
             /**
-             * @brief   m_cb
-             * @details The stored function object
+             * @brief   exec
+             * @details Executes the transition on the provided runtime with the provided event, whose type identifier must be m_eventId
              */
-            TCallbackFunc m_cb;
-
-            explicit Transition(const TCallbackFunc& cb)
-                : TransitionBase{ Index<EventType>() }
-                , m_cb{ cb }
+            bool exec(Runtime& runtime, const EventBase& evt) const
             {
-                static_assert(details::is_event_v<EventType>, "EventType must inherit from Event");
+                return m_exec(this, runtime, evt);
             }
 
-            virtual ~Transition() {}
-
             /**
-             * @brief   exec
-             * @details Executes the transition with the provided event.
+             * @brief   fire
+             * @details Calls the transition's guard and action with the provided event, whose type identifier must be m_eventId
+             * @return  true if the guard passed, false otherwise
              */
-            bool exec(const EventType& evt)
+            bool fire(const EventBase& evt) const
             {
-                return m_cb(evt);
+                return m_fire(this, evt);
             }
         };
 
         /**
-         * @brief   Transition
-         * @details CRTP base class. Allows type index initialization
+         * @brief   EventPool
+         * @details Per-thread free list of blocks able to hold an EventType, so that pooled events are only allocated
+         *          until the pool reaches its steady state. Each block records the pool of the thread that allocated it.
+         *          Blocks released by another thread are handed back to that pool through a lock-free list, which the
+         *          allocating thread takes over as a whole once its own free list runs dry
          */
-        template <>
-        struct Transition<void> : public TransitionBase
+        template <typename EventType>
+        class EventPool
         {
-            using TCallbackFunc = std::function<bool()>;
+        public:
+            static void* Allocate()
+            {
+                if (false == Destroyed())
+                {
+                    auto& blocks = Blocks();
+                    if (nullptr == blocks.m_free) blocks.adopt(blocks.m_home->m_returned.exchange(nullptr, std::memory_order_acquire));
+
+                    if (Link* link = blocks.m_free)
+                    {
+                        blocks.m_free = link->m_next;
+                        --blocks.m_size;
+                        return link;
+                    }
+
+                    ++blocks.m_live;
+                    return NewBlock(blocks.m_home);
+                }
+
+                return NewBlock(nullptr);
+            }
+
+            static void Release(void* block)
+            {
+                Home* home = HomeOf(block);
+
+                // The calling thread's pool is already gone when releasing from a thread_local or static destructor
+                if (false == Destroyed() && Blocks().m_home == home)
+                {
+                    auto& blocks = Blocks();
+                    if (blocks.m_size < MaxBlocks)
+                    {
+                        auto link = new (block) Link{ blocks.m_free };
+                        blocks.m_free = link;
+                        ++blocks.m_size;
+                    }
+                    else
+                    {
+                        --blocks.m_live;
+                        Deallocate(block);
+                    }
+                    return;
+                }
+
+                if (nullptr == home)
+                {
+                    Deallocate(block);
+                    return;
+                }
+
+                home->giveBack(block);
+            }
+
+        private:
+            static constexpr std::size_t MaxBlocks = 1024;
 
             /**
-             * @brief   m_cb
-             * @details The stored function object
+             * @brief   HeaderSize
+             * @details Room in front of each block for its pool, keeping the block aligned for EventType
              */
-            TCallbackFunc m_cb;
+            static constexpr std::size_t HeaderSize = std::max(alignof(EventType), alignof(std::max_align_t));
+            static constexpr std::size_t BlockSize = HeaderSize + std::max(sizeof(EventType), sizeof(void*));
 
-            explicit Transition(const TCallbackFunc& cb)
-                : TransitionBase{ Index() }
-                , m_cb{ cb }
-            {}
+            static_assert(HeaderSize >= sizeof(void*), "EventPool header must hold a pointer");
 
-            virtual ~Transition() {}
+            /**
+             * @brief   Link
+             * @details Free block, linked in place of the event it held
+             */
+            struct Link
+            {
+                Link* m_next = nullptr;
+            };
 
             /**
-             * @brief   exec
-             * @details Executes the transition.
+             * @brief   Home
+             * @details Pool of a thread, as seen from the others. Outlives its thread as long as some of its blocks are not released
              */
-            bool exec()
+            struct Home
             {
-                return m_cb();
-            }
-        };
+                /**
+                 * @brief   m_returned
+                 * @details Blocks released by other threads, or Closed() once the thread is gone
+                 */
+                std::atomic<Link*> m_returned{ nullptr };
+
+                /**
+                 * @brief   m_orphans
+                 * @details Blocks still held by other threads once the thread is gone, minus those released meanwhile
+                 */
+                std::atomic<std::ptrdiff_t> m_orphans{ 0 };
+
+                void giveBack(void* block)
+                {
+                    auto link = new (block) Link{ m_returned.load(std::memory_order_relaxed) };
+                    while (link->m_next != Closed())
+                    {
+                        if (true == m_returned.compare_exchange_weak(link->m_next, link, std::memory_order_release, std::memory_order_relaxed)) return;
+                    }
 
-        struct PostedTransition
-        {
-            PostedTransition() = default;
+                    Deallocate(block);
+                    if (1 == m_orphans.fetch_sub(1, std::memory_order_acq_rel)) delete this;
+                }
+            };
 
-            explicit PostedTransition(dsm::EventBase* evt, bool deferred = false)
-                : m_evt{ evt }
-                , m_deferred{ deferred }
-            {}
+            struct FreeList
+            {
+                ~FreeList()
+                {
+                    adopt(m_home->m_returned.exchange(Closed(), std::memory_order_acquire));
+                    while (Link* link = m_free)
+                    {
+                        m_free = link->m_next;
+                        Deallocate(link);
+                        --m_live;
+                    }
 
-            explicit PostedTransition(TransitionBase* transition, bool deferred = false)
-                : m_transition{ transition }
-                , m_deferred{ deferred }
-            {}
+                    // Blocks released from now on are deallocated by their releasing thread, the last one deleting the home
+                    const auto orphans = static_cast<std::ptrdiff_t>(m_live);
+                    if (0 == orphans + m_home->m_orphans.fetch_add(orphans, std::memory_order_acq_rel)) delete m_home;
+
+                    Destroyed() = true;
+                }
+
+                void adopt(Link* list)
+                {
+                    while (Link* link = list)
+                    {
+                        list = link->m_next;
+                        link->m_next = m_free;
+                        m_free = link;
+                        ++m_size;
+                    }
+                }
+
+                Home* m_home = new Home;
+                Link* m_free = nullptr;
+                std::size_t m_size = 0;     // Blocks in m_free
+                std::size_t m_live = 0;     // Blocks allocated from m_home and not deallocated yet
+            };
 
-            virtual ~PostedTransition()
+            static FreeList& Blocks()
             {
-                delete m_evt;
-                m_evt = nullptr;
-                delete m_transition;
-                m_transition = nullptr;
+                thread_local FreeList blocks;
+                return blocks;
             }
 
-            PostedTransition(const PostedTransition&) = delete;
-            PostedTransition& operator=(const PostedTransition&) = delete;
-
-            PostedTransition(PostedTransition&& other)
+            static bool& Destroyed()
             {
-                swap(std::move(other));
+                // Trivially destructible, hence still readable after the free list's destruction
+                thread_local bool destroyed{ false };
+                return destroyed;
             }
 
-            PostedTransition& operator=(PostedTransition&& other)
+            static Link* Closed()
             {
-                swap(std::move(other));
-                return *this;
+                static Link closed;
+                return &closed;
             }
 
-            void swap(PostedTransition&& other)
+            static Home*& HomeOf(void* block)
             {
-                std::swap(m_evt, other.m_evt);
-                std::swap(m_transition, other.m_transition);
-                std::swap(m_deferred, other.m_deferred);
+                return *reinterpret_cast<Home**>(static_cast<char*>(block) - HeaderSize);
             }
 
-            dsm::EventBase* m_evt = nullptr;
+            static void* NewBlock(Home* home)
+            {
+                void* memory = nullptr;
+                if constexpr (HeaderSize > __STDCPP_DEFAULT_NEW_ALIGNMENT__) memory = ::operator new(BlockSize, std::align_val_t{ HeaderSize });
+                else memory = ::operator new(BlockSize);
 
-            TransitionBase* m_transition = nullptr;
+                void* block = static_cast<char*>(memory) + HeaderSize;
+                HomeOf(block) = home;
+                return block;
+            }
 
-            bool m_deferred = false;
+            static void Deallocate(void* block)
+            {
+                void* memory = static_cast<char*>(block) - HeaderSize;
+                if constexpr (HeaderSize > __STDCPP_DEFAULT_NEW_ALIGNMENT__) ::operator delete(memory, std::align_val_t{ HeaderSize });
+                else ::operator delete(memory);
+            }
         };
 
-        // Exceptions
-
         /**
-        * @brief   SmError
-        * @details StateMachine's exception
-        */
-        struct SmError : public std::exception
+         * @brief   EventEnvelope
+         * @details Owning, type-erased holder of a copy of an event.
+         *          Events up to DSM_EVENT_INLINE_SIZE bytes are stored inline, larger or over-aligned ones in their EventPool.
+         *          Moving an envelope moves an inline event, or steals a pooled one, without any allocation
+         */
+        class EventEnvelope
         {
-            /**
-            * @brief   m_msg
-            * @details The exception's message
-            */
-            mutable std::string m_msg;
-            std::stringstream m_sstr;
+        public:
+            static constexpr std::size_t InlineSize = DSM_EVENT_INLINE_SIZE;
 
-            SmError() = default;
-            virtual ~SmError() = default;
-            SmError(SmError&&) = default;
-            SmError& operator=(SmError&&) = default;
+            EventEnvelope() = default;
 
-            SmError(const SmError& other)
+            EventEnvelope(const EventEnvelope&) = delete;
+            EventEnvelope& operator=(const EventEnvelope&) = delete;
+
+            EventEnvelope(EventEnvelope&& other)
             {
-                m_sstr << other.m_sstr.rdbuf();
+                moveFrom(other);
             }
 
-            SmError& operator=(const SmError& other)
+            EventEnvelope& operator=(EventEnvelope&& other)
             {
-                m_sstr << other.m_sstr.rdbuf();
+                if (this != &other)
+                {
+                    reset();
+                    moveFrom(other);
+                }
+
                 return *this;
             }
 
-            SmError& operator<<(const char* msg)
+            ~EventEnvelope()
             {
-                m_sstr << msg;
-                return *this;
+                reset();
             }
 
-            SmError& operator<<(const std::string& msg)
+            /**
+             * @brief   IsInline
+             * @return  true if EventType is stored inline, false if pooled
+             */
+            template <typename EventType>
+            static constexpr bool IsInline()
             {
-                return *this << msg.c_str();
+                return sizeof(EventType) <= InlineSize && alignof(EventType) <= alignof(std::max_align_t);
             }
 
             /**
-            * @brief   what
-            * @details Retrieves the exception's message
-            */
-            const char* what() const noexcept override
+             * @brief       emplace
+             * @param[in]   evt: event to copy into the envelope, replacing the current one if any
+             */
+            template <typename EventType>
+            void emplace(const EventType& evt)
             {
-                // Storing msg is needed because std::stringstream::str returns a temporary object
-                m_msg = m_sstr.str();
-                return m_msg.c_str();
+                reset();
+
+                if constexpr (IsInline<EventType>())
+                {
+                    m_evt = new (m_storage) EventType(evt);
+                    m_manage = &ManageInline<EventType>;
+                }
+                else
+                {
+                    void* block = EventPool<EventType>::Allocate();
+                    try
+                    {
+                        m_evt = new (block) EventType(evt);
+                    }
+                    catch (...)
+                    {
+                        EventPool<EventType>::Release(block);
+                        throw;
+                    }
+                    m_manage = &ManagePooled<EventType>;
+                }
             }
-        };
-    }
 
-    /**
-     * @brief   Event
-     * @details CRTP base class for Events. Allows type index initialization
-     */
-    template <typename DerivedType>
-    class Event : public EventBase
-    {
-    private:
-        template <typename OtherDerivedType, typename SmType>
-        friend class State;
+            /**
+             * @brief       assign
+             * @param[in]   evt: event to copy into the envelope, whatever its dynamic type, replacing the current one if any
+             */
+            void assign(const dsm::EventBase& evt)
+            {
+                evt.cloneInto(*this);
+            }
 
-    public:
-        using Derived = DerivedType;
+            /**
+             * @brief   reset
+             * @details Destroys the held event if any
+             */
+            void reset()
+            {
+                if (m_manage != nullptr) m_manage(Operation::Destroy, *this, nullptr);
+                m_evt = nullptr;
+                m_manage = nullptr;
+            }
 
-        const std::string& name() const { return m_name; }
+            const dsm::EventBase* get() const
+            {
+                return m_evt;
+            }
 
-    protected:
-        Event() :
-            EventBase{ details::Index<DerivedType>() }
-        {
-            static_assert(std::is_base_of_v<Event<DerivedType>, DerivedType>, "DerivedType must inherit from Event");
-            static_assert(std::is_copy_constructible_v<DerivedType>, "DerivedType must be copy constructible");
-            this->m_name = details::Name<DerivedType>();
-        }
+            explicit operator bool() const
+            {
+                return m_evt != nullptr;
+            }
 
-        virtual ~Event() {}
+        private:
+            enum class Operation
+            {
+                Destroy,
+                Move
+            };
 
-    private:
-        DerivedType& derived()
-        {
-            return static_cast<DerivedType&>(*this);
-        }
+            /**
+             * @brief   TManageFunc
+             * @details Destroys the event held by the source envelope, after moving it into the destination envelope if requested
+             */
+            using TManageFunc = void(*)(Operation operation, EventEnvelope& src, EventEnvelope* dst);
 
-        const DerivedType& derived() const
-        {
-            return static_cast<const DerivedType&>(*this);
-        }
+            template <typename EventType>
+            static void ManageInline(Operation operation, EventEnvelope& src, EventEnvelope* dst)
+            {
+                auto evt = static_cast<EventType*>(src.m_evt);
+                if (Operation::Move == operation) dst->m_evt = new (dst->m_storage) EventType(std::move(*evt));
+                evt->~EventType();
+            }
 
-        EventBase* clone() const override
-        {
-            return new DerivedType(derived());
-        }
+            template <typename EventType>
+            static void ManagePooled(Operation operation, EventEnvelope& src, EventEnvelope* dst)
+            {
+                if (Operation::Move == operation)
+                {
+                    dst->m_evt = src.m_evt;
+                    return;
+                }
 
-        bool apply(details::TransitionBase* pTransition) const override
-        {
-            return static_cast<details::Transition<DerivedType>*>(pTransition)->exec(derived());
-        }
-    };
+                auto evt = static_cast<EventType*>(src.m_evt);
+                evt->~EventType();
+                EventPool<EventType>::Release(evt);
+            }
 
-    /**
-     * @brief   StateBase
-     * @details Base class for all States.
-     *          - Holds the type index of the final subclass
-     *          - Holds the state name
-     *          - Holds the region index it belongs to
-     *          - Holds the inner regions
-     *          - Holds the transitions
-     *          - Holds the defered events
-     *          - Provides a link to the parent state and to the top state (i.e. the StateMachine)
-     */
-    class StateBase
-    {
-    private:
-        template <typename DerivedType, typename SmType>
-        friend class State;
+            void moveFrom(EventEnvelope& other)
+            {
+                if (nullptr == other.m_manage) return;
 
-        template <typename SmType, typename StoreType>
-        friend class StateMachine;
+                other.m_manage(Operation::Move, other, this);
+                m_manage = other.m_manage;
+                other.m_evt = nullptr;
+                other.m_manage = nullptr;
+            }
+
+            /**
+             * @brief   m_storage
+             * @details Inline storage
+             */
+            alignas(std::max_align_t) unsigned char m_storage[InlineSize];
+
+            /**
+             * @brief   m_evt
+             * @details The held event, either in m_storage or in a pooled block
+             */
+            dsm::EventBase* m_evt = nullptr;
+
+            /**
+             * @brief   m_manage
+             * @details Type-specific destroy and move operations
+             */
+            TManageFunc m_manage = nullptr;
+        };
 
         /**
-         * @brief   TransitionData
-         * @details Data associated to a transition
+         * @brief   RingQueue
+         * @details FIFO queue over a contiguous ring buffer. Its capacity doubles when full and never shrinks,
+         *          so that it stops allocating once it has reached the peak queue depth
          */
-        struct TransitionData
+        template <typename Type>
+        class RingQueue
         {
-            /**
-             * @brief   commonAncestor
-             * @details The common ancestor of both source state and destination state. In the simplest case, this corresponds to the source and destination's parent
-             */
-            StateBase* commonAncestor = nullptr;
+        public:
+            explicit RingQueue(std::size_t capacity = 16)
+            {
+                reserve(capacity);
+            }
+
+            RingQueue(const RingQueue&) = delete;
+            RingQueue& operator=(const RingQueue&) = delete;
+
+            ~RingQueue()
+            {
+                clear();
+                if (m_buffer != nullptr) m_allocator.deallocate(m_buffer, m_capacity);
+            }
+
+            template <typename ...Args>
+            void emplace(Args&&... args)
+            {
+                if (m_size == m_capacity) reserve(2 * m_capacity);
+
+                new (&m_buffer[(m_head + m_size) & (m_capacity - 1)]) Type(std::forward<Args>(args)...);
+                ++m_size;
+            }
 
             /**
-             * @brief   srcOutermost
-             * @details The outermost state containing the source state. In the simplest case, this corresponds to the source state itself
+             * @brief   pop
+             * @details Removes the front element
+             * @return  Returns the removed element
              */
-            StateBase* srcOutermost = nullptr;
+            Type pop()
+            {
+                Type& front = m_buffer[m_head];
+                Type res{ std::move(front) };
+                front.~Type();
+                m_head = (m_head + 1) & (m_capacity - 1);
+                --m_size;
+                return res;
+            }
+
+            Type& front()
+            {
+                return m_buffer[m_head];
+            }
 
             /**
-             * @brief   dstOutermost
-             * @details The outermost state containing the destination state. In the simplest case, this corresponds to the destination state itself
+             * @brief       at
+             * @param[in]   index: position from the front, lower than size
+             * @return      Returns the element at the provided position
              */
-            StateBase* dstOutermost = nullptr;
+            const Type& at(std::size_t index) const
+            {
+                return m_buffer[(m_head + index) & (m_capacity - 1)];
+            }
+
+            void clear()
+            {
+                while (m_size > 0) pop();
+                m_head = 0;
+            }
+
+            bool empty() const
+            {
+                return 0 == m_size;
+            }
+
+            std::size_t size() const
+            {
+                return m_size;
+            }
+
+            std::size_t capacity() const
+            {
+                return m_capacity;
+            }
+
+        private:
+            void reserve(std::size_t capacity)
+            {
+                std::size_t newCapacity = 1;
+                while (newCapacity < capacity) newCapacity <<= 1;
+                if (newCapacity <= m_capacity) return;
+
+                Type* buffer = m_allocator.allocate(newCapacity);
+                for (std::size_t i = 0; i < m_size; ++i)
+                {
+                    Type& element = m_buffer[(m_head + i) & (m_capacity - 1)];
+                    new (&buffer[i]) Type(std::move(element));
+                    element.~Type();
+                }
+
+                if (m_buffer != nullptr) m_allocator.deallocate(m_buffer, m_capacity);
+
+                m_buffer = buffer;
+                m_capacity = newCapacity;
+                m_head = 0;
+            }
+
+            std::allocator<Type> m_allocator;
+            Type* m_buffer = nullptr;
+            std::size_t m_capacity = 0;
+            std::size_t m_head = 0;
+            std::size_t m_size = 0;
+        };
+
+        /**
+         * @brief   NodeList
+         * @details Doubly linked list with O(1) removal of any node. Removed nodes are kept for reuse, hence
+         *          the list stops allocating once it has reached its peak size. Type must be default constructible
+         */
+        template <typename Type>
+        class NodeList
+        {
+        public:
+            struct Node
+            {
+                Type m_value;
+                Node* m_prev = nullptr;
+                Node* m_next = nullptr;
+            };
+
+            NodeList() = default;
+
+            NodeList(const NodeList&) = delete;
+            NodeList& operator=(const NodeList&) = delete;
+
+            ~NodeList()
+            {
+                clear();
+                while (m_free != nullptr) delete std::exchange(m_free, m_free->m_next);
+            }
 
             /**
-             * @brief   src
-             * @details The source state
+             * @brief       push_back
+             * @param[in]   value: the value to append
+             * @return      Returns the node holding the value
              */
-            StateBase* src = nullptr;
+            Node* push_back(Type&& value)
+            {
+                Node* node = m_free;
+                if (node != nullptr)
+                {
+                    m_free = node->m_next;
+                    node->m_value = std::move(value);
+                }
+                else
+                {
+                    node = new Node{ std::move(value) };
+                }
+
+                node->m_prev = m_tail;
+                node->m_next = nullptr;
+                if (m_tail != nullptr) m_tail->m_next = node;
+                else m_head = node;
+                m_tail = node;
+                ++m_size;
+
+                return node;
+            }
 
             /**
-             * @brief   dst
-             * @details The destination state
+             * @brief       erase
+             * @param[in]   node: the node to remove
+             * @return      Returns the node following the removed one
              */
-            StateBase* dst = nullptr;
+            Node* erase(Node* node)
+            {
+                Node* next = node->m_next;
+
+                if (node->m_prev != nullptr) node->m_prev->m_next = next;
+                else m_head = next;
+                if (next != nullptr) next->m_prev = node->m_prev;
+                else m_tail = node->m_prev;
+                --m_size;
+
+                // Release the value's resources now rather than on reuse
+                node->m_value = Type{};
+                node->m_prev = nullptr;
+                node->m_next = m_free;
+                m_free = node;
+
+                return next;
+            }
+
+            void clear()
+            {
+                while (m_head != nullptr) erase(m_head);
+            }
+
+            Node* front() const
+            {
+                return m_head;
+            }
+
+            bool empty() const
+            {
+                return 0 == m_size;
+            }
+
+            std::size_t size() const
+            {
+                return m_size;
+            }
+
+        private:
+            Node* m_head = nullptr;
+            Node* m_tail = nullptr;
+            Node* m_free = nullptr;
+            std::size_t m_size = 0;
         };
 
         /**
-         * @brief   Region
-         * @details Region inside a state. Holds pointers to the entry point state, the current state and the last visited state
+         * @brief   DeferralEpochs
+         * @details Configuration epochs driving the retry of deferred events. The epoch increments on each state entry and exit.
+         *          A deferred event is only retried once a state handling its identifier has been entered, or the last active state
+         *          deferring it has been exited, since its last try. Also counts the active states deferring each event identifier
          */
-        struct Region
+        struct DeferralEpochs
         {
             /**
-             * @brief   m_index
-             * @details The region's index
+             * @brief   m_epoch
+             * @details Current configuration epoch
              */
-            int m_index;
+            std::uint64_t m_epoch = 0;
 
             /**
-             * @brief   m_parentState
-             * @details The region's parent state
+             * @brief   m_retried
+             * @details Configuration epoch of the last retry of deferred events
              */
-            StateBase* m_parentState = nullptr;
+            std::uint64_t m_retried = 0;
 
             /**
-             * @brief   m_entryState
-             * @details The entry sub-state
+             * @brief   m_deferred
+             * @details Number of deferred events, in total
              */
-            StateBase* m_entryState = nullptr;
+            std::size_t m_deferred = 0;
 
             /**
-             * @brief   m_currentState
-             * @details The current sub-state
+             * @brief   m_counts
+             * @details Number of deferred events, indexed by event identifier
              */
-            StateBase* m_currentState = nullptr;
+            std::vector<std::size_t> m_counts = {};
 
             /**
-             * @brief   m_lastVisitedState
-             * @details The last visited sub-state
+             * @brief   m_released
+             * @details Configuration epoch from which deferred events are worth a retry, indexed by event identifier
              */
-            StateBase* m_lastVisitedState = nullptr;
+            std::vector<std::uint64_t> m_released = {};
 
             /**
-             * @brief   m_history
-             * @details The state's history type
+             * @brief   m_pending
+             * @details Identifiers of the deferred events to retry, i.e. released since the last retry
              */
-            THistory m_history = std::nullopt;
+            std::vector<TEventId> m_pending = {};
 
             /**
-             * @brief   m_children
-             * @details The sub-states mapped with their type index
+             * @brief   m_deferrers
+             * @details Number of active states declaring the event as deferred, indexed by event identifier
              */
-            std::map<std::type_index, StateBase*> m_children = {};
+            std::vector<std::size_t> m_deferrers = {};
 
             /**
-             * @brief   getDescendant
-             * @details Recursively searches for the state with the specified type StateType
-             * @return  Pointer to the found state if any, nullptr otherwise
+             * @brief   m_handlers
+             * @details Number of active states having a transition on the event, indexed by event identifier
              */
-            template <typename StateType>
-            StateType* getDescendant()
+            std::vector<std::size_t> m_handlers = {};
+
+            /**
+             * @brief       onEntry
+             * @param[in]   handled: identifiers of the events handled by the entered state
+             * @param[in]   deferred: identifiers of the events deferred by the entered state
+             * @details     Starts a new configuration epoch and schedules the retry of the deferred events the entered state handles
+             */
+            void onEntry(const TDeferredEvents& handled, const TDeferredEvents& deferred)
             {
-                // Loop over sub-states
-                for (const auto&[_, child] : m_children)
+                ++m_epoch;
+
+                for (auto id : handled) addHandler(id);
+
+                for (auto id : deferred)
                 {
-                    auto state = child->template getDescendantImpl<StateType>();
-                    if (state != nullptr) return state;
+                    if (id >= m_deferrers.size()) m_deferrers.resize(id + 1, 0);
+                    ++m_deferrers[id];
                 }
 
-                return nullptr;
+                if (0 == m_deferred) return;
+
+                for (auto id : handled) release(id);
             }
 
             /**
-             * @brief   contains
-             * @details Recursively searches for the provided state
-             * @return  true if state found, false otherwise
+             * @brief       onExit
+             * @param[in]   handled: identifiers of the events handled by the exited state
+             * @param[in]   deferred: identifiers of the events deferred by the exited state
+             * @details     Starts a new configuration epoch and schedules the retry of the deferred events no active state defers anymore
              */
-            bool contains(const StateBase* state) const
+            void onExit(const TDeferredEvents& handled, const TDeferredEvents& deferred)
             {
-                for (const auto&[_, child] : m_children)
+                ++m_epoch;
+
+                for (auto id : handled) --m_handlers[id];
+
+                for (auto id : deferred)
                 {
-                    if (true == child->contains(state)) return true;
+                    if (0 == --m_deferrers[id]) release(id);
                 }
-
-                return false;
             }
 
             /**
-             * @brief   getOutermost
-             * @details Searches into this region the outermost state containg a given inner state, skipping the specified state
-             * @return  Pointer to the outermost state if found, nullptr otherwise
+             * @brief       isDeferred
+             * @param[in]   id: event identifier
+             * @return      true if an active state defers the event, false otherwise
              */
-            StateBase* getOutermost(const StateBase* innerState, const StateBase* skippedState)
+            bool isDeferred(TEventId id) const
             {
-                for (const auto&[_, child] : m_children)
-                {
-                    if (child == skippedState) continue;
-                    if (true == child->contains(innerState)) return child;
-                }
-
-                return nullptr;
+                return id < m_deferrers.size() && m_deferrers[id] > 0;
             }
 
             /**
-             * @brief   start
-             * @details Starts this region with the provided event. A specific state to start may be provided in order to bypass the entry point or last visited
+             * @brief       isHandled
+             * @param[in]   id: event identifier
+             * @return      true if an active state has a transition on the event, false otherwise
              */
-            void start(const EventBase* evt, bool propagateHistory, StateBase* stateToStart = nullptr)
+            bool isHandled(TEventId id) const
             {
-                // Check if we are provided with a particular state to start
-                if (nullptr == stateToStart)
-                {
-                    // If state already visited then restore the last visited state depending on current history type or history propagation 
-                    if (m_lastVisitedState != nullptr && (m_history != std::nullopt || true == propagateHistory)) m_currentState = m_lastVisitedState;
-                    // Otherwise use the entry state
-                    else m_currentState = m_entryState;
-                }
-                else
+                return id < m_handlers.size() && m_handlers[id] > 0;
+            }
+
+            void addHandler(TEventId id)
+            {
+                if (id >= m_handlers.size()) m_handlers.resize(id + 1, 0);
+                ++m_handlers[id];
+            }
+
+            void release(TEventId id)
+            {
+                if (id >= m_counts.size() || 0 == m_counts[id]) return;
+                if (m_released[id] <= m_retried) m_pending.push_back(id);
+                m_released[id] = m_epoch;
+            }
+
+            void add(TEventId id)
+            {
+                if (id >= m_counts.size())
                 {
-                    // Check if the provided state to start belongs to this region
-                    if (m_children.end() != m_children.find(stateToStart->m_index)) m_currentState = stateToStart;
-                    else m_currentState = nullptr;
+                    m_counts.resize(id + 1, 0);
+                    m_released.resize(id + 1, 0);
                 }
 
-                // Start current sub-state if any
-                if (m_currentState != nullptr) m_currentState->startImpl(evt, Propagate(propagateHistory, this));
+                ++m_counts[id];
+                ++m_deferred;
             }
 
-            /**
-             * @brief   stop
-             * @details Stops this region with the provided event
-             */
-            void stop(const EventBase* evt)
+            void remove(TEventId id)
             {
-                // Stop current sub-state if any
-                if (m_currentState != nullptr) m_currentState->stopImpl(evt);
+                --m_counts[id];
+                --m_deferred;
+            }
 
-                // Backup last visited sub-state
-                m_lastVisitedState = m_currentState;
+            void clear()
+            {
+                m_deferred = 0;
+                m_counts.clear();
+                m_released.clear();
+                m_pending.clear();
+            }
+        };
 
-                // Reset current sub-state
-                m_currentState = nullptr;
+        struct PostedTransition;
+
+        /**
+         * @brief   RegionStep
+         * @details Side effects of a region run concurrently with its orthogonal regions, within a run-to-completion step.
+         *          They are recorded by the running thread, then applied in region order once all the regions completed,
+         *          which is the outcome of running the regions one after another
+         */
+        struct RegionStep
+        {
+            /**
+             * @brief   Current
+             * @return  The step recorded by the calling thread, nullptr if it does not run a region concurrently
+             */
+            static RegionStep*& Current()
+            {
+                thread_local RegionStep* current{ nullptr };
+                return current;
             }
 
             /**
-             * @brief   setHistory
-             * @details Sets the history for this region
+             * @brief   m_owner
+             * @details The runtime of the region
              */
-            void setHistory(THistory history)
+            const Runtime* m_owner = nullptr;
+
+            /**
+             * @brief   StateChange
+             * @details State entered or exited, as notified to DeferralEpochs
+             */
+            struct StateChange
             {
-                if (History::Deep == history)
-                {
-                    // Ensure that there is no ancestor nor descendant with deep history
-                    auto res = getDeepAncestorOrDescendant();
-                    if (res != std::nullopt)
-                    {
-                        LOG_ERROR_DSM("Failed to set Deep history on state '<" << m_parentState->name() << ", " << m_index << ">'."
-                            " Deep history already defined in " << std::get<0>(*res) << " state '<" << std::get<1>(*res)->name() << ", " << std::get<2>(*res) << ">'");
-                        return;
-                    }
-                }
+                const TDeferredEvents* m_handled = nullptr;
+                const TDeferredEvents* m_deferred = nullptr;
+                bool m_entered = false;
+            };
 
-                if (History::Shallow == history)
-                {
-                    // Ensure that there is no ancestor with deep history
-                    auto res = getDeepAncestor();
-                    if (res != std::nullopt)
-                    {
-                        LOG_ERROR_DSM("Failed to set Shallow history on state '<" << m_parentState->name() << ", " << m_index << ">'."
-                            " Deep history already defined in ancestor state '<" << res->first->name() << ", " << res->second << ">'");
-                        return;
-                    }
-                }
+            /**
+             * @brief   m_changes
+             * @details Entered and exited states, along with the events they handle and defer
+             */
+            std::vector<StateChange> m_changes;
 
-                // Store history type
-                m_history = history;
+            /**
+             * @brief   m_posted
+             * @details Posted events, deferred events and transitions requested, in posting order
+             */
+            std::vector<PostedTransition> m_posted;
 
-                // Reset the last visited state when changing history settings
-                m_lastVisitedState = nullptr;
+            bool m_handled = false;
+            std::exception_ptr m_error = nullptr;
+        };
+
+        /**
+         * @brief   EventSet
+         * @details Set of event identifiers. Identifiers being dense, the set is stored as a bitset
+         */
+        struct EventSet
+        {
+            std::vector<std::uint64_t> m_words = {};
+
+            void insert(TEventId id)
+            {
+                const auto word = id / 64;
+                if (word >= m_words.size()) m_words.resize(word + 1, 0);
+                m_words[word] |= std::uint64_t{ 1 } << (id % 64);
             }
 
-            void clearHistory(bool recursive)
+            void merge(const EventSet& other)
             {
-                m_lastVisitedState = nullptr;
+                if (other.m_words.size() > m_words.size()) m_words.resize(other.m_words.size(), 0);
+                for (std::size_t i = 0; i < other.m_words.size(); ++i) m_words[i] |= other.m_words[i];
+            }
 
-                if (true == recursive)
-                {
-                    for (const auto&[_, child] : m_children)
-                    {
-                        for (const auto&[_, region] : child->m_regions)
-                        {
-                            region->clearHistory(recursive);
-                        }
-                    }
-                }
+            bool contains(TEventId id) const
+            {
+                const auto word = id / 64;
+                return word < m_words.size() && 0 != (m_words[word] & (std::uint64_t{ 1 } << (id % 64)));
             }
 
+            void clear()
+            {
+                m_words.clear();
+            }
+        };
+
+        /**
+         * @brief   Runtime
+         * @details Runtime state of a state machine, kept apart from its topology so that instances may share the latter:
+         *          the current and last visited state of each region, the started flag and triggering event of each state,
+         *          and the configuration epochs of deferred events. Regions and states are indexed by their rank in the top-sm's layout.
+         *          The hierarchy, the layout and the flat table read and write it through the runtime passed along the dispatch,
+         *          code called back from the states reaches it through Current
+         */
+        struct Runtime
+        {
             /**
-             * @brief   resetHistory
-             * @details Resets the history for this region and it's children
+             * @brief   Current
+             * @return  The runtime run by the calling thread, nullptr if none. Top-sms not running it fall back to their own runtime
              */
-            void resetHistory(bool recursive)
+            static Runtime*& Current()
             {
-                // Reset history
-                m_history = std::nullopt;
+                thread_local Runtime* current{ nullptr };
+                return current;
+            }
 
-                // Reset the last visited state when changing history settings
-                m_lastVisitedState = nullptr;
+            /**
+             * @brief   Scope
+             * @details Makes the provided runtime the calling thread's current one for the scope's lifetime
+             */
+            class Scope
+            {
+            public:
+                explicit Scope(Runtime& runtime)
+                    : m_previous{ std::exchange(Current(), &runtime) }
+                {}
 
-                if (true == recursive)
+                ~Scope()
                 {
-                    for (const auto&[_, child] : m_children)
-                    {
-                        for (const auto&[_, region] : child->m_regions)
-                        {
-                            region->resetHistory(recursive);
-                        }
-                    }
+                    Current() = m_previous;
                 }
-            }
 
-            std::optional<std::tuple<std::string, StateBase*, int>> getDeepAncestorOrDescendant()
+                Scope(const Scope&) = delete;
+                Scope& operator=(const Scope&) = delete;
+
+            private:
+                Runtime* m_previous;
+            };
+
+            Runtime() = default;
+            Runtime(const Runtime&) = delete;
+            Runtime& operator=(const Runtime&) = delete;
+
+            /**
+             * @brief       started
+             * @param[in]   node: the state's rank in the layout
+             * @return      true if the state is started, false otherwise
+             */
+            bool started(TNodeIndex node) const
             {
-                if (History::Deep == m_history) return { { "this", m_parentState, m_index } };
-                auto res = getDeepAncestor();
-                if (res != std::nullopt) return { { "ancestor", res->first, res->second } };
-                res = getDeepDescendant();
-                if (res != std::nullopt) return { { "descendant", res->first, res->second } };
-                return std::nullopt;
+                return node < m_started.size() && 0 != m_started[node];
             }
 
             /**
-             * @brief   hasAncestorDeep
-             * @details Checks if any ancestor of this region has a deep history
-             * @return  true if ancestor with deep history found, false otherwise
+             * @brief       state
+             * @param[in]   node: the state's rank in the layout, or InvalidNode
+             * @return      Returns the state, nullptr if InvalidNode
              */
-            std::optional<std::pair<StateBase*, int>> getDeepAncestor() const
+            dsm::StateBase* state(TNodeIndex node) const
             {
-                if (History::Deep == m_history) return { { m_parentState, m_index } };
-                if (m_parentState != nullptr && m_parentState->m_parentRegion != nullptr) return m_parentState->m_parentRegion->getDeepAncestor();
-                return {};
+                return InvalidNode != node ? m_nodes[node] : nullptr;
             }
 
             /**
-             * @brief   hasDescendantDeep
-             * @details Checks if any descendant of this region has a deep history
-             * @return  true if descendant with deep history found, false otherwise
+             * @brief       trigEvent
+             * @param[in]   node: the state's rank in the layout
+             * @return      Returns the event that triggered the state's last entry or exit, nullptr if none
              */
-            std::optional<std::pair<StateBase*, int>> getDeepDescendant() const
+            const dsm::EventBase* trigEvent(TNodeIndex node) const
             {
-                if (History::Deep == m_history) return { { m_parentState, m_index } };
+                return node < m_trigEvents.size() ? m_trigEvents[node] : nullptr;
+            }
 
-                for (const auto&[_, child] : m_children)
-                {
-                    for (const auto&[_, region] : child->m_regions)
-                    {
-                        auto res = region->getDeepDescendant();
-                        if (res != std::nullopt) return res;
-                    }
-                }
+            /**
+             * @brief   m_topSm
+             * @details The top-sm whose topology is run
+             */
+            const dsm::StateBase* m_topSm = nullptr;
 
-                return {};
-            }
-        };
+            /**
+             * @brief   m_layout
+             * @details The layout the runtime is sized for
+             */
+            const Layout* m_layout = nullptr;
 
-        /**
-         * @brief   m_name
-         * @details The state's name
-         */
-        std::string m_name = {};
+            /**
+             * @brief   m_revision
+             * @details The top-sm's revision the runtime is sized for
+             */
+            std::uint64_t m_revision = std::numeric_limits<std::uint64_t>::max();
 
-        /**
-         * @brief   m_index
-         * @details The state's type index
-         */
-        std::type_index m_index;
+            /**
+             * @brief   m_nodes
+             * @details The layout's states, in layout order
+             */
+            dsm::StateBase* const* m_nodes = nullptr;
 
-        /**
-         * @brief   m_regions
-         * @details The state's regions container
-         */
-        std::map<int, Region*> m_regions = {};
+            /**
+             * @brief   m_current
+             * @details Current state of each region, InvalidNode if the region is stopped
+             */
+            std::vector<TNodeIndex> m_current = {};
 
-        /**
-         * @brief   m_entry
-         * @details The state's entry flag
-         */
-        bool m_entry = false;
+            /**
+             * @brief   m_last
+             * @details Last visited state of each region, for history, InvalidNode if none
+             */
+            std::vector<TNodeIndex> m_last = {};
 
-        /**
-         * @brief   m_started
-         * @details Flag indicating whether the state machine is started or not.
-         *          - A stopped state machine won't process any event
-         *          - A started state machine won't accept any new state nor transition to be added
-         */
-        bool m_started = false;
+            /**
+             * @brief   m_started
+             * @details Started flag of each state. Bytes rather than bits, since concurrent regions set those of their own states
+             */
+            std::vector<std::uint8_t> m_started = {};
 
-        /**
-         * @brief   m_regionIndex
-         * @details The state's region index
-         */
-        int m_regionIndex = 0;
+            /**
+             * @brief   m_trigEvents
+             * @details Event that triggered the last entry or exit of each state
+             */
+            std::vector<const dsm::EventBase*> m_trigEvents = {};
 
-        /**
-         * @brief   m_parentRegion
-         * @details The state's parent region
-         */
-        Region* m_parentRegion = nullptr;
+            /**
+             * @brief   m_configuration
+             * @details Identifier of the active configuration in the flat table, UnknownConfiguration if to be resynchronized
+             */
+            std::size_t m_configuration = UnknownConfiguration;
 
-        /**
-         * @brief   m_parentState
-         * @details The state's parent state
-         */
-        StateBase* m_parentState = nullptr;
+            /**
+             * @brief   m_epochs
+             * @details Configuration epochs of the deferred events
+             */
+            DeferralEpochs m_epochs = {};
 
-        /**
-         * @brief   m_topSm
-         * @details The top-sm state (i.e. the state machine)
-         */
-        StateBase* m_topSm = nullptr;
+            /**
+             * @brief   m_processing
+             * @details Whether a run-to-completion step is in progress
+             */
+            bool m_processing = false;
 
-        /**
-         * @brief   m_trigEvent
-         * @details The current triggering event
-         */
-        const EventBase* m_trigEvent = nullptr;
+            /**
+             * @brief   m_forked
+             * @details Regions run concurrently by the layout, within the current run-to-completion step
+             */
+            std::vector<TNodeIndex> m_forked = {};
 
-        /**
-         * @brief   m_transitions
-         * @details The state's allowed transitions mapped with their event's type index
-         */
-        std::map<std::type_index, details::TransitionBase*> m_transitions = {};
+            /**
+             * @brief   m_steps
+             * @details Side effects of the regions run concurrently, indexed like m_forked
+             */
+            std::vector<RegionStep> m_steps = {};
 
-    public:
-        /**
-         * @brief   name
-         * @return  Returns the state's name
-         */
-        const std::string& name() const { return m_name; }
+            /**
+             * @brief   m_forkedEvent
+             * @details Event dispatched to the regions run concurrently
+             */
+            const dsm::EventBase* m_forkedEvent = nullptr;
+        };
 
-        /**
-         * @brief   started
-         * @details Provides the statemachine start/stop flag
-         * @return  true if started, false otherwise
-         */
-        bool started() const
-        {
-            return m_started;
-        }
+        // Exceptions
 
         /**
-         * @brief   contains
-         * @details Recursively searches for the provided state
-         * @return  true if state found, false otherwise
-         */
-        bool contains(const StateBase* state) const
+        * @brief   SmError
+        * @details StateMachine's exception
+        */
+        struct SmError : public std::exception
         {
-            // Check self state
-            if (this == state) return true;
+            /**
+            * @brief   m_msg
+            * @details The exception's message
+            */
+            mutable std::string m_msg;
+            std::stringstream m_sstr;
 
-            // Loop over orthogonal regions
-            for (const auto&[_, region] : m_regions)
+            SmError() = default;
+            virtual ~SmError() = default;
+            SmError(SmError&&) = default;
+            SmError& operator=(SmError&&) = default;
+
+            SmError(const SmError& other)
             {
-                if (true == region->contains(state)) return true;
+                m_sstr << other.m_sstr.rdbuf();
             }
 
-            return false;
-        }
+            SmError& operator=(const SmError& other)
+            {
+                m_sstr << other.m_sstr.rdbuf();
+                return *this;
+            }
 
-        /**
-         * @brief           dump
-         * @param[in,out]   stream: output stream
-         * @details         Outputs this state to the provided stream
-         * @return          Returns the output stream
-         */
-        std::ostream& dump(std::ostream& stream) const
-        {
-            stream << m_name;
-            if (m_regions.size() > 1) stream << "[";
-            for (std::map<int, Region*>::const_iterator it = m_regions.cbegin(); it != m_regions.cend(); ++it)
+            SmError& operator<<(const char* msg)
             {
-                if (it->second->m_currentState != nullptr) stream << "->" << *(it->second->m_currentState);
-                if (std::next(it) != m_regions.end()) stream << "|";
+                m_sstr << msg;
+                return *this;
             }
-            if (m_regions.size() > 1) stream << "]";
 
-            return stream;
-        }
+            SmError& operator<<(const std::string& msg)
+            {
+                return *this << msg.c_str();
+            }
 
-        /**
-         * @brief           operator<<
-         * @param[in,out]   stream: output stream
-         * @param[in]       state: state to output
-         * @details         Performs stream output on states
-         * @return          Returns the output stream
+            /**
+            * @brief   what
+            * @details Retrieves the exception's message
+            */
+            const char* what() const noexcept override
+            {
+                // Storing msg is needed because std::stringstream::str returns a temporary object
+                m_msg = m_sstr.str();
+                return m_msg.c_str();
+            }
+        };
+    }
+
+    /**
+     * @brief   Event
+     * @details CRTP base class for Events. Allows type index initialization
+     */
+    template <typename DerivedType>
+    class Event : public EventBase
+    {
+    private:
+        template <typename OtherDerivedType, typename SmType>
+        friend class State;
+
+    public:
+        using Derived = DerivedType;
+
+        /**
+         * @brief   name
+         * @return  Returns the event's type name, shared among all instances of DerivedType
          */
-        friend std::ostream& operator<<(std::ostream& stream, const StateBase& state)
+        std::string_view name() const override { return details::StaticName<DerivedType>(); }
+
+    protected:
+        Event() :
+            EventBase{ details::EventId<DerivedType>() }
         {
-            return state.dump(stream);
+            static_assert(std::is_base_of_v<Event<DerivedType>, DerivedType>, "DerivedType must inherit from Event");
+            static_assert(std::is_copy_constructible_v<DerivedType>, "DerivedType must be copy constructible");
+        }
+
+        virtual ~Event() {}
+
+    private:
+        DerivedType& derived()
+        {
+            return static_cast<DerivedType&>(*this);
+        }
+
+        const DerivedType& derived() const
+        {
+            return static_cast<const DerivedType&>(*this);
+        }
+
+        void cloneInto(details::EventEnvelope& envelope) const override
+        {
+            envelope.emplace(derived());
         }
+    };
 
+    /**
+     * @brief   StateBase
+     * @details Base class for all States.
+     *          - Holds the type index of the final subclass
+     *          - Holds the state name
+     *          - Holds the region index it belongs to
+     *          - Holds the inner regions
+     *          - Holds the transitions
+     *          - Holds the defered events
+     *          - Provides a link to the parent state and to the top state (i.e. the StateMachine)
+     */
+    class StateBase
+    {
     private:
+        template <typename DerivedType, typename SmType>
+        friend class State;
+
+        template <typename SmType, typename StoreType>
+        friend class StateMachine;
+
+        friend struct details::PostedTransition;
+
+        friend class details::FlatMachine;
+
+        friend class details::Layout;
+
+        /**
+         * @brief   TransitionData
+         * @details Data associated to a transition
+         */
+        struct TransitionData
+        {
+            /**
+             * @brief   commonAncestor
+             * @details The common ancestor of both source state and destination state. In the simplest case, this corresponds to the source and destination's parent
+             */
+            StateBase* commonAncestor = nullptr;
+
+            /**
+             * @brief   srcOutermost
+             * @details The outermost state containing the source state. In the simplest case, this corresponds to the source state itself
+             */
+            StateBase* srcOutermost = nullptr;
+
+            /**
+             * @brief   dstOutermost
+             * @details The outermost state containing the destination state. In the simplest case, this corresponds to the destination state itself
+             */
+            StateBase* dstOutermost = nullptr;
+
+            /**
+             * @brief   src
+             * @details The source state
+             */
+            StateBase* src = nullptr;
+
+            /**
+             * @brief   dst
+             * @details The destination state
+             */
+            StateBase* dst = nullptr;
+        };
+
+        struct Region;
+
+        /**
+         * @brief   TransitionPath
+         * @details Exit and entry chains of an external transition, flattened once at creation so that taking the transition
+         *          neither searches the common ancestor from the top state machine nor walks back up from the destination.
+         *          The exit chain reduces to the source outermost, whose active sub-states are only known at run time
+         */
+        struct TransitionPath
+        {
+            /**
+             * @brief   ancestorRegions
+             * @details The regions enclosing the common ancestor, up to the top-sm. Their history is read when taking the transition
+             */
+            std::vector<const Region*> ancestorRegions = {};
+
+            /**
+             * @brief   entryChain
+             * @details The states to enter, from the destination outermost down to the destination
+             */
+            std::vector<StateBase*> entryChain = {};
+        };
+
+        /**
+         * @brief   MemberTransition
+         * @details Transition triggered by EventType. Guard and action are compile-time member pointers of StateType,
+         *          called directly on the action state, and the transition data and path are computed once at creation.
+         *          Internal transitions (External == false) only call the guard and the action
+         */
+        template <typename EventType, typename StateType, TAction<StateType, EventType> action, TGuard<StateType, EventType> guard, bool External>
+        struct MemberTransition : public details::TransitionBase
+        {
+            MemberTransition(StateBase* srcState, StateType* actionState, const TransitionData& data, TransitionPath&& path)
+                : details::TransitionBase{ details::EventId<EventType>(), &Exec, &Fire }
+                , m_actionState{ actionState }
+                , m_data{ data }
+                , m_path{ std::move(path) }
+            {
+                m_srcState = srcState;
+                m_dstState = data.dst;
+            }
+
+            static bool Exec(const details::TransitionBase* base, details::Runtime& runtime, const EventBase& evt)
+            {
+                if (false == Fire(base, evt)) return false;
+
+                if constexpr (true == External)
+                {
+                    auto transition = static_cast<const MemberTransition*>(base);
+                    return transition->m_data.commonAncestor->transitImpl(runtime, &evt, transition->m_data, transition->m_path);
+                }
+                else return true;
+            }
+
+            static bool Fire(const details::TransitionBase* base, const EventBase& evt)
+            {
+                auto transition = static_cast<const MemberTransition*>(base);
+                const auto& event = static_cast<const EventType&>(evt);
+
+                try
+                {
+                    if constexpr (guard != nullptr)
+                    {
+                        if (false == (transition->m_actionState->*guard)(event)) return false;
+                    }
+
+                    if constexpr (action != nullptr)
+                    {
+                        (transition->m_actionState->*action)(event);
+                    }
+
+                    return true;
+                }
+                catch (...)
+                {
+                    // Transitions's error job
+                    transition->m_srcState->onError(std::current_exception());
+                    return false;
+                }
+            }
+
+            /**
+             * @brief   m_actionState
+             * @details The state where the guard and action take place
+             */
+            StateType* m_actionState;
+
+            /**
+             * @brief   m_data
+             * @details The transition's data, unused by internal transitions
+             */
+            TransitionData m_data;
+
+            /**
+             * @brief   m_path
+             * @details The transition's flattened path, unused by internal transitions
+             */
+            TransitionPath m_path;
+        };
+
+        /**
+         * @brief   Region
+         * @details Region inside a state. Holds a pointer to the entry point state. Its current state and last visited state are held by the runtime
+         */
+        struct Region
+        {
+            /**
+             * @brief   m_index
+             * @details The region's index
+             */
+            int m_index;
+
+            /**
+             * @brief   m_parentState
+             * @details The region's parent state
+             */
+            StateBase* m_parentState = nullptr;
+
+            /**
+             * @brief   m_entryState
+             * @details The entry sub-state
+             */
+            StateBase* m_entryState = nullptr;
+
+            /**
+             * @brief   m_history
+             * @details The state's history type
+             */
+            THistory m_history = std::nullopt;
+
+            /**
+             * @brief   m_independent
+             * @details Whether the region's handlers are declared independent from the ones of its orthogonal regions
+             */
+            bool m_independent = false;
+
+            /**
+             * @brief   m_slot
+             * @details The region's rank in the top-sm's layout, indexing its current and last visited states in the runtime. InvalidNode until laid out
+             */
+            details::TNodeIndex m_slot = details::InvalidNode;
+
+            /**
+             * @brief   m_preOrder
+             * @details Pre-order rank of the region's first sub-state. Valid while the top-sm's m_numbered flag is set
+             */
+            std::size_t m_preOrder = 0;
+
+            /**
+             * @brief   m_postOrder
+             * @details Post-order rank of the region's last sub-state, below m_preOrder if the region is empty. Valid while the top-sm's m_numbered flag is set
+             */
+            std::size_t m_postOrder = 0;
+
+            /**
+             * @brief   m_children
+             * @details The sub-states mapped with their type index
+             */
+            std::map<std::type_index, StateBase*> m_children = {};
+
+            /**
+             * @brief   getDescendant
+             * @details Recursively searches for the state with the specified type StateType
+             * @return  Pointer to the found state if any, nullptr otherwise
+             */
+            template <typename StateType>
+            StateType* getDescendant()
+            {
+                // Loop over sub-states
+                for (const auto&[_, child] : m_children)
+                {
+                    auto state = child->template getDescendantImpl<StateType>();
+                    if (state != nullptr) return state;
+                }
+
+                return nullptr;
+            }
+
+            /**
+             * @brief   contains
+             * @details Checks whether the provided state is one of this region's children or their descendants.
+             *          Once the topology is numbered, compares the state's numbers with the range of the region's children, i.e. two integer compares.
+             *          Otherwise searches among the regions of the provided state and its ancestors
+             * @return  true if state found, false otherwise
+             */
+            bool contains(const StateBase* state) const
+            {
+                if (nullptr == state || nullptr == m_parentState) return false;
+
+                const auto topSm = m_parentState->m_topSm;
+                if (topSm != nullptr && topSm == state->m_topSm && true == topSm->m_numbered)
+                {
+                    return m_preOrder <= state->m_preOrder && state->m_postOrder <= m_postOrder;
+                }
+
+                for (; state != nullptr; state = state->m_parentState)
+                {
+                    if (this == state->m_parentRegion) return true;
+                }
+
+                return false;
+            }
+
+            /**
+             * @brief       current
+             * @param[in]   runtime: the runtime to read
+             * @return      Returns the current sub-state, nullptr if none or if the region is not laid out yet
+             */
+            StateBase* current(const details::Runtime& runtime) const
+            {
+                return m_slot < runtime.m_current.size() ? runtime.state(runtime.m_current[m_slot]) : nullptr;
+            }
+
+            /**
+             * @brief       lastVisited
+             * @param[in]   runtime: the runtime to read
+             * @return      Returns the last visited sub-state, nullptr if none or if the region is not laid out yet
+             */
+            StateBase* lastVisited(const details::Runtime& runtime) const
+            {
+                return m_slot < runtime.m_last.size() ? runtime.state(runtime.m_last[m_slot]) : nullptr;
+            }
+
+            /**
+             * @brief       setCurrent
+             * @param[in]   runtime: the runtime to update
+             * @param[in]   state: the new current sub-state, may be nullptr
+             * @details     Updates the current sub-state
+             */
+            void setCurrent(details::Runtime& runtime, StateBase* state) const
+            {
+                runtime.m_current[m_slot] = (state != nullptr) ? state->m_node : details::InvalidNode;
+            }
+
+            /**
+             * @brief   start
+             * @details Starts this region on the provided runtime with the provided event. A specific state to start may be provided in order to bypass the entry point or last visited
+             */
+            void start(details::Runtime& runtime, const EventBase* evt, bool propagateHistory, StateBase* stateToStart = nullptr)
+            {
+                StateBase* current = nullptr;
+
+                // Check if we are provided with a particular state to start
+                if (nullptr == stateToStart)
+                {
+                    // If state already visited then restore the last visited state depending on current history type or history propagation 
+                    auto lastVisited = this->lastVisited(runtime);
+                    if (lastVisited != nullptr && (m_history != std::nullopt || true == propagateHistory)) current = lastVisited;
+                    // Otherwise use the entry state
+                    else current = m_entryState;
+                }
+                else
+                {
+                    // Check if the provided state to start belongs to this region
+                    if (m_children.end() != m_children.find(stateToStart->m_index)) current = stateToStart;
+                }
+
+                setCurrent(runtime, current);
+
+                // Start current sub-state if any
+                if (current != nullptr) current->startImpl(runtime, evt, Propagate(propagateHistory, this));
+            }
+
+            /**
+             * @brief   stop
+             * @details Stops this region on the provided runtime with the provided event
+             */
+            void stop(details::Runtime& runtime, const EventBase* evt)
+            {
+                // Stop current sub-state if any
+                if (auto current = this->current(runtime); current != nullptr) current->stopImpl(runtime, evt);
+
+                // Backup last visited sub-state
+                runtime.m_last[m_slot] = runtime.m_current[m_slot];
+
+                // Reset current sub-state
+                runtime.m_current[m_slot] = details::InvalidNode;
+            }
+
+            /**
+             * @brief   setHistory
+             * @details Sets the history for this region
+             */
+            void setHistory(THistory history)
+            {
+                if (History::Deep == history)
+                {
+                    // Ensure that there is no ancestor nor descendant with deep history
+                    auto res = getDeepAncestorOrDescendant();
+                    if (res != std::nullopt)
+                    {
+                        LOG_ERROR_DSM("Failed to set Deep history on state '<" << m_parentState->name() << ", " << m_index << ">'."
+                            " Deep history already defined in " << std::get<0>(*res) << " state '<" << std::get<1>(*res)->name() << ", " << std::get<2>(*res) << ">'");
+                        return;
+                    }
+                }
+
+                if (History::Shallow == history)
+                {
+                    // Ensure that there is no ancestor with deep history
+                    auto res = getDeepAncestor();
+                    if (res != std::nullopt)
+                    {
+                        LOG_ERROR_DSM("Failed to set Shallow history on state '<" << m_parentState->name() << ", " << m_index << ">'."
+                            " Deep history already defined in ancestor state '<" << res->first->name() << ", " << res->second << ">'");
+                        return;
+                    }
+                }
+
+                // Store history type
+                m_history = history;
+
+                // Reset the last visited state when changing history settings
+                forgetHistory();
+            }
+
+            void clearHistory(details::Runtime& runtime, bool recursive)
+            {
+                if (m_slot < runtime.m_last.size()) runtime.m_last[m_slot] = details::InvalidNode;
+
+                if (true == recursive)
+                {
+                    for (const auto&[_, child] : m_children)
+                    {
+                        for (const auto&[_, region] : child->m_regions)
+                        {
+                            region->clearHistory(runtime, recursive);
+                        }
+                    }
+                }
+            }
+
+            /**
+             * @brief   forgetHistory
+             * @details Clears the last visited state in the top-sm's own runtime, and notifies the top-sm of the history change
+             */
+            void forgetHistory()
+            {
+                if (nullptr == m_parentState || nullptr == m_parentState->m_topSm) return;
+
+                auto topSm = m_parentState->m_topSm;
+                if (topSm->m_runtime != nullptr) clearHistory(*topSm->m_runtime, false);
+                ++topSm->m_revision;
+            }
+
+            /**
+             * @brief   resetHistory
+             * @details Resets the history for this region and it's children
+             */
+            void resetHistory(bool recursive)
+            {
+                // Reset history
+                m_history = std::nullopt;
+
+                // Reset the last visited state when changing history settings
+                forgetHistory();
+
+                if (true == recursive)
+                {
+                    for (const auto&[_, child] : m_children)
+                    {
+                        for (const auto&[_, region] : child->m_regions)
+                        {
+                            region->resetHistory(recursive);
+                        }
+                    }
+                }
+            }
+
+            std::optional<std::tuple<std::string, StateBase*, int>> getDeepAncestorOrDescendant()
+            {
+                if (History::Deep == m_history) return { { "this", m_parentState, m_index } };
+                auto res = getDeepAncestor();
+                if (res != std::nullopt) return { { "ancestor", res->first, res->second } };
+                res = getDeepDescendant();
+                if (res != std::nullopt) return { { "descendant", res->first, res->second } };
+                return std::nullopt;
+            }
+
+            /**
+             * @brief   hasAncestorDeep
+             * @details Checks if any ancestor of this region has a deep history
+             * @return  true if ancestor with deep history found, false otherwise
+             */
+            std::optional<std::pair<StateBase*, int>> getDeepAncestor() const
+            {
+                if (History::Deep == m_history) return { { m_parentState, m_index } };
+                if (m_parentState != nullptr && m_parentState->m_parentRegion != nullptr) return m_parentState->m_parentRegion->getDeepAncestor();
+                return {};
+            }
+
+            /**
+             * @brief   hasDescendantDeep
+             * @details Checks if any descendant of this region has a deep history
+             * @return  true if descendant with deep history found, false otherwise
+             */
+            std::optional<std::pair<StateBase*, int>> getDeepDescendant() const
+            {
+                if (History::Deep == m_history) return { { m_parentState, m_index } };
+
+                for (const auto&[_, child] : m_children)
+                {
+                    for (const auto&[_, region] : child->m_regions)
+                    {
+                        auto res = region->getDeepDescendant();
+                        if (res != std::nullopt) return res;
+                    }
+                }
+
+                return {};
+            }
+        };
+
+        /**
+         * @brief   m_name
+         * @details The state's name
+         */
+        std::string m_name = {};
+
+        /**
+         * @brief   m_index
+         * @details The state's type index
+         */
+        std::type_index m_index;
+
+        /**
+         * @brief   m_id
+         * @details The state's type identifier
+         */
+        TStateId m_id;
+
+        /**
+         * @brief   m_regions
+         * @details The state's regions container
+         */
+        std::map<int, Region*> m_regions = {};
+
+        /**
+         * @brief   m_entry
+         * @details The state's entry flag
+         */
+        bool m_entry = false;
+
+        /**
+         * @brief   m_regionIndex
+         * @details The state's region index
+         */
+        int m_regionIndex = 0;
+
+        /**
+         * @brief   m_parentRegion
+         * @details The state's parent region
+         */
+        Region* m_parentRegion = nullptr;
+
+        /**
+         * @brief   m_parentState
+         * @details The state's parent state
+         */
+        StateBase* m_parentState = nullptr;
+
+        /**
+         * @brief   m_topSm
+         * @details The top-sm state (i.e. the state machine)
+         */
+        StateBase* m_topSm = nullptr;
+
+        /**
+         * @brief   TransitionRecord
+         * @details Transition of a state along with its event's identifier
+         */
+        struct TransitionRecord
+        {
+            TEventId m_eventId;
+            details::TransitionBase* m_transition;
+        };
+
+        /**
+         * @brief   m_transitions
+         * @details The state's allowed transitions, sorted by their event's identifier. Sized by the state's own transitions,
+         *          whatever the number of event types in the process
+         */
+        std::vector<TransitionRecord> m_transitions = {};
+
+        /**
+         * @brief   m_handledEvents
+         * @details Identifiers of the events the state has a transition for
+         */
+        TDeferredEvents m_handledEvents = {};
+
+        /**
+         * @brief   m_subtreeEvents
+         * @details Identifiers of the events handled by the state or any of its descendants. Computed on start, the topology being frozen while started
+         */
+        details::EventSet m_subtreeEvents = {};
+
+        /**
+         * @brief   m_deferredEvents
+         * @details Identifiers of the events the state defers while active
+         */
+        TDeferredEvents m_deferredEvents = {};
+
+        /**
+         * @brief   m_runtime
+         * @details The top-sm's own runtime, nullptr for other states
+         */
+        details::Runtime* m_runtime = nullptr;
+
+        /**
+         * @brief   m_stateIndex
+         * @details The top-sm's states indexed by their type identifier, nullptr for other states
+         */
+        std::vector<StateBase*>* m_stateIndex = nullptr;
+
+        /**
+         * @brief   m_preOrder
+         * @details The state's rank in a pre-order traversal of the top-sm's states. Valid while the top-sm's m_numbered flag is set
+         */
+        mutable std::size_t m_preOrder = 0;
+
+        /**
+         * @brief   m_postOrder
+         * @details The state's rank in a post-order traversal of the top-sm's states. Valid while the top-sm's m_numbered flag is set
+         */
+        mutable std::size_t m_postOrder = 0;
+
+        /**
+         * @brief   m_numbered
+         * @details Top-sm only: flag indicating whether the states' pre-order and post-order numbers match the current topology.
+         *          Reset on any state addition or removal
+         */
+        mutable bool m_numbered = false;
+
+        /**
+         * @brief   m_revision
+         * @details Top-sm only: incremented on any change of states, transitions, history settings or independent regions
+         */
+        std::uint64_t m_revision = 0;
+
+        /**
+         * @brief   m_node
+         * @details The state's index in the top-sm's layout, i.e. its rank among the states in pre-order
+         */
+        details::TNodeIndex m_node = details::InvalidNode;
+
+    public:
+        /**
+         * @brief   name
+         * @return  Returns the state's name
+         */
+        const std::string& name() const { return m_name; }
+
+        /**
+         * @brief   started
+         * @details Provides the state's start/stop flag in the runtime run by the calling thread.
+         *          - A stopped state machine won't process any event
+         *          - A started state machine won't accept any new state nor transition to be added
+         * @return  true if started, false otherwise
+         */
+        bool started() const
+        {
+            auto runtime = this->runtime();
+            return runtime != nullptr && runtime->started(m_node);
+        }
+
+        /**
+         * @brief   contains
+         * @details Checks whether the provided state is this state or one of its descendants.
+         *          Once the topology is numbered, compares the states' pre-order and post-order numbers, i.e. two integer compares.
+         *          Otherwise searches among the provided state and its ancestors
+         * @return  true if state found, false otherwise
+         */
+        bool contains(const StateBase* state) const
+        {
+            if (nullptr == state) return false;
+
+            if (m_topSm != nullptr && m_topSm == state->m_topSm && true == m_topSm->m_numbered)
+            {
+                return m_preOrder <= state->m_preOrder && state->m_postOrder <= m_postOrder;
+            }
+
+            for (; state != nullptr; state = state->m_parentState)
+            {
+                if (this == state) return true;
+            }
+
+            return false;
+        }
+
+        /**
+         * @brief           dump
+         * @param[in,out]   stream: output stream
+         * @details         Outputs this state to the provided stream
+         * @return          Returns the output stream
+         */
+        std::ostream& dump(std::ostream& stream) const
+        {
+            auto runtime = this->runtime();
+
+            stream << m_name;
+            if (m_regions.size() > 1) stream << "[";
+            for (std::map<int, Region*>::const_iterator it = m_regions.cbegin(); it != m_regions.cend(); ++it)
+            {
+                auto current = (runtime != nullptr) ? it->second->current(*runtime) : nullptr;
+                if (current != nullptr) stream << "->" << *current;
+                if (std::next(it) != m_regions.end()) stream << "|";
+            }
+            if (m_regions.size() > 1) stream << "]";
+
+            return stream;
+        }
+
+        /**
+         * @brief           operator<<
+         * @param[in,out]   stream: output stream
+         * @param[in]       state: state to output
+         * @details         Performs stream output on states
+         * @return          Returns the output stream
+         */
+        friend std::ostream& operator<<(std::ostream& stream, const StateBase& state)
+        {
+            return state.dump(stream);
+        }
+
+    private:
+        /**
+         * @brief   runtime
+         * @return  Returns the runtime run by the calling thread if it runs the top-sm's topology, the top-sm's own runtime otherwise.
+         *          nullptr if the state does not belong to a top-sm
+         */
+        details::Runtime* runtime() const
+        {
+            if (nullptr == m_topSm) return nullptr;
+
+            auto current = details::Runtime::Current();
+            return (current != nullptr && current->m_topSm == m_topSm) ? current : m_topSm->m_runtime;
+        }
+
+        /**
+         * @brief   trigEventImpl
+         * @return  Returns the event that triggered the state's last entry or exit in the runtime run by the calling thread, nullptr if none
+         */
+        const EventBase* trigEventImpl() const
+        {
+            auto runtime = this->runtime();
+            return runtime != nullptr ? runtime->trigEvent(m_node) : nullptr;
+        }
+
+        /**
+         * @brief           visitImpl
+         * @param[in]       runtime: the visited runtime
+         * @param[in,out]   visitor: applied visitor
+         * @details         Visits the current state and sub-states
+         */
+        void visitImpl(const details::Runtime& runtime, IStateVisitor& visitor)
+        {
+            visitor.visit(this);
+            for (const auto&[_, region] : m_regions)
+            {
+                if (auto current = region->current(runtime); current != nullptr) current->visitImpl(runtime, visitor);
+            }
+        }
+
+        /**
+         * @brief       StateBase
+         * @param[in]   index: sub-class type index
+         * @param[in]   id: sub-class type identifier
+         * @details     StateBase ctor
+         */
+        StateBase(const std::type_index& index, TStateId id)
+            : m_index{ index }
+            , m_id{ id }
+        {}
+
+        void setupImpl()
+        {
+            // Order matters
+            this->setupStatesImpl();
+            if (this == m_topSm) this->numberStates();
+            this->setupTransitionsImpl();
+            this->setupDeferredEventsImpl();
+            this->setupHistoryImpl();
+        }
+
+        /**
+         * @brief   clearImpl
+         * @details Recursively destro this state and its children
+         */
+        void clearImpl()
+        {
+            if (m_topSm != nullptr) ++m_topSm->m_revision;
+
+            for (auto& record : m_transitions)
+            {
+                delete record.m_transition;
+                record.m_transition = nullptr;
+            }
+
+            m_transitions.clear();
+            m_handledEvents.clear();
+            m_subtreeEvents.clear();
+            m_deferredEvents.clear();
+
+            for (auto&[_, region] : m_regions)
+            {
+                for (auto&[_, child] : region->m_children)
+                {
+                    if (m_topSm != nullptr && m_topSm->m_stateIndex != nullptr) (*m_topSm->m_stateIndex)[child->m_id] = nullptr;
+                    if (m_topSm != nullptr) m_topSm->m_numbered = false;
+
+                    delete child;
+                    child = nullptr;
+                }
+
+                region->m_children.clear();
+
+                delete region;
+                region = nullptr;
+            }
+
+            m_regions.clear();
+        }
+
+        /**
+         * @brief   ~StateBase
+         * @details StateBase dtor
+         */
+        virtual ~StateBase()
+        {
+            clearImpl();
+        }
+
+        /**
+         * @brief   getStates
+         * @details Allows statemachine states setup when overriden by user
+         * @return  User defined states
+         */
+        virtual TStates getStates() { return {}; }
+
+        /**
+         * @brief   getTransitions
+         * @details Allows statemachine transitions setup when overriden by user
+         * @return  User defined transitions
+         */
+        virtual TTransitions getTransitions() { return {}; }
+
+        /**
+         * @brief   getDeferredEvents
+         * @details Allows state's deferred events setup when overriden by user
+         * @return  User defined deferred events
+         */
+        virtual TDeferredEvents getDeferredEvents() { return {}; }
+
+        /**
+         * @brief   getHistory
+         * @details Allows statemachine history setup when overriden by user
+         * @return  User defined history
+         */
+        virtual THistory getHistory(int regionIndex) { return {}; }
+
+        /**
+         * @brief   onEntry
+         * @details State's entry job
+         */
+        virtual void onEntry()
+        {
+            LOG_DEBUG_DSM("Entering state " << m_name << " through event " << (trigEventImpl() != nullptr ? trigEventImpl()->name() : "anonymous"));
+        }
+
+        /**
+         * @brief   onExit
+         * @details State's exit job
+         */
+        virtual void onExit()
+        {
+            LOG_DEBUG_DSM("Leaving state " << m_name << " through event " << (trigEventImpl() != nullptr ? trigEventImpl()->name() : "anonymous"));
+        }
+
+        /**
+         * @brief       onError
+         * @param[in]   ex: exception causing this call
+         * @details     State's error job
+         */
+        virtual void onError(std::exception_ptr eptr)
+        {
+            LOG_ERROR_DSM(what(std::move(eptr)));
+        }
+
+        /**
+         * @brief       traceImpl
+         * @param[in]   point: trace point
+         * @param[in]   evt: event involved, if any
+         * @details     Records the trace point with raw identifiers through DSM_TRACER. Compiles to nothing with the default Log::EmptyTracer
+         */
+        void traceImpl(Log::TracePoint point, const EventBase* evt) const
+        {
+            if constexpr (Log::is_tracer_enabled_v<DSM_TRACER>)
+            {
+                Log::Tracer<DSM_TRACER>::GetInstance()->trace(point, static_cast<std::uint32_t>(m_id), m_name, m_regionIndex,
+                    evt != nullptr ? static_cast<std::uint32_t>(evt->m_id) : Log::InvalidTraceId, evt != nullptr ? evt->name() : "anonymous");
+            }
+        }
+
+        /**
+         * @brief       startImpl
+         * @param[in]   runtime: the runtime to update
+         * @param[in]   evt: event triggering the state's entry
+         * @details     Starts the current state
+         *              - Stores the triggering event
+         *              - Processes any defered event
+         *              - Performs the entry job
+         *              - For each region:
+         *                  - Restores the current sub-state depending on the history flag
+         *                  - Recursively starts the current sub-state if any
+         */
+        void startImpl(details::Runtime& runtime, const EventBase* evt, bool propagateHistory, bool recurse = true)
+        {
+            this->enterImpl(runtime, evt);
+
+            if (true == recurse)
+            {
+                // Loop over orthogonal regions
+                for (auto&[_, region] : m_regions)
+                {
+                    region->start(runtime, evt, propagateHistory);
+                }
+            }
+        }
+
+        /**
+         * @brief       enterImpl
+         * @param[in]   runtime: the runtime to update
+         * @param[in]   evt: event triggering the state's entry
+         * @details     Enters this state only, regardless of its regions
+         */
+        void enterImpl(details::Runtime& runtime, const EventBase* evt)
+        {
+            runtime.m_started[m_node] = 1;
+
+            // Backup triggering event
+            runtime.m_trigEvents[m_node] = evt;
+
+            traceImpl(Log::TracePoint::Entry, evt);
+
+            // New configuration: deferred events handled by this state shall be retried
+            auto step = details::RegionStep::Current();
+            if (step != nullptr && step->m_owner == &runtime) step->m_changes.push_back({ &m_handledEvents, &m_deferredEvents, true });
+            else runtime.m_epochs.onEntry(m_handledEvents, m_deferredEvents);
+
+            try
+            {
+                // State's entry job
+                onEntry();
+            }
+            catch (...)
+            {
+                // State's error job
+                onError(std::current_exception());
+            }
+        }
+
+        /**
+         * @brief       stopImpl
+         * @param[in]   runtime: the runtime to update
+         * @param[in]   evt: event triggering the state's exit
+         * @details     Stops the current state
+         *              - Stores the triggering event
+         *              - For each region:
+         *                  - Recursively stops the current sub-state if any
+         *                  - Stores the last visited sub-state depending on the history flag
+         *                  - Resets the current sub-state
+         *              - Performs the exit job
+         */
+        void stopImpl(details::Runtime& runtime, const EventBase* evt)
+        {
+            // Backup triggering event
+            runtime.m_trigEvents[m_node] = evt;
+
+            // Loop over orthogonal regions
+            for (auto&[_, region] : m_regions)
+            {
+                region->stop(runtime, evt);
+            }
+
+            this->exitImpl(runtime, evt);
+        }
+
+        /**
+         * @brief       exitImpl
+         * @param[in]   runtime: the runtime to update
+         * @param[in]   evt: event triggering the state's exit
+         * @details     Exits this state only, once its regions are stopped
+         */
+        void exitImpl(details::Runtime& runtime, const EventBase* evt)
+        {
+            try
+            {
+                // State's exit job
+                onExit();
+            }
+            catch (...)
+            {
+                // State's error job
+                onError(std::current_exception());
+            }
+
+            traceImpl(Log::TracePoint::Exit, evt);
+
+            // New configuration: events deferred by this state shall be retried
+            auto step = details::RegionStep::Current();
+            if (step != nullptr && step->m_owner == &runtime) step->m_changes.push_back({ &m_handledEvents, &m_deferredEvents, false });
+            else runtime.m_epochs.onExit(m_handledEvents, m_deferredEvents);
+
+            runtime.m_started[m_node] = 0;
+        }
+
+        /**
+         * @brief       addState
+         * @param[in]   parent: the parent state where this state shall be added
+         * @details     Tries to add this state as a child state to the provided parent state in parameter
+         */
+        void addState(StateBase* parent)
+        {
+            // parent cannot be null by design
+
+            Region* region{ nullptr };
+            auto itRegion = parent->m_regions.find(m_regionIndex);
+            if (itRegion != parent->m_regions.end())
+            {
+                region = itRegion->second;
+
+                // No more than one entry point allowed in a single region
+                if (true == m_entry)
+                {
+                    for (const auto&[_, child] : region->m_children)
+                    {
+                        if (true == child->m_entry)
+                        {
+                            throw details::SmError() << "Failed to add entry point state '" << m_name << "'. The parent's region already has an entry point which is state '" << child->m_name << "'";
+                        }
+                    }
+                }
+            }
+            else
+            {
+                region = new Region();
+
+                if (nullptr == region)
+                {
+                    throw details::SmError() << "Failed to create region";
+                }
+
+                parent->m_regions[m_regionIndex] = region;
+
+                // Set the region's index
+                region->m_index = m_regionIndex;
+            }
+
+            // Set the child state's parent region
+            m_parentRegion = region;
+
+            // Set the region's parent state
+            region->m_parentState = parent;
+
+            // Add the newly created state to the corresponding region
+            region->m_children.emplace(m_index, this);
+
+            if (m_topSm != nullptr) m_topSm->m_numbered = false;
+            if (m_topSm != nullptr) ++m_topSm->m_revision;
+
+            // Index the newly created state by its type identifier
+            if (m_topSm != nullptr && m_topSm->m_stateIndex != nullptr)
+            {
+                auto& index = *m_topSm->m_stateIndex;
+                if (m_id >= index.size()) index.resize(m_id + 1, nullptr);
+                index[m_id] = this;
+            }
+
+            // Define the entry state if needed
+            if (true == m_entry) region->m_entryState = this;
+        }
+
+        /**
+         * @brief       addTransition
+         * @param[in]   transition: transition to add
+         * @details     Adds the provided transition to its source state
+         */
+        void addTransition(details::TransitionBase* transition)
+        {
+            // transition cannot be null by design
+            // source state cannot be null by design
+            StateBase* srcState = transition->m_srcState;
+
+            if (srcState->findTransition(transition->m_eventId) != nullptr)
+            {
+                throw details::SmError() << "Trying to insert an already existing transition";
+            }
+
+            if (true == srcState->defers(transition->m_eventId))
+            {
+                throw details::SmError() << "Trying to insert a transition on an event deferred by state '" << srcState->m_name << "'";
+            }
+
+            // Add the newly created Transition to the transitions container, keeping it sorted
+            auto& transitions = srcState->m_transitions;
+            const auto it = std::lower_bound(transitions.begin(), transitions.end(), transition->m_eventId,
+                [](const TransitionRecord& record, TEventId id) { return record.m_eventId < id; });
+            transitions.insert(it, TransitionRecord{ transition->m_eventId, transition });
+            srcState->m_handledEvents.push_back(transition->m_eventId);
+
+            if (m_topSm != nullptr) ++m_topSm->m_revision;
+        }
+
+        /**
+         * @brief       findTransition
+         * @param[in]   eventId: event identifier
+         * @return      The state's transition for the event, nullptr if none
+         */
+        details::TransitionBase* findTransition(TEventId eventId) const
+        {
+            const auto it = std::lower_bound(m_transitions.begin(), m_transitions.end(), eventId,
+                [](const TransitionRecord& record, TEventId id) { return record.m_eventId < id; });
+            return (it != m_transitions.end() && eventId == it->m_eventId) ? it->m_transition : nullptr;
+        }
+
+        /**
+         * @brief       defers
+         * @param[in]   eventId: event identifier
+         * @return      true if the state declares the event as deferred, false otherwise
+         */
+        bool defers(TEventId eventId) const
+        {
+            return m_deferredEvents.end() != std::find(m_deferredEvents.begin(), m_deferredEvents.end(), eventId);
+        }
+
+        /**
+         * @brief       addDeferredEvent
+         * @param[in]   eventId: identifier of the event to defer
+         * @details     Declares the event as deferred while this state is active
+         */
+        void addDeferredEvent(TEventId eventId)
+        {
+            if (findTransition(eventId) != nullptr)
+            {
+                throw details::SmError() << "Trying to defer an event state '" << m_name << "' has a transition for";
+            }
+
+            if (true == defers(eventId))
+            {
+                throw details::SmError() << "Trying to defer an already deferred event";
+            }
+
+            m_deferredEvents.push_back(eventId);
+        }
+
+        /**
+         * @brief       setupStatesImpl
+         * @details     Recursively adds the user provided states (through getStates overrides) to the state machine
+         */
+        void setupStatesImpl()
+        {
+            for (auto& state : getStates())
+            {
+                try
+                {
+                    if (state != nullptr) state->addState(this);
+                }
+                catch (...)
+                {
+                    delete state;
+                    state = nullptr;
+
+                    // State's error job
+                    onError(std::current_exception());
+                }
+
+            }
+
+            for (const auto&[_, region] : m_regions)
+            {
+                for (const auto&[_, child] : region->m_children)
+                {
+                    child->setupStatesImpl();
+                }
+            }
+        }
+
+        /**
+         * @brief       setupTransitionsImpl
+         * @details     Recursively adds the user provided transitions (through getTransitions overrides) to the state machine
+         */
+        void setupTransitionsImpl()
+        {
+            for (auto& transition : getTransitions())
+            {
+                try
+                {
+                    if (transition != nullptr) addTransition(transition);
+                }
+                catch (...)
+                {
+                    delete transition;
+                    transition = nullptr;
+
+                    // State's error job
+                    onError(std::current_exception());
+                }
+            }
+
+            for (const auto&[_, region] : m_regions)
+            {
+                for (const auto&[_, child] : region->m_children)
+                {
+                    child->setupTransitionsImpl();
+                }
+            }
+        }
+
+        /**
+         * @brief       setupDeferredEventsImpl
+         * @details     Recursively adds the user provided deferred events (through getDeferredEvents overrides) to the state machine
+         */
+        void setupDeferredEventsImpl()
+        {
+            for (auto eventId : getDeferredEvents())
+            {
+                try
+                {
+                    addDeferredEvent(eventId);
+                }
+                catch (...)
+                {
+                    // State's error job
+                    onError(std::current_exception());
+                }
+            }
+
+            for (const auto&[_, region] : m_regions)
+            {
+                for (const auto&[_, child] : region->m_children)
+                {
+                    child->setupDeferredEventsImpl();
+                }
+            }
+        }
+
+        /**
+         * @brief       setupHistoryImpl
+         * @details     Recursively sets the user provided histories (through getHistory overrides) to the state machine
+         */
+        void setupHistoryImpl()
+        {
+            for (auto&[index, region] : m_regions)
+            {
+                region->setHistory(getHistory(index));
+
+                for (const auto&[_, child] : region->m_children)
+                {
+                    child->setupHistoryImpl();
+                }
+            }
+        }
+
+        /**
+         * @brief   getDescendantImpl
+         * @details Searches downwards in descendants for the state with the specified type StateType.
+         *          Looks the top-sm's index up, then checks that the found state descends from this one
+         * @return  Pointer to the found state if any, nullptr otherwise
+         */
+        template <typename StateType>
+        StateType* getDescendantImpl()
+        {
+            static_assert(details::is_state_v<StateType>, "StateType must inherit from State");
+
+            // Check self state index
+            if (true == details::CheckIndex<StateType>(m_index)) return static_cast<StateType*>(this);
+
+            if (m_topSm != nullptr && m_topSm->m_stateIndex != nullptr)
+            {
+                const auto& index = *m_topSm->m_stateIndex;
+                const auto id = details::StateId<StateType>();
+                if (id >= index.size() || nullptr == index[id]) return nullptr;
+
+                auto state = index[id];
+                if (false == contains(state)) return nullptr;
+                return static_cast<StateType*>(state);
+            }
+
+            // Not attached to a top-sm: recursive search
+
+            // Loop over orthogonal regions
+            for (const auto&[_, region] : m_regions)
+            {
+                auto state = region->template getDescendant<StateType>();
+                if (state != nullptr) return state;
+            }
+
+            return nullptr;
+        }
+
+        /**
+         * @brief   getAncestorImpl
+         * @details Recursively searches upwards in ancestors for the state with the specified type StateType
+         * @return  Pointer to the found state if any, nullptr otherwise
+         */
+        template <typename StateType>
+        StateType* getAncestorImpl()
+        {
+            static_assert(details::is_state_v<StateType>, "StateType must inherit from State");
+
+            // Check self state index
+            if (true == details::CheckIndex<StateType>(m_index)) return static_cast<StateType*>(this);
+
+            // Recurse stop condition
+            if (nullptr == m_parentState) return nullptr;
+
+            // Recurse call
+            return m_parentState->template getAncestorImpl<StateType>();
+        }
+
+        /**
+         * @brief   Propagate
+         * @details Helper function that computes the history propagation flag according to previous propagation flag and provided region's history
+         * @return  true if previous propagation flag is true or if provided region has deep history, false otherwise
+         */
+        static bool Propagate(bool propagateHistory, const Region* region)
+        {
+            return true == propagateHistory || History::Deep == region->m_history;
+        }
+
+        /**
+         * @brief       transitImpl
+         * param[in]    runtime: the runtime to update
+         * param[in]    evt: transition's triggering event
+         * param[in]    data: transition's data
+         * @details     Performs the transition from current to destination state, called on the common ancestor:
+         *              - Exits from current state
+         *              - Updates current state
+         *              - Enters into destination state
+         * @return      true if transition succeeded, false if the common ancestor is no longer active
+         */
+        bool transitImpl(details::Runtime& runtime, const EventBase* evt, const TransitionData& data)
+        {
+            // An active state implies active ancestors
+            if (false == runtime.started(m_node)) return false;
+
+            if (details::UnknownConfiguration != runtime.m_configuration) runtime.m_configuration = details::UnknownConfiguration;
+
+            bool propagate = false;
+            for (auto state = this; state->m_parentRegion != nullptr; state = state->m_parentState) propagate = Propagate(propagate, state->m_parentRegion);
+
+            if (data.srcOutermost != nullptr && true == runtime.started(data.srcOutermost->m_node)) data.srcOutermost->stopImpl(runtime, evt);
+            propagate = Propagate(propagate, data.dstOutermost->m_parentRegion);
+            data.dst->startAncestors(runtime, evt, data, this, propagate);
+            return true;
+        }
+
+        /**
+         * @brief       transitImpl
+         * param[in]    runtime: the runtime to update
+         * param[in]    evt: transition's triggering event
+         * param[in]    data: transition's data
+         * param[in]    path: transition's flattened path
+         * @details     Same as above, walking the precomputed path instead of the hierarchy
+         * @return      true if transition succeeded, false if the common ancestor is no longer active
+         */
+        bool transitImpl(details::Runtime& runtime, const EventBase* evt, const TransitionData& data, const TransitionPath& path)
+        {
+            if (false == runtime.started(m_node)) return false;
+
+            if (details::UnknownConfiguration != runtime.m_configuration) runtime.m_configuration = details::UnknownConfiguration;
+
+            bool propagate = false;
+            for (auto region : path.ancestorRegions) propagate = Propagate(propagate, region);
+
+            if (true == runtime.started(data.srcOutermost->m_node)) data.srcOutermost->stopImpl(runtime, evt);
+
+            const auto& chain = path.entryChain;
+            for (std::size_t i = 0; i + 1 < chain.size(); ++i) propagate = chain[i]->enterAncestor(runtime, evt, chain[i + 1], propagate);
+
+            data.dst->m_parentRegion->start(runtime, evt, Propagate(propagate, data.dst->m_parentRegion), data.dst);
+            return true;
+        }
+
+        /**
+         * @brief       getTransitionPath
+         * param[in]    data: transition's data
+         * @return      The flattened path of the transition
+         */
+        static TransitionPath GetTransitionPath(const TransitionData& data)
+        {
+            TransitionPath path;
+
+            for (auto state = data.commonAncestor; state->m_parentRegion != nullptr; state = state->m_parentState) path.ancestorRegions.push_back(state->m_parentRegion);
+
+            for (auto state = data.dst; state != data.commonAncestor; state = state->m_parentState) path.entryChain.push_back(state);
+            std::reverse(path.entryChain.begin(), path.entryChain.end());
+
+            return path;
+        }
+
+        /**
+         * @brief           startAncestors
+         * param[in]        runtime: the runtime to update
+         * param[in]        evt: transition's triggering event
+         * param[in]        data: transition's data
+         * param[in]        previousState: previous calling state
+         * param[in,out]    propagateHistory: history propagation flag
+         * @details         Starts the destination state and all its ancestors up to the outermost destination.
+         *                  The starting order is descending from outermost to innermost and takes into account the history propagation flag
+         */
+        void startAncestors(details::Runtime& runtime, const EventBase* evt, const TransitionData& data, StateBase* previousState, bool& propagateHistory)
+        {
+            // If we've reached the common ancestor, just leave out
+            if (this == data.commonAncestor) return;
+
+            // Move upwards until outermost destination is reached
+            // Don't mutate the history propagation since this is the one from common ancestor
+            this->m_parentState->startAncestors(runtime, evt, data, this, propagateHistory);
+
+            // We've reached the outermost destination. If it's also the destination, then start it
+            if (this == data.dst)
+            {
+                this->m_parentRegion->start(runtime, evt, Propagate(propagateHistory, m_parentRegion), this);
+                return;
+            }
+
+            propagateHistory = enterAncestor(runtime, evt, previousState, propagateHistory);
+        }
+
+        /**
+         * @brief       enterAncestor
+         * param[in]    runtime: the runtime to update
+         * param[in]    evt: transition's triggering event
+         * param[in]    next: the next state of the entry chain, child of this state
+         * param[in]    propagateHistory: history propagation flag
+         * @details     Starts this ancestor of the destination and all its regions but the one containing the next state
+         * @return      The history propagation flag for the next state
+         */
+        bool enterAncestor(details::Runtime& runtime, const EventBase* evt, const StateBase* next, bool propagateHistory)
+        {
+            bool propagate = Propagate(propagateHistory, m_parentRegion);
+
+            this->m_parentRegion->setCurrent(runtime, this);
+
+            this->startImpl(runtime, evt, false, false);
+
+            for (const auto&[_, region] : this->m_regions)
+            {
+                if (region != next->m_parentRegion) region->start(runtime, evt, propagate);
+            }
+
+            return propagate;
+        }
+
+        /**
+         * @brief       getTransitionData
+         * param[in]    runtime: the runtime to read
+         * param[in]    dst: the destination state
+         * @details     Calculates the transition data for transitions performed from the top state machine.
+         *              In this case, the common ancestor is the first started state containing the destination,
+         *              the source outermost is the current state of the common ancestor,
+         *              and the destination outermost is the common ancestor's child
+         * @return      A non null transition data structure if it could be computed, nullopt otherwise
+         */
+        std::optional<TransitionData> getTransitionData(const details::Runtime& runtime, StateBase* dst)
+        {
+            if (nullptr == this->m_parentState) return std::nullopt;
+            if (false == runtime.started(this->m_parentState->m_node)) return this->m_parentState->getTransitionData(runtime, dst);
+            auto srcOutermost = this->m_parentRegion->current(runtime);
+            return TransitionData{ this->m_parentState, srcOutermost, this, srcOutermost, dst };
+        }
+
+        /**
+         * @brief       getTransitionData
+         * param[in]    src: the source state
+         * param[in]    dst: the destination state
+         * @details     In this case, the common ancestor is the first state containing both source and destination states
+         * @return      A non null transition data structure if it could be computed, nullopt otherwise
+         */
+        std::optional<TransitionData> getTransitionData(StateBase* src, StateBase* dst)
+        {
+            // Lowest common ancestor strictly containing the destination. Each step costs a constant time contains check
+            auto commonAncestor = dst->m_parentState;
+            while (commonAncestor != nullptr && false == commonAncestor->contains(src)) commonAncestor = commonAncestor->m_parentState;
+
+            // No common ancestor, or source and destination are nested
+            if (nullptr == commonAncestor || src == commonAncestor) return std::nullopt;
+
+            auto srcOutermost = commonAncestor->getChild(src);
+            auto dstOutermost = commonAncestor->getChild(dst);
+            if (srcOutermost == dstOutermost) return std::nullopt;
+
+            // Crossing regions
+            if (srcOutermost->m_parentRegion != dstOutermost->m_parentRegion) return std::nullopt;
+
+            return TransitionData{ commonAncestor, srcOutermost, dstOutermost, src, dst };
+        }
+
+        /**
+         * @brief       getChild
+         * param[in]    descendant: a strict descendant of this state
+         * @return      The child of this state containing the provided descendant
+         */
+        StateBase* getChild(StateBase* descendant) const
+        {
+            while (descendant->m_parentState != this) descendant = descendant->m_parentState;
+            return descendant;
+        }
+
+        /**
+         * @brief       numberStates
+         * @details     Top-sm only: assigns pre-order and post-order numbers to all states if the topology changed since the last numbering.
+         *              Called once the topology is complete, i.e. after setting up the states and on start
+         */
+        void numberStates() const
+        {
+            if (true == m_numbered) return;
+
+            std::size_t counter = 0;
+            numberStatesImpl(counter);
+            m_numbered = true;
+        }
+
         /**
-         * @brief           visitImpl
-         * @param[in,out]   visitor: applied visitor
-         * @details         Visits the current state and sub-states
+         * @brief           numberStatesImpl
+         * @param[in,out]   counter: traversal counter
+         * @details         Recursively numbers this state and its descendants
          */
-        void visitImpl(IStateVisitor& visitor)
+        void numberStatesImpl(std::size_t& counter) const
         {
-            visitor.visit(this);
+            m_preOrder = counter++;
+
             for (const auto&[_, region] : m_regions)
             {
-                if (region->m_currentState != nullptr) region->m_currentState->visitImpl(visitor);
+                region->m_preOrder = counter;
+
+                for (const auto&[_, child] : region->m_children)
+                {
+                    child->numberStatesImpl(counter);
+                }
+
+                region->m_postOrder = counter - 1;
             }
+
+            m_postOrder = counter++;
         }
 
         /**
-         * @brief       StateBase
-         * @param[in]   index: sub-class type index
-         * @details     StateBase ctor
+         * @brief       indexEvents
+         * @details     Recursively computes the events handled by this state and its descendants
          */
-        explicit StateBase(const std::type_index& index)
-            : m_index{ index }
-        {}
-
-        void setupImpl()
+        void indexEvents()
         {
-            // Order matters
-            this->setupStatesImpl();
-            this->setupTransitionsImpl();
-            this->setupHistoryImpl();
+            m_subtreeEvents.clear();
+            for (auto id : m_handledEvents) m_subtreeEvents.insert(id);
+
+            for (const auto&[_, region] : m_regions)
+            {
+                for (const auto&[_, child] : region->m_children)
+                {
+                    child->indexEvents();
+                    m_subtreeEvents.merge(child->m_subtreeEvents);
+                }
+            }
         }
 
         /**
-         * @brief   clearImpl
-         * @details Recursively destro this state and its children
+         * @brief       processEventImpl
+         * param[in]    runtime: the runtime to update
+         * param[in]    evt: Event to process
+         * @details     Processes the provided event:
+         *              - Skips the whole subtree if none of its states handles the event
+         *              - Searches for a transition with index corresponding with the provided Event's type index
+         *              - If such transition found, execute its callback using the provided event as parameter
+         *              - If no transition found, recursively search inside sub-states
          */
-        void clearImpl()
+        bool processEventImpl(details::Runtime& runtime, const EventBase& evt, bool propagateHistory) const
         {
-            for (auto&[_, transition] : m_transitions)
+            if (false == m_subtreeEvents.contains(evt.m_id)) return false;
+
+            // Lookup of the transition handling the event's identifier
+            if (auto transition = findTransition(evt.m_id))
             {
-                delete transition;
-                transition = nullptr;
+                // Execute the transition and break recursive chain if successful
+                if (true == transition->exec(runtime, evt)) return true;
             }
 
-            m_transitions.clear();
+            bool result{ false };
 
-            for (auto&[_, region] : m_regions)
+            // Recursive calls over sub-states if no transition found yet
+            for (const auto&[_, region] : m_regions)
             {
-                for (auto&[_, child] : region->m_children)
+                if (auto current = region->current(runtime); current != nullptr)
                 {
-                    delete child;
-                    child = nullptr;
+                    result |= current->processEventImpl(runtime, evt, Propagate(propagateHistory, region));
                 }
-
-                region->m_children.clear();
-
-                delete region;
-                region = nullptr;
             }
 
-            m_regions.clear();
+            return result;
         }
 
         /**
-         * @brief   ~StateBase
-         * @details StateBase dtor
+         * @brief   checkStatesImpl
+         * @details Terminating recursive variadic call
          */
-        virtual ~StateBase()
+        template <typename ...StateTypes, typename = details::is_empty_pack<StateTypes...>>
+        bool checkStatesImpl(const details::Runtime& runtime, StateBase* previousState = nullptr)
         {
-            clearImpl();
+            return runtime.started(m_node);
         }
 
         /**
-         * @brief   getStates
-         * @details Allows statemachine states setup when overriden by user
-         * @return  User defined states
-         */
-        virtual TStates getStates() { return {}; }
-
-        /**
-         * @brief   getTransitions
-         * @details Allows statemachine transitions setup when overriden by user
-         * @return  User defined transitions
-         */
-        virtual TTransitions getTransitions() { return {}; }
-
-        /**
-         * @brief   getHistory
-         * @details Allows statemachine history setup when overriden by user
-         * @return  User defined history
-         */
-        virtual THistory getHistory(int regionIndex) { return {}; }
-
-        /**
-         * @brief   onEntry
-         * @details State's entry job
+         * @brief   checkStatesImpl
+         * @details Checks wether the provided state in template parameters are active (started)
+         *          Order in which states are provided matters, and there cannot be "holes"
          */
-        virtual void onEntry()
+        template <typename FirstStateType, typename ...OtherStateTypes>
+        bool checkStatesImpl(const details::Runtime& runtime, StateBase* previousState = nullptr)
         {
-            LOG_DEBUG_DSM("Entering state " << m_name << " through event " << (m_trigEvent != nullptr ? m_trigEvent->m_name : "anonymous"));
+            static_assert(details::is_state_v<FirstStateType>, "FirstStateType must inherit from State");
+
+            auto state = this->template getDescendantImpl<FirstStateType>();
+            if (nullptr == state) return false;
+            if (state == previousState) return false;
+            if (!runtime.started(state->m_node)) return false;
+            if (previousState != nullptr && state->m_parentState != previousState) return false;
+            if constexpr (0 == sizeof ...(OtherStateTypes)) return true;
+            else return state->template checkStatesImpl<OtherStateTypes...>(runtime, state);
         }
+    };
 
+    namespace details
+    {
         /**
-         * @brief   onExit
-         * @details State's exit job
+         * @brief   PostedTransition
+         * @details Element of the state machine's run-to-completion queue. Either:
+         *          - a posted or deferred event
+         *          - a user transition requested from within a state, along with its optional triggering event
          */
-        virtual void onExit()
+        struct PostedTransition
         {
-            LOG_DEBUG_DSM("Leaving state " << m_name << " through event " << (m_trigEvent != nullptr ? m_trigEvent->m_name : "anonymous"));
-        }
+            PostedTransition() = default;
+
+            /**
+             * @brief       PostedTransition
+             * @param[in]   evt: posted or deferred event, copied into the envelope
+             * @param[in]   deferred: whether the event is deferred or posted
+             */
+            explicit PostedTransition(const dsm::EventBase& evt, bool deferred = false)
+                : m_deferred{ deferred }
+            {
+                m_evt.assign(evt);
+            }
+
+            /**
+             * @brief       PostedTransition
+             * @param[in]   topSm: the top-sm state performing the transition
+             * @param[in]   data: the transition's data
+             * @param[in]   evt: the transition's triggering event, copied into the envelope, if any
+             */
+            PostedTransition(dsm::StateBase* topSm, const dsm::StateBase::TransitionData& data, const dsm::EventBase* evt = nullptr)
+                : m_topSm{ topSm }
+                , m_data{ data }
+            {
+                if (evt != nullptr) m_evt.assign(*evt);
+            }
+
+            PostedTransition(PostedTransition&& other)
+                : m_evt{ std::move(other.m_evt) }
+                , m_topSm{ std::exchange(other.m_topSm, nullptr) }
+                , m_data{ other.m_data }
+                , m_deferred{ std::exchange(other.m_deferred, false) }
+            {}
+
+            PostedTransition& operator=(PostedTransition&& other)
+            {
+                m_evt = std::move(other.m_evt);
+                m_topSm = std::exchange(other.m_topSm, nullptr);
+                m_data = other.m_data;
+                m_deferred = std::exchange(other.m_deferred, false);
+                return *this;
+            }
+
+            /**
+             * @brief   isTransition
+             * @return  true if this is a user transition, false if this is a posted or deferred event
+             */
+            bool isTransition() const
+            {
+                return m_topSm != nullptr;
+            }
+
+            /**
+             * @brief       exec
+             * @param[in]   runtime: the runtime to update
+             * @details     Executes the user transition
+             */
+            bool exec(Runtime& runtime) const
+            {
+                return m_data.commonAncestor->transitImpl(runtime, m_evt.get(), m_data);
+            }
+
+            /**
+             * @brief   clone
+             * @return  Returns a copy of this element, its event copied into a new envelope
+             */
+            PostedTransition clone() const
+            {
+                if (true == isTransition()) return PostedTransition{ m_topSm, m_data, m_evt.get() };
+                return PostedTransition{ *m_evt.get(), m_deferred };
+            }
+
+            /**
+             * @brief   m_evt
+             * @details The posted or deferred event, or the transition's triggering event
+             */
+            EventEnvelope m_evt;
+
+            /**
+             * @brief   m_topSm
+             * @details The top-sm state for user transitions, nullptr otherwise
+             */
+            dsm::StateBase* m_topSm = nullptr;
+
+            /**
+             * @brief   m_data
+             * @details The user transition's data
+             */
+            dsm::StateBase::TransitionData m_data;
+
+            bool m_deferred = false;
+        };
 
         /**
-         * @brief       onError
-         * @param[in]   ex: exception causing this call
-         * @details     State's error job
+         * @brief   DeferredTransition
+         * @details Deferred event that no active state handled yet
          */
-        virtual void onError(std::exception_ptr eptr)
+        struct DeferredTransition
         {
-            LOG_ERROR_DSM(what(std::move(eptr)));
-        }
+            PostedTransition m_transition;
+
+            /**
+             * @brief   m_order
+             * @details Deferring order among all deferred events
+             */
+            std::uint64_t m_order = 0;
+
+            /**
+             * @brief   m_tried
+             * @details Configuration epoch of the last try
+             */
+            std::uint64_t m_tried = 0;
+        };
 
         /**
-         * @brief       startImpl
-         * @param[in]   evt: event triggering the state's entry
-         * @details     Starts the current state
-         *              - Stores the triggering event
-         *              - Processes any defered event
-         *              - Performs the entry job
-         *              - For each region:
-         *                  - Restores the current sub-state depending on the history flag
-         *                  - Recursively starts the current sub-state if any
+         * @brief   FlatMachine
+         * @details Flat form of a state machine whose reachable configuration space is small, built by StateMachine::compile.
+         *          A configuration is the current sub-state of every region, along with the last visited sub-state of the regions
+         *          whose history may be restored. Reachable configurations are enumerated without calling any user code, and each one holds:
+         *          - for each event, the transitions of its active states in the order the hierarchy would try them
+         *          - for each external transition of its active states, the exit and entry sequence and the next configuration
+         *          Processing an event then costs a table lookup, the guard and action calls, and the replay of the taken transitions' sequences
          */
-        void startImpl(const EventBase* evt, bool propagateHistory, bool recurse = true)
+        class FlatMachine
         {
-            m_started = true;
+        public:
+            static constexpr std::size_t DefaultMaxConfigurations = 4096;
+
+            /**
+             * @brief       build
+             * @param[in]   topSm: the top-sm state to flatten
+             * @param[in]   maxConfigurations: maximum number of reachable configurations
+             * @return      true if the table was built, false if the reachable configurations exceed the provided maximum
+             */
+            bool build(dsm::StateBase* topSm, std::size_t maxConfigurations)
+            {
+                clear();
+                m_topSm = topSm;
+                m_revision = topSm->m_revision;
+
+                addRegions(topSm, false);
+                addTransitions(topSm);
+
+                // Initial configuration
+                TKey key(2 * m_regions.size(), nullptr);
+                std::vector<Op> ops;
+                start(topSm, false, key, ops);
+                addConfiguration(std::move(key));
+
+                // Breadth-first enumeration of the reachable configurations
+                for (std::size_t configuration = 0; configuration < m_keys.size(); ++configuration)
+                {
+                    addPlans(configuration);
+                    addMoves(configuration);
+
+                    if (m_keys.size() > maxConfigurations)
+                    {
+                        clear();
+                        return false;
+                    }
+                }
+
+                m_indices.clear();
+                m_ready = true;
+                return true;
+            }
+
+            /**
+             * @brief   clear
+             * @details Discards the table
+             */
+            void clear()
+            {
+                m_ready = false;
+                m_events = 0;
+                m_regions.clear();
+                m_restorable.clear();
+                m_transitions.clear();
+                m_indices.clear();
+                m_ids.clear();
+                m_keys.clear();
+                m_plans.clear();
+                m_candidates.clear();
+                m_moves.clear();
+                m_ops.clear();
+            }
+
+            bool ready() const
+            {
+                return m_ready;
+            }
+
+            std::size_t configurations() const
+            {
+                return m_keys.size();
+            }
+
+            /**
+             * @brief   revision
+             * @return  The top-sm's revision the table was last built from
+             */
+            std::uint64_t revision() const
+            {
+                return m_revision;
+            }
+
+            /**
+             * @brief       resync
+             * @param[in]   runtime: the runtime to read
+             * @details     Looks the runtime's active configuration up
+             * @return      true if the active configuration is a reachable one, false otherwise
+             */
+            bool resync(Runtime& runtime) const
+            {
+                if (false == m_ready) return false;
+
+                TKey key(2 * m_regions.size(), nullptr);
+                for (std::size_t slot = 0; slot < m_regions.size(); ++slot)
+                {
+                    key[2 * slot] = runtime.state(runtime.m_current[slot]);
+                    if (true == m_restorable[slot]) key[2 * slot + 1] = runtime.state(runtime.m_last[slot]);
+                }
+
+                auto it = m_ids.find(key);
+                runtime.m_configuration = (it != m_ids.end()) ? it->second : UnknownConfiguration;
+                return runtime.m_configuration != UnknownConfiguration;
+            }
+
+            /**
+             * @brief       process
+             * @param[in]   runtime: the runtime to update
+             * @param[in]   evt: the event to process
+             * @param[out]  handled: whether a transition handled the event
+             * @return      true if the event was processed through the table, false if the table is not built or the active configuration is unknown
+             */
+            bool process(Runtime& runtime, const dsm::EventBase& evt, bool& handled) const
+            {
+                if (false == m_ready) return false;
+                if (UnknownConfiguration == runtime.m_configuration && false == resync(runtime)) return false;
+
+                handled = false;
+                if (evt.m_id >= m_events) return true;
+
+                const auto& plan = m_plans[runtime.m_configuration * m_events + evt.m_id];
+                std::size_t skip = 0;
+
+                for (auto candidate = plan.m_begin; candidate < plan.m_end; ++candidate)
+                {
+                    const auto index = m_candidates[candidate];
+                    const auto& transition = m_transitions[index];
+
+                    // Sub-states of a state that handled the event, or states exited by a previous transition
+                    if (transition.m_src->m_preOrder < skip || false == runtime.started(transition.m_src->m_node)) continue;
+
+                    if (false == transition.m_transition->fire(evt)) continue;
+
+                    handled = true;
+                    if (UnknownConfiguration == runtime.m_configuration) return true;
+                    skip = transition.m_src->m_postOrder;
+
+                    if (true == transition.m_external)
+                    {
+                        const auto& move = m_moves[runtime.m_configuration * m_transitions.size() + index];
+                        replay(runtime, move, evt);
+                        runtime.m_configuration = move.m_next;
+                    }
+                }
+
+                return true;
+            }
+
+        private:
+            using TKey = std::vector<dsm::StateBase*>;
+            using Region = dsm::StateBase::Region;
+
+            /**
+             * @brief   OpKind
+             * @details Elementary step of an exit and entry sequence, each one matching a part of the hierarchy's stop and start
+             */
+            enum class OpKind : std::uint8_t
+            {
+                Leave = 0,  // Stores the triggering event of a state about to stop its regions
+                Stop,       // Stops a region whose current sub-state is exited
+                Exit,       // Exits a state
+                Select,     // Sets the current sub-state of a region
+                Enter       // Enters a state
+            };
+
+            struct Op
+            {
+                OpKind m_kind;
+                dsm::StateBase* m_state;
+                Region* m_region;
+            };
+
+            struct Range
+            {
+                std::size_t m_begin = 0;
+                std::size_t m_end = 0;
+            };
+
+            struct Move
+            {
+                std::size_t m_begin = 0;
+                std::size_t m_end = 0;
+                std::size_t m_next = UnknownConfiguration;
+            };
+
+            struct Transition
+            {
+                const TransitionBase* m_transition = nullptr;
+                dsm::StateBase* m_src = nullptr;
+                bool m_external = false;
+                dsm::StateBase::TransitionData m_data = {};
+                dsm::StateBase::TransitionPath m_path = {};
+            };
+
+            struct KeyLess
+            {
+                bool operator()(const TKey& lhs, const TKey& rhs) const
+                {
+                    return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), std::less<const dsm::StateBase*>{});
+                }
+            };
 
-            // Backup triggering event
-            m_trigEvent = evt;
+            static std::size_t Current(const Region* region) { return 2 * region->m_slot; }
+            static std::size_t Last(const Region* region) { return 2 * region->m_slot + 1; }
 
-            try
-            {
-                // State's entry job
-                onEntry();
-            }
-            catch (...)
+            void addRegions(dsm::StateBase* state, bool deepAbove)
             {
-                // State's error job
-                onError(std::current_exception());
+                for (const auto&[_, region] : state->m_regions)
+                {
+                    // Slots assigned by the top-sm's layout
+                    if (region->m_slot >= m_regions.size())
+                    {
+                        m_regions.resize(region->m_slot + 1, nullptr);
+                        m_restorable.resize(region->m_slot + 1, false);
+                    }
+
+                    m_regions[region->m_slot] = region;
+                    m_restorable[region->m_slot] = region->m_history != std::nullopt || true == deepAbove;
+
+                    for (const auto&[_, child] : region->m_children)
+                    {
+                        addRegions(child, true == deepAbove || History::Deep == region->m_history);
+                    }
+                }
             }
 
-            if (true == recurse)
+            void addTransitions(dsm::StateBase* state)
             {
-                // Loop over orthogonal regions
-                for (auto&[_, region] : m_regions)
+                for (const auto& record : state->m_transitions)
                 {
-                    region->start(evt, propagateHistory);
-                }
-            }
-        }
+                    const auto transition = record.m_transition;
 
-        /**
-         * @brief       stopImpl
-         * @param[in]   evt: event triggering the state's exit
-         * @details     Stops the current state
-         *              - Stores the triggering event
-         *              - For each region:
-         *                  - Recursively stops the current sub-state if any
-         *                  - Stores the last visited sub-state depending on the history flag
-         *                  - Resets the current sub-state
-         *              - Performs the exit job
-         */
-        void stopImpl(const EventBase* evt)
-        {
-            // Backup triggering event
-            m_trigEvent = evt;
+                    Transition flat{ transition, state };
+                    if (transition->m_dstState != nullptr)
+                    {
+                        // Same computation as at the transition's creation, which succeeded
+                        flat.m_external = true;
+                        flat.m_data = transition->m_dstState->getTransitionData(state, transition->m_dstState).value();
+                        flat.m_path = dsm::StateBase::GetTransitionPath(flat.m_data);
+                    }
 
-            // Loop over orthogonal regions
-            for (auto&[_, region] : m_regions)
-            {
-                region->stop(evt);
+                    m_events = std::max(m_events, transition->m_eventId + 1);
+                    m_indices.emplace(transition, m_transitions.size());
+                    m_transitions.push_back(std::move(flat));
+                }
+
+                for (const auto&[_, region] : state->m_regions)
+                {
+                    for (const auto&[_, child] : region->m_children)
+                    {
+                        addTransitions(child);
+                    }
+                }
             }
 
-            try
+            std::size_t addConfiguration(TKey&& key)
             {
-                // State's exit job
-                onExit();
+                auto [it, inserted] = m_ids.emplace(std::move(key), m_keys.size());
+                if (true == inserted) m_keys.push_back(&it->first);
+                return it->second;
             }
-            catch (...)
+
+            bool isActive(const dsm::StateBase* state, const TKey& key) const
             {
-                // State's error job
-                onError(std::current_exception());
+                return m_topSm == state || key[Current(state->m_parentRegion)] == state;
             }
 
-            m_started = false;
-        }
+            /**
+             * @brief   addPlans
+             * @details Lists, for each event, the transitions of the configuration's active states in pre-order, as the hierarchy tries them
+             */
+            void addPlans(std::size_t configuration)
+            {
+                std::vector<std::vector<std::size_t>> plans(m_events);
+                collect(m_topSm, *m_keys[configuration], plans);
 
-        /**
-         * @brief       addState
-         * @param[in]   parent: the parent state where this state shall be added
-         * @details     Tries to add this state as a child state to the provided parent state in parameter
-         */
-        void addState(StateBase* parent)
-        {
-            // parent cannot be null by design
+                for (const auto& plan : plans)
+                {
+                    Range range{ m_candidates.size(), 0 };
+                    m_candidates.insert(m_candidates.end(), plan.begin(), plan.end());
+                    range.m_end = m_candidates.size();
+                    m_plans.push_back(range);
+                }
+            }
 
-            Region* region{ nullptr };
-            auto itRegion = parent->m_regions.find(m_regionIndex);
-            if (itRegion != parent->m_regions.end())
+            void collect(const dsm::StateBase* state, const TKey& key, std::vector<std::vector<std::size_t>>& plans) const
             {
-                region = itRegion->second;
+                for (const auto& record : state->m_transitions)
+                {
+                    plans[record.m_eventId].push_back(m_indices.at(record.m_transition));
+                }
 
-                // No more than one entry point allowed in a single region
-                if (true == m_entry)
+                for (const auto&[_, region] : state->m_regions)
                 {
-                    for (const auto&[_, child] : region->m_children)
-                    {
-                        if (true == child->m_entry)
-                        {
-                            throw details::SmError() << "Failed to add entry point state '" << m_name << "'. The parent's region already has an entry point which is state '" << child->m_name << "'";
-                        }
-                    }
+                    auto current = key[Current(region)];
+                    if (current != nullptr) collect(current, key, plans);
                 }
             }
-            else
+
+            /**
+             * @brief   addMoves
+             * @details Computes the sequence and next configuration of each external transition whose source is active in the configuration.
+             *          Also reaches the configuration a stop and restart leads to
+             */
+            void addMoves(std::size_t configuration)
             {
-                region = new Region();
+                const auto base = m_moves.size();
+                m_moves.resize(base + m_transitions.size());
 
-                if (nullptr == region)
+                for (std::size_t index = 0; index < m_transitions.size(); ++index)
                 {
-                    throw details::SmError() << "Failed to create region";
+                    const auto& transition = m_transitions[index];
+                    if (false == transition.m_external || false == isActive(transition.m_src, *m_keys[configuration])) continue;
+
+                    TKey key = *m_keys[configuration];
+                    Move move;
+                    move.m_begin = m_ops.size();
+                    transit(transition, key, m_ops);
+                    move.m_end = m_ops.size();
+                    move.m_next = addConfiguration(std::move(key));
+                    m_moves[base + index] = move;
                 }
 
-                parent->m_regions[m_regionIndex] = region;
-
-                // Set the region's index
-                region->m_index = m_regionIndex;
+                TKey key = *m_keys[configuration];
+                std::vector<Op> ops;
+                stop(m_topSm, key, ops);
+                start(m_topSm, false, key, ops);
+                addConfiguration(std::move(key));
             }
 
-            // Set the child state's parent region
-            m_parentRegion = region;
+            // Models of the hierarchy's start, stop and transit, applied to a configuration
 
-            // Set the region's parent state
-            region->m_parentState = parent;
+            void start(dsm::StateBase* state, bool propagateHistory, TKey& key, std::vector<Op>& ops) const
+            {
+                ops.push_back({ OpKind::Enter, state, nullptr });
 
-            // Add the newly created state to the corresponding region
-            region->m_children.emplace(m_index, this);
+                for (const auto&[_, region] : state->m_regions)
+                {
+                    startRegion(region, propagateHistory, nullptr, key, ops);
+                }
+            }
 
-            // Define the entry state if needed
-            if (true == m_entry) region->m_entryState = this;
-        }
+            void startRegion(Region* region, bool propagateHistory, dsm::StateBase* stateToStart, TKey& key, std::vector<Op>& ops) const
+            {
+                dsm::StateBase* current = nullptr;
 
-        /**
-         * @brief       addTransition
-         * @param[in]   transition: transition to add
-         * @details     Adds the provided transition to its source state
-         */
-        void addTransition(details::TransitionBase* transition)
-        {
-            // transition cannot be null by design
-            // source state cannot be null by design
-            StateBase* srcState = transition->m_srcState;
+                if (nullptr == stateToStart)
+                {
+                    auto last = key[Last(region)];
+                    current = (last != nullptr && (region->m_history != std::nullopt || true == propagateHistory)) ? last : region->m_entryState;
+                }
+                else if (region->m_children.end() != region->m_children.find(stateToStart->m_index))
+                {
+                    current = stateToStart;
+                }
 
-            // Add the newly created Transition to the transitions container
-            auto res = srcState->m_transitions.insert({ transition->m_index, transition });
+                ops.push_back({ OpKind::Select, current, region });
+                key[Current(region)] = current;
 
-            if (false == res.second)
-            {
-                throw details::SmError() << "Trying to insert an already existing transition";
+                if (current != nullptr) start(current, dsm::StateBase::Propagate(propagateHistory, region), key, ops);
             }
-        }
 
-        /**
-         * @brief       setupStatesImpl
-         * @details     Recursively adds the user provided states (through getStates overrides) to the state machine
-         */
-        void setupStatesImpl()
-        {
-            for (auto& state : getStates())
+            void stop(dsm::StateBase* state, TKey& key, std::vector<Op>& ops) const
             {
-                try
+                ops.push_back({ OpKind::Leave, state, nullptr });
+
+                for (const auto&[_, region] : state->m_regions)
                 {
-                    if (state != nullptr) state->addState(this);
+                    auto current = key[Current(region)];
+                    if (current != nullptr) stop(current, key, ops);
+
+                    ops.push_back({ OpKind::Stop, nullptr, region });
+                    key[Last(region)] = (true == m_restorable[region->m_slot]) ? current : nullptr;
+                    key[Current(region)] = nullptr;
                 }
-                catch (...)
+
+                ops.push_back({ OpKind::Exit, state, nullptr });
+            }
+
+            void transit(const Transition& transition, TKey& key, std::vector<Op>& ops) const
+            {
+                const auto& data = transition.m_data;
+                const auto& chain = transition.m_path.entryChain;
+
+                bool propagate = false;
+                for (auto region : transition.m_path.ancestorRegions) propagate = dsm::StateBase::Propagate(propagate, region);
+
+                if (key[Current(data.srcOutermost->m_parentRegion)] == data.srcOutermost) stop(data.srcOutermost, key, ops);
+
+                for (std::size_t i = 0; i + 1 < chain.size(); ++i)
                 {
-                    delete state;
-                    state = nullptr;
+                    auto state = chain[i];
+                    propagate = dsm::StateBase::Propagate(propagate, state->m_parentRegion);
 
-                    // State's error job
-                    onError(std::current_exception());
+                    ops.push_back({ OpKind::Select, state, state->m_parentRegion });
+                    key[Current(state->m_parentRegion)] = state;
+                    ops.push_back({ OpKind::Enter, state, nullptr });
+
+                    for (const auto&[_, region] : state->m_regions)
+                    {
+                        if (region != chain[i + 1]->m_parentRegion) startRegion(region, propagate, nullptr, key, ops);
+                    }
                 }
 
+                startRegion(data.dst->m_parentRegion, dsm::StateBase::Propagate(propagate, data.dst->m_parentRegion), data.dst, key, ops);
             }
 
-            for (const auto&[_, region] : m_regions)
+            /**
+             * @brief   replay
+             * @details Applies the provided sequence to the runtime, calling the states' exit and entry jobs
+             */
+            void replay(Runtime& runtime, const Move& move, const dsm::EventBase& evt) const
             {
-                for (const auto&[_, child] : region->m_children)
+                for (auto index = move.m_begin; index < move.m_end; ++index)
                 {
-                    child->setupStatesImpl();
+                    const auto& op = m_ops[index];
+
+                    switch (op.m_kind)
+                    {
+                    case OpKind::Leave:
+                        runtime.m_trigEvents[op.m_state->m_node] = &evt;
+                        break;
+                    case OpKind::Stop:
+                        runtime.m_last[op.m_region->m_slot] = runtime.m_current[op.m_region->m_slot];
+                        runtime.m_current[op.m_region->m_slot] = InvalidNode;
+                        break;
+                    case OpKind::Exit:
+                        op.m_state->exitImpl(runtime, &evt);
+                        break;
+                    case OpKind::Select:
+                        op.m_region->setCurrent(runtime, op.m_state);
+                        break;
+                    case OpKind::Enter:
+                        op.m_state->enterImpl(runtime, &evt);
+                        break;
+                    }
                 }
             }
-        }
+
+            bool m_ready = false;
+            std::uint64_t m_revision = 0;
+            dsm::StateBase* m_topSm = nullptr;
+
+            /**
+             * @brief   m_events
+             * @details Number of event identifiers covered by the plans, i.e. the highest handled identifier plus one
+             */
+            std::size_t m_events = 0;
+
+            std::vector<Region*> m_regions = {};
+
+            /**
+             * @brief   m_restorable
+             * @details Whether the region's last visited sub-state may be restored, i.e. belongs to the configuration, indexed by slot
+             */
+            std::vector<bool> m_restorable = {};
+
+            std::vector<Transition> m_transitions = {};
+            std::map<const TransitionBase*, std::size_t> m_indices = {};
+
+            std::map<TKey, std::size_t, KeyLess> m_ids = {};
+            std::vector<const TKey*> m_keys = {};
+
+            /**
+             * @brief   m_plans
+             * @details Ranges of m_candidates, indexed by configuration then event identifier
+             */
+            std::vector<Range> m_plans = {};
+            std::vector<std::size_t> m_candidates = {};
+
+            /**
+             * @brief   m_moves
+             * @details Sequences of m_ops and next configurations, indexed by configuration then transition
+             */
+            std::vector<Move> m_moves = {};
+            std::vector<Op> m_ops = {};
+        };
 
         /**
-         * @brief       setupTransitionsImpl
-         * @details     Recursively adds the user provided transitions (through getTransitions overrides) to the state machine
+         * @brief   Layout
+         * @details Contiguous form of the top-sm's topology, built on start once the topology is frozen, through which events are dispatched.
+         *          States are laid out in pre-order, the regions of a state are consecutive and so are its transitions.
+         *          Nodes refer to each other through 32-bit indices, and the states' subtree events are stored in a single bitset array.
+         *          Dispatching an event hence walks a few dense arrays instead of chasing state, region, map and vector pointers across the heap.
+         *          The ranks of the states and regions index their runtime state, read from the runtime passed along the dispatch
          */
-        void setupTransitionsImpl()
+        class Layout
         {
-            for (auto& transition : getTransitions())
+        public:
+            using TRepost = void(*)(Runtime& runtime, PostedTransition&& posted);
+
+            /**
+             * @brief       build
+             * @param[in]   topSm: the top-sm state to lay out, whose states are numbered and events indexed
+             */
+            void build(dsm::StateBase* topSm)
             {
-                try
-                {
-                    if (transition != nullptr) addTransition(transition);
-                }
-                catch (...)
+                m_states.clear();
+                m_transitions.clear();
+                m_events.clear();
+                m_hierarchyStates.clear();
+                m_hierarchyRegions.clear();
+                m_independent.clear();
+
+                m_revision = topSm->m_revision;
+                m_eventWords = topSm->m_subtreeEvents.m_words.size();
+
+                add(topSm);
+
+                // A region leaving itself through one of its transitions changes its orthogonal regions: it runs alone
+                for (auto region : m_hierarchyRegions)
                 {
-                    delete transition;
-                    transition = nullptr;
+                    bool independent = region->m_independent;
+                    for (const auto&[_, child] : region->m_children)
+                    {
+                        if (true == independent) independent = confined(region, child);
+                    }
 
-                    // State's error job
-                    onError(std::current_exception());
+                    m_independent.push_back(independent);
                 }
+
+                m_ready = true;
             }
 
-            for (const auto&[_, region] : m_regions)
+            std::size_t regions() const
             {
-                for (const auto&[_, child] : region->m_children)
-                {
-                    child->setupTransitionsImpl();
-                }
+                return m_hierarchyRegions.size();
             }
-        }
 
-        /**
-         * @brief       setupHistoryImpl
-         * @details     Recursively sets the user provided histories (through getHistory overrides) to the state machine
-         */
-        void setupHistoryImpl()
-        {
-            for (auto&[index, region] : m_regions)
+            /**
+             * @brief       region
+             * @param[in]   slot: the region's rank in the layout
+             * @return      Returns the region
+             */
+            dsm::StateBase::Region* region(TNodeIndex slot) const
+            {
+                return m_hierarchyRegions[slot];
+            }
+
+            /**
+             * @brief       schedule
+             * @param[in]   scheduler: the scheduler running independent regions concurrently, nullptr to run them one after another
+             * @param[in]   repost: queues, into the top-sm, the events posted by regions run concurrently
+             */
+            void schedule(IRegionScheduler* scheduler, TRepost repost)
+            {
+                m_scheduler = scheduler;
+                m_repost = repost;
+            }
+
+            /**
+             * @brief       layOut
+             * @param[out]  runtime: the runtime to size
+             * @details     Sizes the provided runtime for the layout: no active state, no last visited state
+             */
+            void layOut(Runtime& runtime) const
+            {
+                runtime.m_layout = this;
+                runtime.m_revision = m_revision;
+                runtime.m_nodes = m_hierarchyStates.data();
+                runtime.m_current.assign(m_hierarchyRegions.size(), InvalidNode);
+                runtime.m_last.assign(m_hierarchyRegions.size(), InvalidNode);
+                runtime.m_started.assign(m_hierarchyStates.size(), 0);
+                runtime.m_trigEvents.assign(m_hierarchyStates.size(), nullptr);
+                runtime.m_configuration = UnknownConfiguration;
+                runtime.m_processing = false;
+            }
+
+            /**
+             * @brief       ready
+             * @param[in]   revision: the top-sm's current revision
+             * @return      true if the layout matches the provided top-sm's revision, false otherwise
+             */
+            bool ready(std::uint64_t revision) const
+            {
+                return true == m_ready && revision == m_revision;
+            }
+
+            /**
+             * @brief       process
+             * @param[in]   runtime: the runtime to update, sized for the layout
+             * @param[in]   evt: the event to process
+             * @details     Same as StateBase::processEventImpl, over the layout
+             * @return      true if the event was handled, false otherwise
+             */
+            bool process(Runtime& runtime, const dsm::EventBase& evt) const
+            {
+                if (evt.m_id / 64 >= m_eventWords) return false;
+
+                return dispatch(runtime, 0, evt);
+            }
+
+        private:
+            using Region = dsm::StateBase::Region;
+
+            /**
+             * @brief   StateNode
+             * @details Hot fields of a state: ranges of its regions' slots and of its transitions in m_transitions
+             */
+            struct StateNode
+            {
+                TNodeIndex m_firstRegion = 0;
+                TNodeIndex m_regionCount = 0;
+                TNodeIndex m_firstTransition = 0;
+                TNodeIndex m_transitionCount = 0;
+            };
+
+            /**
+             * @brief   TransitionRecord
+             * @details Transition of a state, sorted by event identifier among the state's ones
+             */
+            struct TransitionRecord
+            {
+                TEventId m_eventId;
+                const TransitionBase* m_transition;
+            };
+
+            /**
+             * @brief       add
+             * @param[in]   state: the state to lay out along with its descendants
+             */
+            void add(dsm::StateBase* state)
             {
-                region->setHistory(getHistory(index));
+                const auto index = static_cast<TNodeIndex>(m_states.size());
+                state->m_node = index;
+                m_hierarchyStates.push_back(state);
 
-                for (const auto&[_, child] : region->m_children)
+                StateNode node;
+
+                node.m_firstTransition = static_cast<TNodeIndex>(m_transitions.size());
+                // Already sorted by event identifier
+                for (const auto& record : state->m_transitions) m_transitions.push_back({ record.m_eventId, record.m_transition });
+                node.m_transitionCount = static_cast<TNodeIndex>(m_transitions.size() - node.m_firstTransition);
+
+                node.m_firstRegion = static_cast<TNodeIndex>(m_hierarchyRegions.size());
+                node.m_regionCount = static_cast<TNodeIndex>(state->m_regions.size());
+                for (const auto&[_, region] : state->m_regions)
                 {
-                    child->setupHistoryImpl();
+                    region->m_slot = static_cast<TNodeIndex>(m_hierarchyRegions.size());
+                    m_hierarchyRegions.push_back(region);
                 }
-            }
-        }
 
-        /**
-         * @brief   getDescendantImpl
-         * @details Recursively searches downwards in descendants for the state with the specified type StateType
-         * @return  Pointer to the found state if any, nullptr otherwise
-         */
-        template <typename StateType>
-        StateType* getDescendantImpl()
-        {
-            static_assert(details::is_state_v<StateType>, "StateType must inherit from State");
+                m_states.push_back(node);
 
-            // Check self state index
-            if (true == details::CheckIndex<StateType>(m_index)) return static_cast<StateType*>(this);
+                const auto& words = state->m_subtreeEvents.m_words;
+                m_events.resize(m_events.size() + m_eventWords, 0);
+                std::copy(words.begin(), words.end(), m_events.end() - m_eventWords);
 
-            // Loop over orthogonal regions
-            for (const auto&[_, region] : m_regions)
-            {
-                auto state = region->template getDescendant<StateType>();
-                if (state != nullptr) return state;
+                for (const auto&[_, region] : state->m_regions)
+                {
+                    for (const auto&[_, child] : region->m_children)
+                    {
+                        add(child);
+                    }
+                }
             }
 
-            return nullptr;
-        }
+            /**
+             * @brief       dispatch
+             * @param[in]   runtime: the runtime to update
+             * @param[in]   index: the state's node index
+             * @param[in]   evt: the event to process
+             * @return      true if the event was handled by the state or any of its active descendants, false otherwise
+             */
+            bool dispatch(Runtime& runtime, TNodeIndex index, const dsm::EventBase& evt) const
+            {
+                if (false == handles(index, evt)) return false;
 
-        /**
-         * @brief   getAncestorImpl
-         * @details Recursively searches upwards in ancestors for the state with the specified type StateType
-         * @return  Pointer to the found state if any, nullptr otherwise
-         */
-        template <typename StateType>
-        StateType* getAncestorImpl()
-        {
-            static_assert(details::is_state_v<StateType>, "StateType must inherit from State");
+                // Copied, a transition may restart the state machine
+                const auto node = m_states[index];
 
-            // Check self state index
-            if (true == details::CheckIndex<StateType>(m_index)) return static_cast<StateType*>(this);
+                const auto first = m_transitions.begin() + node.m_firstTransition;
+                const auto last = first + node.m_transitionCount;
+                const auto it = std::lower_bound(first, last, evt.m_id, [](const TransitionRecord& record, TEventId id) { return record.m_eventId < id; });
 
-            // Recurse stop condition
-            if (nullptr == m_parentState) return nullptr;
+                // Execute the transition and break recursive chain if successful
+                if (it != last && evt.m_id == it->m_eventId && true == it->m_transition->exec(runtime, evt)) return true;
 
-            // Recurse call
-            return m_parentState->template getAncestorImpl<StateType>();
-        }
+                // Independent regions run concurrently, unless the calling thread already runs a region so
+                if (m_scheduler != nullptr && node.m_regionCount > 1 && nullptr == RegionStep::Current()) return dispatchRegions(runtime, node, evt);
 
-        /**
-         * @brief   Propagate
-         * @details Helper function that computes the history propagation flag according to previous propagation flag and provided region's history
-         * @return  true if previous propagation flag is true or if provided region has deep history, false otherwise
-         */
-        static bool Propagate(bool propagateHistory, const Region* region)
-        {
-            return true == propagateHistory || History::Deep == region->m_history;
-        }
+                bool result{ false };
 
-        /**
-         * @brief       transitImpl
-         * param[in]    evt: transition's triggering event
-         * param[in]    dstState: transition's destination state
-         * @details     Performs the transition from current to destination state:
-         *              - Exits from current state
-         *              - Updates current state
-         *              - Enters into destination state
-         * @return      true if transition succeeded, false otherwise
-         */
-        bool transitImpl(const EventBase* evt, const TransitionData& data, bool propagateHistory)
-        {
-            if (this == data.commonAncestor)
+                for (auto region = node.m_firstRegion; region < node.m_firstRegion + node.m_regionCount; ++region)
+                {
+                    const auto current = runtime.m_current[region];
+                    if (current != InvalidNode) result |= dispatch(runtime, current, evt);
+                }
+
+                return result;
+            }
+
+            /**
+             * @brief       handles
+             * @param[in]   index: the state's node index
+             * @param[in]   evt: the event to process
+             * @return      true if the state or any of its descendants handles the event, false otherwise
+             */
+            bool handles(TNodeIndex index, const dsm::EventBase& evt) const
             {
-                if (data.srcOutermost != nullptr && true == data.srcOutermost->m_started) data.srcOutermost->stopImpl(evt);
-                bool propagate = Propagate(propagateHistory, data.dstOutermost->m_parentRegion);
-                data.dst->startAncestors(evt, data, this, propagate);
-                return true;
+                return 0 != (m_events[index * m_eventWords + evt.m_id / 64] & (std::uint64_t{ 1 } << (evt.m_id % 64)));
             }
 
-            for (const auto&[_, region] : m_regions)
+            /**
+             * @brief       dispatchRegions
+             * @param[in]   runtime: the runtime to update
+             * @param[in]   node: the state's node
+             * @param[in]   evt: the event to process
+             * @details     Same as the regions' loop of dispatch, consecutive independent regions handling the event running concurrently
+             * @return      true if the event was handled by any of the regions, false otherwise
+             */
+            bool dispatchRegions(Runtime& runtime, StateNode node, const dsm::EventBase& evt) const
             {
-                if (region->m_currentState != nullptr)
+                bool result{ false };
+                auto& forked = runtime.m_forked;
+
+                const auto last = node.m_firstRegion + node.m_regionCount;
+                for (auto region = node.m_firstRegion; region < last;)
                 {
-                    if (true == region->m_currentState->transitImpl(evt, data, Propagate(propagateHistory, region)))
-                        return true;
+                    forked.clear();
+                    for (; region < last && true == m_independent[region]; ++region)
+                    {
+                        const auto current = runtime.m_current[region];
+                        if (current != InvalidNode && true == handles(current, evt)) forked.push_back(current);
+                    }
+
+                    if (forked.size() > 1) result |= fork(runtime, evt);
+                    else if (1 == forked.size()) result |= dispatch(runtime, forked.front(), evt);
+
+                    // Other regions run alone, in order
+                    if (region < last)
+                    {
+                        const auto current = runtime.m_current[region];
+                        if (current != InvalidNode) result |= dispatch(runtime, current, evt);
+                        ++region;
+                    }
                 }
+
+                return result;
             }
 
-            return false;
-        }
+            /**
+             * @brief       fork
+             * @param[in]   runtime: the runtime to update
+             * @param[in]   evt: the event to process
+             * @details     Dispatches the event to the runtime's forked states through the scheduler, then applies their side effects in order.
+             *              The first exception thrown, in order, is rethrown once all of them are applied
+             * @return      true if the event was handled by any of the states, false otherwise
+             */
+            bool fork(Runtime& runtime, const dsm::EventBase& evt) const
+            {
+                auto& forked = runtime.m_forked;
+                auto& steps = runtime.m_steps;
 
-        /**
-         * @brief           startAncestors
-         * param[in]        evt: transition's triggering event
-         * param[in]        data: transition's data
-         * param[in]        previousState: previous calling state
-         * param[in,out]    propagateHistory: history propagation flag
-         * @details         Starts the destination state and all its ancestors up to the outermost destination.
-         *                  The starting order is descending from outermost to innermost and takes into account the history propagation flag
-         */
-        void startAncestors(const EventBase* evt, const TransitionData& data, StateBase* previousState, bool& propagateHistory)
-        {
-            // If we've reached the common ancestor, just leave out
-            if (this == data.commonAncestor) return;
+                if (steps.size() < forked.size()) steps.resize(forked.size());
+                for (std::size_t index = 0; index < forked.size(); ++index) steps[index].m_owner = &runtime;
+                runtime.m_forkedEvent = &evt;
 
-            // Move upwards until outermost destination is reached
-            // Don't mutate the history propagation since this is the one from common ancestor
-            this->m_parentState->startAncestors(evt, data, this, propagateHistory);
+                // Invalidated ahead of the regions rather than by each of their transitions
+                runtime.m_configuration = UnknownConfiguration;
 
-            bool propagate = Propagate(propagateHistory, m_parentRegion);
+                m_scheduler->run(forked.size(), &RunRegion, &runtime);
 
-            // We've reached the outermost destination. If it's also the destination, then start it
-            if (this == data.dst)
-            {
-                this->m_parentRegion->start(evt, propagate, this);
-                return;
-            }
+                bool result{ false };
+                std::exception_ptr error = nullptr;
 
-            this->m_parentRegion->m_currentState = this;
+                for (std::size_t index = 0; index < forked.size(); ++index)
+                {
+                    auto& step = steps[index];
 
-            this->startImpl(evt, false, false);
+                    for (const auto& change : step.m_changes)
+                    {
+                        if (true == change.m_entered) runtime.m_epochs.onEntry(*change.m_handled, *change.m_deferred);
+                        else runtime.m_epochs.onExit(*change.m_handled, *change.m_deferred);
+                    }
 
-            for (const auto&[_, region] : this->m_regions)
-            {
-                if (region != previousState->m_parentRegion) region->start(evt, propagate);
-            }
+                    for (auto& posted : step.m_posted) m_repost(runtime, std::move(posted));
 
-            propagateHistory = propagate;
-        }
+                    if (nullptr == error) error = step.m_error;
+                    result |= step.m_handled;
 
-        /**
-         * @brief       getTransitionData
-         * param[in]    dst: the destination state
-         * @details     Calculates the transition data for transitions performed from the top state machine.
-         *              In this case, the common ancestor is the first started state containing the destination,
-         *              the source outermost is the current state of the common ancestor,
-         *              and the destination outermost is the common ancestor's child
-         * @return      A non null transition data structure if it could be computed, nullopt otherwise
-         */
-        std::optional<TransitionData> getTransitionData(StateBase* dst)
-        {
-            if (nullptr == this->m_parentState) return std::nullopt;
-            if (false == this->m_parentState->m_started) return this->m_parentState->getTransitionData(dst);
-            auto srcOutermost = this->m_parentRegion->m_currentState;
-            return TransitionData{ this->m_parentState, srcOutermost, this, srcOutermost, dst };
-        }
+                    step.m_changes.clear();
+                    step.m_posted.clear();
+                    step.m_error = nullptr;
+                }
 
-        /**
-         * @brief       getTransitionData
-         * param[in]    src: the source state
-         * param[in]    dst: the destination state
-         * @details     In this case, the common ancestor is the first state containing both source and destination states
-         * @return      A non null transition data structure if it could be computed, nullopt otherwise
-         */
-        std::optional<TransitionData> getTransitionData(StateBase* src, StateBase* dst)
-        {
-            if (nullptr == this->m_parentState) return std::nullopt;
-            auto srcOutermost = this->m_parentRegion->getOutermost(src, this);
-            if (nullptr == srcOutermost) return this->m_parentState->getTransitionData(src, dst);
-            return TransitionData{ this->m_parentState, srcOutermost, this, src, dst };
-        }
+                if (error != nullptr) std::rethrow_exception(error);
 
-        /**
-         * @brief       processEventImpl
-         * param[in]    evt: Event to process
-         * @details     Processes the provided event:
-         *              - Searches for a transition with index corresponding with the provided Event's type index
-         *              - If such transition found, execute its callback using the provided event as parameter
-         *              - If no transition found, recursively search inside sub-states
-         */
-        bool processEventImpl(const EventBase& evt, bool propagateHistory) const
-        {
-            // Loop over transitions
-            auto it = m_transitions.find(evt.m_index);
-            if (it != m_transitions.end())
-            {
-                // Invoke the corresponding callback and break recursive chain if successful
-                if (true == evt.apply(it->second)) return true;
+                return result;
             }
 
-            bool result{ false };
+            static void RunRegion(void* context, std::size_t index)
+            {
+                auto& runtime = *static_cast<Runtime*>(context);
+                auto& step = runtime.m_steps[index];
 
-            // Recursive calls over sub-states if no transition found yet
-            for (const auto&[_, region] : m_regions)
+                auto& current = RegionStep::Current();
+                const auto previous = std::exchange(current, &step);
+
+                // States called back on the worker reach the runtime it runs
+                Runtime::Scope scope{ runtime };
+
+                try
+                {
+                    step.m_handled = runtime.m_layout->dispatch(runtime, runtime.m_forked[index], *runtime.m_forkedEvent);
+                }
+                catch (...)
+                {
+                    step.m_handled = false;
+                    step.m_error = std::current_exception();
+                }
+
+                current = previous;
+            }
+
+            /**
+             * @brief       confined
+             * @param[in]   region: the region
+             * @param[in]   state: a state of the region
+             * @return      true if none of the transitions of the state and its descendants leads out of the region, false otherwise
+             */
+            static bool confined(const Region* region, const dsm::StateBase* state)
             {
-                if (region->m_currentState != nullptr)
+                for (const auto& record : state->m_transitions)
+                {
+                    const auto dst = record.m_transition->m_dstState;
+                    if (dst != nullptr && false == region->contains(dst))
+                    {
+                        LOG_ERROR_DSM("Region " << region->m_index << " of state '" << region->m_parentState->name() << "' does not run concurrently. "
+                            "Transition from state '" << state->name() << "' to state '" << dst->name() << "' leaves it");
+                        return false;
+                    }
+                }
+
+                for (const auto&[_, subRegion] : state->m_regions)
                 {
-                    result |= region->m_currentState->processEventImpl(evt, Propagate(propagateHistory, region));
+                    for (const auto&[_, child] : subRegion->m_children)
+                    {
+                        if (false == confined(region, child)) return false;
+                    }
                 }
+
+                return true;
             }
 
-            return result;
-        }
+            bool m_ready = false;
+            std::uint64_t m_revision = 0;
 
-        /**
-         * @brief   checkStatesImpl
-         * @details Terminating recursive variadic call
-         */
-        template <typename ...StateTypes, typename = details::is_empty_pack<StateTypes...>>
-        bool checkStatesImpl(StateBase* previousState = nullptr)
-        {
-            return m_started;
-        }
+            /**
+             * @brief   m_eventWords
+             * @details Number of 64-bit words of each state's subtree events bitset
+             */
+            std::size_t m_eventWords = 0;
 
-        /**
-         * @brief   checkStatesImpl
-         * @details Checks wether the provided state in template parameters are active (started)
-         *          Order in which states are provided matters, and there cannot be "holes"
-         */
-        template <typename FirstStateType, typename ...OtherStateTypes>
-        bool checkStatesImpl(StateBase* previousState = nullptr)
-        {
-            static_assert(details::is_state_v<FirstStateType>, "FirstStateType must inherit from State");
+            /**
+             * @brief   m_states
+             * @details The states' nodes, in pre-order
+             */
+            std::vector<StateNode> m_states = {};
+            std::vector<TransitionRecord> m_transitions = {};
 
-            auto state = this->template getDescendantImpl<FirstStateType>();
-            if (nullptr == state) return false;
-            if (state == previousState) return false;
-            if (!state->m_started) return false;
-            if (previousState != nullptr && state->m_parentState != previousState) return false;
-            if constexpr (0 == sizeof ...(OtherStateTypes)) return true;
-            else return state->template checkStatesImpl<OtherStateTypes...>(state);
-        }
-    };
+            /**
+             * @brief   m_events
+             * @details The states' subtree events bitsets, m_eventWords per state
+             */
+            std::vector<std::uint64_t> m_events = {};
+
+            /**
+             * @brief   m_hierarchyStates
+             * @details The hierarchy's states, in layout order
+             */
+            std::vector<dsm::StateBase*> m_hierarchyStates = {};
+
+            /**
+             * @brief   m_hierarchyRegions
+             * @details The hierarchy's regions, in layout order, i.e. indexed by slot
+             */
+            std::vector<Region*> m_hierarchyRegions = {};
+
+            /**
+             * @brief   m_independent
+             * @details Whether the region may run concurrently with its orthogonal regions, indexed by slot
+             */
+            std::vector<bool> m_independent = {};
+
+            IRegionScheduler* m_scheduler = nullptr;
+            TRepost m_repost = nullptr;
+        };
+    }
 
     /**
      * @brief   State
@@ -1599,7 +4257,7 @@ namespace dsm
 
     protected:
         State()
-            : StateBase{ details::Index<DerivedType>() }
+            : StateBase{ details::Index<DerivedType>(), details::StateId<DerivedType>() }
         {
             static_assert(std::is_default_constructible_v<DerivedType>, "DerivedType must be default constructible");
             static_assert(std::is_base_of_v<State<DerivedType, SmType>, DerivedType>, "DerivedType must inherit from State");
@@ -1621,13 +4279,6 @@ namespace dsm
             else return false;
         }
 
-        bool isProcessing() const
-        {
-            if (nullptr == m_topSm) return false;
-
-            return topSm()->m_processing;
-        }
-
         /**
          * @brief   topSm
          * @details Provides a pointer to the top-sm
@@ -1678,9 +4329,9 @@ namespace dsm
 
         /**
          * @brief       createTransitionImpl
-         * param[in]    guard: function object that may be used to discard the execution of the transition
-         * param[in]    action: function object that is called prior to the transition
-         * @details     Creates a function object that wraps the guard, the action and the transition
+         * param[in]    guard: member function that may be used to discard the execution of the transition
+         * param[in]    action: member function that is called prior to the transition
+         * @details     Creates a transition holding the guard, the action and the precomputed transition data
          * @return      Pointer to the created transition
          */
         template <typename SrcState, typename EventType, typename StateType, TAction<StateType, EventType> action, TGuard<StateType, EventType> guard, typename DstState>
@@ -1717,60 +4368,20 @@ namespace dsm
                 throw details::SmError() << ErrorMessage<SrcState, EventType, DstState>() << "Action state '" << details::Name<StateType>() << "' is not an ancestor of source state '" << details::Name<SrcState>() << "' nor source state itself";
             }
 
-            details::Transition<EventType>* transition{ nullptr };
-
             if constexpr (false == details::is_same_state_v<SrcState, DstState>)
             {
                 auto transitionData = dstState->getTransitionData(srcState, dstState);
                 if (std::nullopt == transitionData)
-                {
-                    throw details::SmError() << ErrorMessage<SrcState, EventType, DstState>() << "Transition impossible. Either crossing regions or source and destination are nested";
-                }
-
-                auto cb = [topSm = m_topSm, data = transitionData.value(), actionState, actionMember = action, guardMember = guard](const EventType& evt)
-                {
-                    try
-                    {
-                        if (guardMember != nullptr && false == std::invoke(guardMember, actionState, evt)) return false;
-                        if (actionMember != nullptr) std::invoke(actionMember, actionState, evt);
-
-                        return topSm->transitImpl(&evt, data, false);
-                    }
-                    catch (...)
-                    {
-                        // Transitions's error job
-                        data.src->onError(std::current_exception());
-                        return false;
-                    }
-                };
-
-                transition = new details::Transition<EventType>{ cb };
-            }
-            else
-            {
-                auto cb = [srcState, actionState, actionMember = action, guardMember = guard](const EventType& evt)
-                {
-                    try
-                    {
-                        if (guardMember != nullptr && false == std::invoke(guardMember, actionState, evt)) return false;
-                        if (actionMember != nullptr) std::invoke(actionMember, actionState, evt);
-
-                        return true;
-                    }
-                    catch (...)
-                    {
-                        // Transitions's error job
-                        srcState->onError(std::current_exception());
-                        return false;
-                    }
-                };
+                {
+                    throw details::SmError() << ErrorMessage<SrcState, EventType, DstState>() << "Transition impossible. Either crossing regions or source and destination are nested";
+                }
 
-                transition = new details::Transition<EventType>{ cb };
+                return new MemberTransition<EventType, StateType, action, guard, true>{ srcState, actionState, transitionData.value(), GetTransitionPath(transitionData.value()) };
+            }
+            else
+            {
+                return new MemberTransition<EventType, StateType, action, guard, false>{ srcState, actionState, {}, {} };
             }
-
-            transition->m_srcState = srcState;
-
-            return transition;
         }
 
         /**
@@ -1786,18 +4397,6 @@ namespace dsm
             return sstr.str();
         }
 
-        void preProcess() const
-        {
-            if (nullptr == m_topSm) return;
-            topSm()->m_processing = true;
-        }
-
-        void postProcess() const
-        {
-            if (nullptr == m_topSm) return;
-            topSm()->m_processing = false;
-        }
-
     public:
         /**
          * @brief   trigEvent
@@ -1809,11 +4408,12 @@ namespace dsm
         {
             static_assert(details::is_event_v<EventType>, "EventType must inherit from Event");
 
-            // Check triggering event pointer validity and type index match the provided EventType
-            if (m_trigEvent != nullptr && true == details::CheckIndex<EventType>(m_trigEvent->m_index))
+            // Check triggering event pointer validity and identifier match the provided EventType
+            auto evt = this->trigEventImpl();
+            if (evt != nullptr && evt->m_id == details::EventId<EventType>())
             {
                 // Return the upcasted event
-                return static_cast<const EventType*>(m_trigEvent);
+                return static_cast<const EventType*>(evt);
             }
 
             return nullptr;
@@ -1826,12 +4426,15 @@ namespace dsm
         template <typename StateType>
         void clearHistory(bool recursive = false)
         {
+            auto runtime = this->runtime();
+            if (nullptr == runtime) return;
+
             auto state = this->template getDescendantImpl<StateType>();
             if (state != nullptr)
             {
                 for (auto&[_, region] : state->m_regions)
                 {
-                    region->clearHistory(recursive);
+                    region->clearHistory(*runtime, recursive);
                 }
             }
         }
@@ -1843,6 +4446,9 @@ namespace dsm
         template <typename StateType, int RegionIndex>
         void clearHistory(bool recursive = false)
         {
+            auto runtime = this->runtime();
+            if (nullptr == runtime) return;
+
             auto state = this->template getDescendantImpl<StateType>();
             if (state != nullptr)
             {
@@ -1850,7 +4456,7 @@ namespace dsm
                 if (itRegion != state->m_regions.end())
                 {
                     // Clear the last visited state
-                    itRegion->second->clearHistory(recursive);
+                    itRegion->second->clearHistory(*runtime, recursive);
                 }
                 else
                 {
@@ -1878,10 +4484,11 @@ namespace dsm
         bool checkStates()
         {
             if (nullptr == m_topSm) return false;
+            const auto& runtime = *this->runtime();
             if constexpr (details::is_same_state_v<FirstStateType, SmType>)
-                return m_topSm->template checkStatesImpl<OtherStateTypes...>(this->m_topSm);
+                return m_topSm->template checkStatesImpl<OtherStateTypes...>(runtime, this->m_topSm);
             else
-                return m_topSm->template checkStatesImpl<FirstStateType, OtherStateTypes...>();
+                return m_topSm->template checkStatesImpl<FirstStateType, OtherStateTypes...>(runtime);
         }
 
         /**
@@ -1902,7 +4509,7 @@ namespace dsm
          */
         auto store()
         {
-            return topSm() != nullptr ? topSm()->m_store : nullptr;
+            return topSm() != nullptr ? topSm()->runtime().m_store.get() : nullptr;
         }
 
         /**
@@ -1912,7 +4519,7 @@ namespace dsm
          */
         const auto store() const
         {
-            return topSm() != nullptr ? topSm()->m_store : nullptr;
+            return topSm() != nullptr ? topSm()->runtime().m_store.get() : nullptr;
         }
 
         /**
@@ -1987,6 +4594,21 @@ namespace dsm
             return nullptr;
         }
 
+        /**
+         * @brief       createDeferredEvent
+         * @details     Declares EventType as deferred while the state is active, to be returned by getDeferredEvents overrides.
+         *              Such events are queued when no active state handles them, then released once no active state defers them anymore
+         *              or a state handling them is entered
+         * @return      The identifier of the deferred event
+         */
+        template <typename EventType>
+        static TEventId createDeferredEvent()
+        {
+            static_assert(details::is_event_v<EventType>, "EventType must inherit from Event");
+
+            return details::EventId<EventType>();
+        }
+
         /**
          * @brief       createTransition
          * param[in]    guard: function object that may be used to discard the execution of the transition
@@ -2124,31 +4746,27 @@ namespace dsm
             static_assert(details::is_state_v<DstState>, "DstState must inherit from State");
 
             if (nullptr == m_topSm) return;
-            if (false == topSm()->started()) return;
+            auto& runtime = topSm()->runtime();
+            if (false == runtime.started(m_topSm->m_node)) return;
 
             // Retrieve and check the destination state
             auto dstState = topSm()->template getDescendantImpl<DstState>();
             if (nullptr == dstState) return;
-            if (true == dstState->m_started) return;
+            if (true == runtime.started(dstState->m_node)) return;
 
             // Retrieve and check the transition data
-            auto transitionData = (this == m_topSm) ? dstState->getTransitionData(dstState) : dstState->getTransitionData(this, dstState);
+            auto transitionData = (this == m_topSm) ? dstState->getTransitionData(runtime, dstState) : dstState->getTransitionData(this, dstState);
             if (std::nullopt == transitionData) return;
 
-            auto cb = [topSm = m_topSm, data = transitionData.value()]() -> bool
-            {
-                return topSm->transitImpl(nullptr, data, false);
-            };
-
-            if (false == isProcessing())
+            if (false == runtime.m_processing)
             {
-                preProcess();
-                cb();
-                postProcess();
+                runtime.m_processing = true;
+                transitionData->commonAncestor->transitImpl(runtime, nullptr, transitionData.value());
+                runtime.m_processing = false;
             }
             else
             {
-                topSm()->m_postedTransitions.emplace(new details::Transition<void>(cb));
+                topSm()->enqueue(runtime, m_topSm, transitionData.value());
             }
         }
 
@@ -2162,143 +4780,566 @@ namespace dsm
             static_assert(details::is_state_v<DstState>, "DstState must inherit from State");
 
             if (nullptr == m_topSm) return;
-            if (false == topSm()->started()) return;
+            auto& runtime = topSm()->runtime();
+            if (false == runtime.started(m_topSm->m_node)) return;
 
             // Retrieve and check the destination state
             auto dstState = topSm()->template getDescendantImpl<DstState>();
             if (nullptr == dstState) return;
-            if (true == dstState->m_started) return;
+            if (true == runtime.started(dstState->m_node)) return;
 
             // Retrieve and check the transition data
-            auto transitionData = (this == m_topSm) ? dstState->getTransitionData(dstState) : dstState->getTransitionData(this, dstState);
+            auto transitionData = (this == m_topSm) ? dstState->getTransitionData(runtime, dstState) : dstState->getTransitionData(this, dstState);
             if (std::nullopt == transitionData) return;
 
-            auto cb = [evt = evt.clone(), topSm = m_topSm, data = transitionData.value()]() -> bool
-            {
-                return topSm->transitImpl(evt, data, false);
-            };
+            if (false == runtime.m_processing)
+            {
+                runtime.m_processing = true;
+                transitionData->commonAncestor->transitImpl(runtime, &evt, transitionData.value());
+                runtime.m_processing = false;
+            }
+            else
+            {
+                topSm()->enqueue(runtime, m_topSm, transitionData.value(), &evt);
+            }
+        }
+
+        /**
+         * @brief       deferEvent
+         * param[in]    evt: Event to defer
+         * @details     Defers the provided event. The event shall be processed as soon as the state machine enters back into the state that handles this kind of event
+         */
+        template <typename EventType>
+        void deferEvent(const EventType& evt) const
+        {
+            static_assert(details::is_event_v<EventType>, "EventType must inherit from Event");
+
+            if (nullptr == m_topSm) return;
+            auto& runtime = topSm()->runtime();
+            if (false == runtime.started(m_topSm->m_node)) return;
+
+            traceImpl(Log::TracePoint::Defer, &evt);
+
+            if (false == runtime.m_processing)
+            {
+                runtime.m_processing = true;
+                if (false == topSm()->dispatch(runtime, evt, true)) topSm()->enqueue(runtime, evt, true);
+                runtime.m_processing = false;
+            }
+            else
+            {
+                topSm()->enqueue(runtime, evt, true);
+            }
+        }
+
+        /**
+         * @brief       postEvent
+         * param[in]    evt: Event to defer
+         * @details     Posts the provided event. This might be called from within a state during the processing of another event
+         *              The posted event will be processed as soon as the ongoing event processing will be completed
+         */
+        template <typename EventType>
+        void postEvent(const EventType& evt) const
+        {
+            static_assert(details::is_event_v<EventType>, "EventType must inherit from Event");
+
+            if (nullptr == m_topSm) return;
+            auto& runtime = topSm()->runtime();
+            if (false == runtime.started(m_topSm->m_node)) return;
+
+            traceImpl(Log::TracePoint::Post, &evt);
+
+            // If post from top-sm, it is equivalent to processEvent
+            if (false == runtime.m_processing)
+            {
+                runtime.m_processing = true;
+                topSm()->dispatch(runtime, evt);
+                runtime.m_processing = false;
+            }
+            else
+            {
+                topSm()->enqueue(runtime, evt);
+            }
+        }
+    };
+
+    /**
+     * @brief   EmptyStore
+     * @details Default empty store
+     */
+    struct EmptyStore {};
+
+    /**
+     * @brief   QueueMetrics
+     * @details Depths of the state machine's run-to-completion queues
+     */
+    struct QueueMetrics
+    {
+        /**
+         * @brief   posted
+         * @details Current number of posted events, deferred events not yet tried, and transitions requested from within states
+         */
+        std::size_t posted = 0;
+
+        /**
+         * @brief   deferred
+         * @details Current number of deferred events waiting for a state handling them
+         */
+        std::size_t deferred = 0;
+
+        /**
+         * @brief   maxPosted
+         * @details High-water mark of posted
+         */
+        std::size_t maxPosted = 0;
+
+        /**
+         * @brief   maxDeferred
+         * @details High-water mark of deferred
+         */
+        std::size_t maxDeferred = 0;
+
+        /**
+         * @brief   totalPosted
+         * @details Number of elements queued into posted
+         */
+        std::uint64_t totalPosted = 0;
+
+        /**
+         * @brief   totalDeferred
+         * @details Number of events queued into deferred
+         */
+        std::uint64_t totalDeferred = 0;
+    };
+
+    /**
+     * @brief   StateMachine
+     * @details CRTP base class for State Machines
+     *          - Holds the state machine's local storage that is shared among all sub-states to access common data
+     *          - Holds the run-to-completion queues of posted events, deferred events and transitions requested from within states
+     */
+    template <typename SmType, typename StoreType = EmptyStore>
+    class StateMachine : public State<SmType, SmType>
+    {
+    private:
+        static_assert(std::is_default_constructible_v<StoreType>, "StoreType must be default constructible");
+
+        template <typename DerivedType, typename OtherSmType>
+        friend class State;
+
+    public:
+        class Instance;
+
+    private:
+
+        /**
+         * @brief   Runtime
+         * @details Runtime state of the state machine or of one of its instances: the hierarchy's one, the run-to-completion queues and the store
+         */
+        struct Runtime : details::Runtime
+        {
+            /**
+             * @brief   m_postedTransitions
+             * @details Posted events, deferred events on their first try and transitions requested from within states, in posting order
+             */
+            details::RingQueue<details::PostedTransition> m_postedTransitions;
+
+            /**
+             * @brief   m_deferredTransitions
+             * @details Deferred events that no active state handled yet, indexed by event identifier, each in deferring order
+             */
+            std::vector<std::unique_ptr<details::NodeList<details::DeferredTransition>>> m_deferredTransitions;
+
+            /**
+             * @brief   m_deferredOrder
+             * @details Deferring order of the next deferred event
+             */
+            std::uint64_t m_deferredOrder = 0;
+
+            /**
+             * @brief   m_retried
+             * @details Scratch storage of the deferred events being retried, one cursor per event identifier
+             */
+            std::vector<details::NodeList<details::DeferredTransition>::Node*> m_retried;
+
+            /**
+             * @brief   m_queueMetrics
+             * @details Queues high-water marks and counters
+             */
+            QueueMetrics m_queueMetrics;
+
+            /**
+             * @brief   m_store
+             * @details State machine's local storage that is shared among all sub-states to access common data
+             */
+            std::unique_ptr<StoreType> m_store = std::make_unique<StoreType>();
+
+            /**
+             * @brief   m_running
+             * @details Number of instance operations in progress on the runtime, nested ones included
+             */
+            std::size_t m_running = 0;
+        };
+
+        /**
+         * @brief   m_ownRuntime
+         * @details The runtime of the state machine itself, run when the calling thread does not run one of its instances
+         */
+        mutable Runtime m_ownRuntime;
+
+        /**
+         * @brief   m_states
+         * @details All states, including this one, indexed by their type identifier
+         */
+        std::vector<StateBase*> m_states;
+
+        /**
+         * @brief   m_flat
+         * @details Flat form of the state machine, built by compile
+         */
+        details::FlatMachine m_flat;
+
+        /**
+         * @brief   m_maxConfigurations
+         * @details Maximum number of reachable configurations requested by compile, 0 if not compiled
+         */
+        std::size_t m_maxConfigurations = 0;
+
+        /**
+         * @brief   m_layout
+         * @details Contiguous form of the topology, built by prepare
+         */
+        details::Layout m_layout;
+
+        /**
+         * @brief   m_prepared
+         * @details The revision the layout, the flat table and the own runtime were last prepared for
+         */
+        std::atomic<std::uint64_t> m_prepared{ std::numeric_limits<std::uint64_t>::max() };
+
+        /**
+         * @brief   m_preparing
+         * @details Serializes the instances preparing the topology from different threads
+         */
+        std::mutex m_preparing;
+
+        /**
+         * @brief       Derived
+         * @details     Returns the state machine's derived pointer type
+         */
+        SmType& derived()
+        {
+            return static_cast<SmType&>(*this);
+        }
+
+        /**
+         * @brief       Derived
+         * @details     Returns the state machine's derived pointer type
+         */
+        const SmType& derived() const
+        {
+            return static_cast<const SmType&>(*this);
+        }
+
+        /**
+         * @brief   runtime
+         * @return  Returns the runtime run by the calling thread if it runs one of the state machine's instances, its own runtime otherwise
+         */
+        Runtime& runtime() const
+        {
+            return static_cast<Runtime&>(*StateBase::runtime());
+        }
+
+        /**
+         * @brief       enqueue
+         * @param[in]   runtime: the runtime to update
+         * @param[in]   args: the PostedTransition's constructor arguments
+         * @details     Queues a posted event, a deferred event or a requested transition
+         */
+        template <typename ...Args>
+        static void enqueue(Runtime& runtime, Args&&... args)
+        {
+            // Queued once the orthogonal regions run concurrently completed, in region order
+            auto step = details::RegionStep::Current();
+            if (step != nullptr && step->m_owner == &runtime)
+            {
+                step->m_posted.emplace_back(std::forward<Args>(args)...);
+                return;
+            }
+
+            runtime.m_postedTransitions.emplace(std::forward<Args>(args)...);
+
+            ++runtime.m_queueMetrics.totalPosted;
+            runtime.m_queueMetrics.maxPosted = std::max(runtime.m_queueMetrics.maxPosted, runtime.m_postedTransitions.size());
+        }
+
+        static void Repost(details::Runtime& runtime, details::PostedTransition&& posted)
+        {
+            enqueue(static_cast<Runtime&>(runtime), std::move(posted));
+        }
+
+        /**
+         * @brief       dispatch
+         * @param[in]   runtime: the runtime to update
+         * @param[in]   evt: the event to process
+         * @param[in]   deferred: whether the event shall be kept until handled, or dropped if not handled once released
+         * @details     Queues the event if an active state declares it as deferred while no active state has a transition on it.
+         *              Otherwise processes the event, then queues it if not handled while declared as deferred: deferral only applies
+         *              to events no enabled transition consumes, within nested states as across regions
+         * @return      true if the event was handled or queued, false otherwise
+         */
+        bool dispatch(Runtime& runtime, const EventBase& evt, bool deferred = false) const
+        {
+            const bool deferrable = runtime.m_epochs.isDeferred(evt.m_id);
+
+            // Only an active state's transition, guarded or not, may take precedence over the deferral
+            if (false == deferrable || true == runtime.m_epochs.isHandled(evt.m_id))
+            {
+                if (true == handleEvent(runtime, evt)) return true;
+                if (false == deferrable) return false;
+            }
+
+            defer(runtime, details::PostedTransition{ evt, deferred });
+            return true;
+        }
+
+        /**
+         * @brief       handleEvent
+         * @param[in]   runtime: the runtime to update
+         * @param[in]   evt: the event to process
+         * @details     Processes the event through the flat table if compiled and the active configuration is known,
+         *              through the contiguous layout if it matches the topology, through the hierarchy otherwise
+         * @return      true if the event was handled, false otherwise
+         */
+        bool handleEvent(Runtime& runtime, const EventBase& evt) const
+        {
+            bool handled = false;
+            if (true == m_flat.process(runtime, evt, handled)) return handled;
+
+            if (true == m_layout.ready(this->m_revision)) return m_layout.process(runtime, evt);
+
+            return this->processEventImpl(runtime, evt, false);
+        }
+
+        /**
+         * @brief       defer
+         * @param[in]   runtime: the runtime to update
+         * @param[in]   deferred: the deferred event no active state handled
+         * @details     Keeps the deferred event until a state handles it
+         */
+        static void defer(Runtime& runtime, details::PostedTransition&& deferred)
+        {
+            auto& lists = runtime.m_deferredTransitions;
+            const auto id = deferred.m_evt.get()->m_id;
+            if (id >= lists.size()) lists.resize(id + 1);
+            if (nullptr == lists[id]) lists[id] = std::make_unique<details::NodeList<details::DeferredTransition>>();
+
+            lists[id]->push_back(details::DeferredTransition{ std::move(deferred), runtime.m_deferredOrder++, runtime.m_epochs.m_epoch });
+            runtime.m_epochs.add(id);
+
+            ++runtime.m_queueMetrics.totalDeferred;
+            runtime.m_queueMetrics.maxDeferred = std::max(runtime.m_queueMetrics.maxDeferred, runtime.m_epochs.m_deferred);
+        }
+
+        /**
+         * @brief       retryDeferred
+         * @param[in]   runtime: the runtime to update
+         * @details     Retries, in deferring order, the deferred events released since their last try, and drops the handled ones.
+         *              Unhandled ones are kept while deferred by an active state. Other deferred events are skipped without being processed
+         */
+        void retryDeferred(Runtime& runtime) const
+        {
+            auto& epochs = runtime.m_epochs;
+            if (true == epochs.m_pending.empty()) return;
+
+            epochs.m_retried = epochs.m_epoch;
+
+            auto& retried = runtime.m_retried;
+            retried.clear();
+            for (auto id : epochs.m_pending)
+            {
+                auto node = runtime.m_deferredTransitions[id]->front();
+                if (node != nullptr) retried.push_back(node);
+            }
+            epochs.m_pending.clear();
+
+            // Merge the lists of the pending identifiers
+            while (false == retried.empty())
+            {
+                auto cursor = std::min_element(retried.begin(), retried.end(),
+                    [](const auto* lhs, const auto* rhs) { return lhs->m_value.m_order < rhs->m_value.m_order; });
+
+                auto node = *cursor;
+                auto& deferred = node->m_value;
+                const auto& evt = *deferred.m_transition.m_evt.get();
+                const auto id = evt.m_id;
+
+                auto next = node->m_next;
+                if (deferred.m_tried < epochs.m_released[id])
+                {
+                    deferred.m_tried = epochs.m_epoch;
+
+                    // Events deferred through deferEvent are kept until handled, others are dropped once no active state defers them
+                    if (true == handleEvent(runtime, evt) || (false == deferred.m_transition.m_deferred && false == epochs.isDeferred(id)))
+                    {
+                        next = runtime.m_deferredTransitions[id]->erase(node);
+                        epochs.remove(id);
+                    }
+                }
+
+                if (next != nullptr)
+                {
+                    *cursor = next;
+                }
+                else
+                {
+                    *cursor = retried.back();
+                    retried.pop_back();
+                }
+            }
+        }
+
+        static QueueMetrics MetricsOf(const Runtime& runtime)
+        {
+            QueueMetrics metrics = runtime.m_queueMetrics;
+            metrics.posted = runtime.m_postedTransitions.size();
+            metrics.deferred = runtime.m_epochs.m_deferred;
+            return metrics;
+        }
+
+        static void ResetMetricsOf(Runtime& runtime)
+        {
+            runtime.m_queueMetrics = QueueMetrics{};
+            runtime.m_queueMetrics.maxPosted = runtime.m_postedTransitions.size();
+            runtime.m_queueMetrics.maxDeferred = runtime.m_epochs.m_deferred;
+        }
 
-            if (false == isProcessing())
-            {
-                preProcess();
-                cb();
-                postProcess();
-            }
-            else
+        static void clearDeferred(Runtime& runtime)
+        {
+            for (auto& deferred : runtime.m_deferredTransitions)
             {
-                topSm()->m_postedTransitions.emplace(new details::Transition<void>(cb));
+                if (deferred != nullptr) deferred->clear();
             }
+
+            runtime.m_epochs.clear();
         }
 
         /**
-         * @brief       deferEvent
-         * param[in]    evt: Event to defer
-         * @details     Defers the provided event. The event shall be processed as soon as the state machine enters back into the state that handles this kind of event
+         * @brief       runToCompletion
+         * @param[in]   runtime: the runtime to update
+         * @param[in]   evt: the event to process
+         * @details     Processes the event, then the deferred events worth a retry and the posted elements, until none is left
          */
-        template <typename EventType>
-        void deferEvent(const EventType& evt) const
+        void runToCompletion(Runtime& runtime, const EventBase& evt) const
         {
-            static_assert(details::is_event_v<EventType>, "EventType must inherit from Event");
+            this->traceImpl(Log::TracePoint::Dispatch, &evt);
 
-            if (nullptr == m_topSm) return;
-            if (false == topSm()->started()) return;
+            // Forward to implementation
+            dispatch(runtime, evt);
 
-            if (false == isProcessing())
-            {
-                preProcess();
-                if (false == processEventImpl(evt, false)) topSm()->m_postedTransitions.emplace(evt.clone(), true);
-                postProcess();
-            }
-            else
+            auto& posted = runtime.m_postedTransitions;
+            do
             {
-                topSm()->m_postedTransitions.emplace(evt.clone(), true);
+                // Retry deferred events the configuration changes made worth it
+                retryDeferred(runtime);
+
+                // Then process the elements posted so far. Elements posted meanwhile are processed on the next round
+                for (auto count = posted.size(); count > 0; --count)
+                {
+                    auto next = posted.pop();
+                    if (false == next.isTransition()) // Posted or deferred events
+                    {
+                        // Events posted through deferEvent are kept until handled, others only while an active state defers them
+                        const auto id = next.m_evt.get()->m_id;
+                        const bool deferrable = next.m_deferred || runtime.m_epochs.isDeferred(id);
+                        if (true == deferrable && false == runtime.m_epochs.isHandled(id)) defer(runtime, std::move(next));
+                        else if (false == handleEvent(runtime, *next.m_evt.get()) && true == deferrable) defer(runtime, std::move(next));
+                    }
+                    else // User transition
+                    {
+                        next.exec(runtime);
+                    }
+                }
             }
+            // Repeat until no more posted transition, nor deferred event released by the last round
+            while (false == posted.empty() || false == runtime.m_epochs.m_pending.empty());
         }
 
         /**
-         * @brief       postEvent
-         * param[in]    evt: Event to defer
-         * @details     Posts the provided event. This might be called from within a state during the processing of another event
-         *              The posted event will be processed as soon as the ongoing event processing will be completed
+         * @brief   prepare
+         * @details Completes the topology before running it, if it changed since: states numbering, events indexing, layout and flat table.
+         *          The own runtime is laid out again, keeping the last visited states of the regions still in the topology.
+         *          From now on the topology is only read, by the state machine and its instances alike, until it changes again
          */
-        template <typename EventType>
-        void postEvent(const EventType& evt) const
+        void prepare()
         {
-            static_assert(details::is_event_v<EventType>, "EventType must inherit from Event");
+            if (m_prepared.load(std::memory_order_acquire) == this->m_revision) return;
 
-            if (nullptr == m_topSm) return;
-            if (false == topSm()->started()) return;
+            std::lock_guard<std::mutex> lock{ m_preparing };
+            if (m_prepared.load(std::memory_order_relaxed) == this->m_revision) return;
 
-            // If post from top-sm, it is equivalent to processEvent
-            if (false == isProcessing())
+            // Last visited states of the own runtime, the states and regions of the former layout being still alive
+            std::vector<std::pair<StateBase::Region*, StateBase*>> history;
+            for (std::size_t slot = 0; slot < m_ownRuntime.m_last.size(); ++slot)
             {
-                preProcess();
-                processEventImpl(evt, false);
-                postProcess();
+                auto last = m_ownRuntime.state(m_ownRuntime.m_last[slot]);
+                if (last != nullptr) history.emplace_back(m_layout.region(static_cast<details::TNodeIndex>(slot)), last);
             }
-            else
-            {
-                topSm()->m_postedTransitions.emplace(evt.clone());
-            }
-        }
-    };
-
-    /**
-     * @brief   EmptyStore
-     * @details Default empty store
-     */
-    struct EmptyStore {};
-
-    /**
-     * @brief   StateMachine
-     * @details CRTP base class for State Machines
-     *          - Holds the state machine's local storage that is shared among all sub-states to access common data
-     *          - Holds the posted events as a queue of prepared callbacks
-     */
-    template <typename SmType, typename StoreType = EmptyStore>
-    class StateMachine : public State<SmType, SmType>
-    {
-    private:
-        static_assert(std::is_default_constructible_v<StoreType>, "StoreType must be default constructible");
 
-        template <typename DerivedType, typename OtherSmType>
-        friend class State;
+            this->numberStates();
+            this->indexEvents();
+            m_layout.build(this);
+            m_layout.layOut(m_ownRuntime);
 
-        /**
-         * @brief   m_store
-         * @details State machine's local storage that is shared among all sub-states to access common data
-         */
-        StoreType* m_store = nullptr;
+            for (const auto&[region, last] : history) m_ownRuntime.m_last[region->m_slot] = last->m_node;
 
-        mutable bool m_processing = false;
+            if (m_maxConfigurations > 0) m_flat.build(this, m_maxConfigurations);
 
-        mutable std::deque<details::PostedTransition> m_pendingTransitions;
-        mutable std::queue<details::PostedTransition> m_postedTransitions;
+            m_prepared.store(this->m_revision, std::memory_order_release);
+        }
 
         /**
-         * @brief       Derived
-         * @details     Returns the state machine's derived pointer type
+         * @brief       reset
+         * @param[out]  runtime: an instance's runtime
+         * @details     Lays the runtime out for the prepared topology: stopped, without history, deferred nor posted events
          */
-        SmType& derived()
+        void reset(Runtime& runtime) const
         {
-            return static_cast<SmType&>(*this);
+            runtime.m_topSm = this;
+            m_layout.layOut(runtime);
+            clearDeferred(runtime);
+            runtime.m_deferredTransitions.clear();
+            runtime.m_postedTransitions.clear();
+            runtime.m_epochs = details::DeferralEpochs{};
         }
 
         /**
-         * @brief       Derived
-         * @details     Returns the state machine's derived pointer type
+         * @brief       activate
+         * @param[in]   runtime: an instance's runtime
+         * @details     Prepares the topology if it changed since the runtime was laid out, in which case the runtime no longer applies and is reset
+         * @return      Returns the runtime
          */
-        const SmType& derived() const
+        Runtime& activate(Runtime& runtime)
         {
-            return static_cast<const SmType&>(*this);
+            if (runtime.m_revision == this->m_revision) return runtime;
+
+            prepare();
+
+            if (true == runtime.started(0)) LOG_ERROR_DSM("Instance of state machine '" << this->m_name << "' reset, the topology changed while it was started");
+            reset(runtime);
+            return runtime;
         }
 
     protected:
         explicit StateMachine(const std::string& name = details::Name<SmType>())
             : State<SmType, SmType>{}
-            , m_store{ new StoreType() }
         {
             this->m_name = name;
+            this->m_runtime = &m_ownRuntime;
+            this->m_stateIndex = &m_states;
+            m_ownRuntime.m_topSm = this;
+            m_states.resize(this->m_id + 1, nullptr);
+            m_states[this->m_id] = this;
         }
 
         virtual ~StateMachine()
@@ -2306,14 +5347,12 @@ namespace dsm
             clear();
             stop();
 
-            m_pendingTransitions.clear();
-            while (false == m_postedTransitions.empty())
-            {
-                m_postedTransitions.pop();
-            }
+            clearDeferred(m_ownRuntime);
+            m_ownRuntime.m_postedTransitions.clear();
 
-            delete m_store;
-            m_store = nullptr;
+            // States remaining after clear are destroyed after these members
+            this->m_runtime = nullptr;
+            this->m_stateIndex = nullptr;
         }
 
     public:
@@ -2324,7 +5363,7 @@ namespace dsm
          */
         void visit(IStateVisitor& visitor)
         {
-            this->visitImpl(visitor);
+            this->visitImpl(runtime(), visitor);
         }
 
         /**
@@ -2354,6 +5393,9 @@ namespace dsm
         {
             if (this->started()) return;
 
+            // The last visited states are about to be destroyed
+            m_ownRuntime.m_last.assign(m_ownRuntime.m_last.size(), details::InvalidNode);
+
             this->clearImpl();
         }
 
@@ -2367,8 +5409,14 @@ namespace dsm
             {
                 if (this->started()) return;
 
+                // The topology is complete
+                prepare();
+
                 // Forward to implementation
-                this->startImpl(nullptr, false);
+                auto& runtime = this->runtime();
+                this->startImpl(runtime, nullptr, false);
+
+                m_flat.resync(runtime);
             }
             catch (...)
             {
@@ -2377,16 +5425,86 @@ namespace dsm
             }
         }
 
+        /**
+         * @brief       compile
+         * @param[in]   maxConfigurations: maximum number of reachable configurations
+         * @details     Opt-in: flattens the state machine into a table mapping each reachable configuration and event to the transitions to try,
+         *              each one with its precomputed exit and entry sequence and next configuration. The table is rebuilt on start whenever states,
+         *              transitions or history settings changed since. Events are processed through the hierarchy while the active configuration
+         *              is unknown to the table, e.g. after a transition requested from within a state, until a known one is reached
+         * @return      true if the reachable configurations fit within the provided maximum, false otherwise, in which case events keep being processed through the hierarchy
+         */
+        bool compile(std::size_t maxConfigurations = details::FlatMachine::DefaultMaxConfigurations)
+        {
+            if (this->started()) return false;
+
+            // The flat table relies on the layout's region slots
+            prepare();
+
+            m_maxConfigurations = maxConfigurations;
+            return m_flat.build(this, maxConfigurations);
+        }
+
+        /**
+         * @brief   compiled
+         * @return  true if events are processed through the flat table, false otherwise
+         */
+        bool compiled() const
+        {
+            return m_flat.ready();
+        }
+
+        /**
+         * @brief       setRegionScheduler
+         * @param[in]   scheduler: the scheduler, not owned, nullptr to run all the regions one after another
+         * @details     Opt-in: within a run-to-completion step, consecutive independent regions handling the event run concurrently through the scheduler.
+         *              Their posted events, deferred events and requested transitions are queued in region order once all of them completed,
+         *              so that the outcome is the one of running them one after another. The regions nested into a region run concurrently,
+         *              and the regions dispatched to through the hierarchy while the topology changed since the start, run one after another
+         */
+        void setRegionScheduler(IRegionScheduler* scheduler)
+        {
+            m_layout.schedule(scheduler, &Repost);
+        }
+
+        /**
+         * @brief       setIndependent
+         * @param[in]   independent: whether the region's handlers are independent from the ones of the other regions of StateType
+         * @details     Declares the provided StateType's region as independent, running concurrently with the other independent regions of StateType
+         *              once a region scheduler is set. Its handlers shall only share thread-safe data with theirs, the store included.
+         *              A region whose transitions lead out of it still runs alone
+         */
+        template <typename StateType, int RegionIndex>
+        void setIndependent(bool independent = true)
+        {
+            if (this->started()) return;
+
+            auto state = this->template getDescendantImpl<StateType>();
+            if (nullptr == state) return;
+
+            auto itRegion = state->m_regions.find(RegionIndex);
+            if (itRegion != state->m_regions.end())
+            {
+                itRegion->second->m_independent = independent;
+                ++this->m_revision;
+            }
+            else
+            {
+                LOG_ERROR_DSM("Failed to set independent region on state '" << state->name() << "' and region " << RegionIndex << ". Region not found");
+            }
+        }
+
         /**
          * @brief   stop
          * @details Stops the statemachine. Forwarded to implementation
          */
         void stop()
         {
-            if (!this->started()) return;
+            auto& runtime = this->runtime();
+            if (!runtime.started(this->m_node)) return;
 
             // Forward to implementation
-            this->stopImpl(nullptr);
+            this->stopImpl(runtime, nullptr);
         }
 
         /**
@@ -2820,6 +5938,36 @@ namespace dsm
             }
         }
 
+        /**
+         * @brief   addDeferredEvent
+         * @details Declares EventType as deferred while StateType is active.
+         *          Such events are queued, without being processed, then released once no active state defers them anymore
+         */
+        template <typename StateType, typename EventType>
+        void addDeferredEvent()
+        {
+            static_assert(details::is_state_v<StateType>, "StateType must inherit from State");
+            static_assert(details::is_event_v<EventType>, "EventType must inherit from Event");
+
+            if (this->started()) return;
+
+            try
+            {
+                auto state = this->template getDescendantImpl<StateType>();
+                if (nullptr == state)
+                {
+                    throw details::SmError() << "Failed to defer event '" << details::Name<EventType>() << "'. State '" << details::Name<StateType>() << "' not found";
+                }
+
+                state->addDeferredEvent(details::EventId<EventType>());
+            }
+            catch (...)
+            {
+                // State's error job
+                derived().onError(std::current_exception());
+            }
+        }
+
         /**
          * @brief   processEvent
          * @details Processes the provided event. Forwarded to implementation
@@ -2829,51 +5977,68 @@ namespace dsm
         {
             static_assert(details::is_event_v<EventType>, "EventType must inherit from Event");
 
+            processEvent(static_cast<const EventBase&>(evt));
+        }
+
+        /**
+         * @brief       processEvent
+         * @param[in]   evt: the event to process, whatever its dynamic type
+         * @details     Processes the provided type-erased event, e.g. one held by an Inbox
+         */
+        void processEvent(const EventBase& evt) const
+        {
             if (nullptr == this->m_topSm) return;
-            if (!this->started()) return;
+            auto& runtime = this->runtime();
+            if (!runtime.started(this->m_node)) return;
+
+            runtime.m_processing = true;
+            runToCompletion(runtime, evt);
+            runtime.m_processing = false;
+        }
 
-            this->preProcess();
+        /**
+         * @brief       processEvents
+         * @param[in]   events: range of events, or of pointers to events, to process in order
+         * @details     Same as calling processEvent on each event in turn, each one being processed to completion, along with
+         *              the events it posted, before the next one. The state machine is checked and set up once for the whole batch
+         */
+        template <typename RangeType>
+        void processEvents(const RangeType& events) const
+        {
+            if (nullptr == this->m_topSm) return;
+            auto& runtime = this->runtime();
+            if (!runtime.started(this->m_node)) return;
 
-            // Forward to implementation
-            this->processEventImpl(evt, false);
+            runtime.m_processing = true;
 
-            do
+            for (const auto& evt : events)
             {
-                // Transfer elements from posted to pending
-                while (false == m_postedTransitions.empty())
-                {
-                    m_pendingTransitions.push_back(std::move(m_postedTransitions.front()));
-                    m_postedTransitions.pop();
-                }
+                if constexpr (std::is_base_of_v<EventBase, std::decay_t<decltype(evt)>>) runToCompletion(runtime, evt);
+                else runToCompletion(runtime, *evt);
 
-                // Loop over pending transitions and executed the corresponding callbacks
-                auto it = m_pendingTransitions.begin();
-                while (it != m_pendingTransitions.end())
-                {
-                    details::PostedTransition& pending = *it;
-                    if (nullptr == pending.m_transition) // Posted or deferred events
-                    {
-                        bool result = this->processEventImpl(*pending.m_evt, false);
-                        if (false == pending.m_deferred || true == result)
-                        {
-                            it = m_pendingTransitions.erase(it);
-                        }
-                        else
-                        {
-                            ++it;
-                        }
-                    }
-                    else // User transition
-                    {
-                        static_cast<details::Transition<void>*>(pending.m_transition)->exec();
-                        it = m_pendingTransitions.erase(it);
-                    }
-                }
+                // Stopped from within a state: the remaining events are dropped, as processEvent would
+                if (false == runtime.started(this->m_node)) break;
             }
-            // Repeat until no more posted transition
-            while (false == m_postedTransitions.empty());
 
-            this->postProcess();
+            runtime.m_processing = false;
+        }
+
+        /**
+         * @brief   queueMetrics
+         * @return  Returns the current depths, high-water marks and counters of the run-to-completion queues
+         */
+        QueueMetrics queueMetrics() const
+        {
+            return MetricsOf(runtime());
+        }
+
+        /**
+         * @brief   resetQueueMetrics
+         * @details Resets high-water marks and counters to the current depths
+         */
+        void resetQueueMetrics()
+        {
+            ResetMetricsOf(runtime());
         }
 
         /**
@@ -2886,6 +6051,198 @@ namespace dsm
         {
             return this->template getDescendantImpl<StateType>();
         }
+
+        /**
+         * @brief   Instance
+         * @details Lightweight instance of the state machine. The states, transitions and history settings are built once in the
+         *          state machine, whose topology is shared by all its instances, and each instance only holds its runtime state:
+         *          the current and last visited sub-state of each region, its deferred events, queue metrics and store.
+         *          The topology is only read while running, each operation reading and writing the instance's runtime state, hence:
+         *          - the state machine shall outlive its instances, and its topology shall not change while any of them runs
+         *          - states are shared by all instances: per-instance data belongs to the store
+         *          - distinct instances may run concurrently on different threads, each instance being run from one thread at a time.
+         *            The state machine itself runs its own runtime state, independently of its instances
+         *          An instance whose topology changed since its last operation is reset.
+         *          Copying an instance clones it: a started prototype spawns new instances without setting up nor entering any state
+         */
+        class Instance
+        {
+        public:
+            explicit Instance(SmType& topology)
+                : m_topology{ &topology }
+                , m_runtime{ std::make_unique<Runtime>() }
+            {
+                m_topology->prepare();
+                m_topology->reset(*m_runtime);
+            }
+
+            /**
+             * @brief       Instance
+             * @param[in]   prototype: the instance to clone
+             * @details     Copies the prototype's runtime state, deferred events and store, which must be copy constructible.
+             *              No user code is called: the clone resumes where the prototype stands.
+             *              A prototype running, i.e. cloned from within its own callbacks, is not copied and leaves the clone stopped
+             */
+            Instance(const Instance& prototype)
+                : m_topology{ prototype.m_topology }
+                , m_runtime{ std::make_unique<Runtime>() }
+            {
+                const auto& source = *prototype.m_runtime;
+                auto& runtime = *m_runtime;
+
+                if (source.m_running > 0)
+                {
+                    LOG_ERROR_DSM("Failed to clone an instance of state machine '" << m_topology->m_name << "'. The instance is running");
+                    m_topology->prepare();
+                    m_topology->reset(runtime);
+                    return;
+                }
+
+                runtime.m_topSm = source.m_topSm;
+                runtime.m_layout = source.m_layout;
+                runtime.m_revision = source.m_revision;
+                runtime.m_nodes = source.m_nodes;
+                runtime.m_current = source.m_current;
+                runtime.m_last = source.m_last;
+                runtime.m_started = source.m_started;
+                runtime.m_trigEvents.assign(source.m_trigEvents.size(), nullptr);
+                runtime.m_configuration = source.m_configuration;
+                runtime.m_epochs = source.m_epochs;
+                runtime.m_deferredOrder = source.m_deferredOrder;
+                runtime.m_queueMetrics = source.m_queueMetrics;
+                runtime.m_store = std::make_unique<StoreType>(*source.m_store);
+
+                for (std::size_t index = 0; index < source.m_postedTransitions.size(); ++index)
+                {
+                    runtime.m_postedTransitions.emplace(source.m_postedTransitions.at(index).clone());
+                }
+
+                runtime.m_deferredTransitions.resize(source.m_deferredTransitions.size());
+                for (std::size_t id = 0; id < runtime.m_deferredTransitions.size(); ++id)
+                {
+                    const auto& deferred = source.m_deferredTransitions[id];
+                    if (nullptr == deferred) continue;
+
+                    runtime.m_deferredTransitions[id] = std::make_unique<details::NodeList<details::DeferredTransition>>();
+                    for (auto node = deferred->front(); node != nullptr; node = node->m_next)
+                    {
+                        runtime.m_deferredTransitions[id]->push_back(details::DeferredTransition{
+                            node->m_value.m_transition.clone(), node->m_value.m_order, node->m_value.m_tried });
+                    }
+                }
+            }
+
+            Instance& operator=(const Instance& prototype)
+            {
+                if (this != &prototype) *this = Instance{ prototype };
+                return *this;
+            }
+
+            Instance(Instance&&) = default;
+            Instance& operator=(Instance&&) = default;
+
+            /**
+             * @brief   clone
+             * @return  Returns a copy of this instance
+             */
+            Instance clone() const
+            {
+                return Instance{ *this };
+            }
+
+            void start()
+            {
+                Activation activation{ *this };
+                m_topology->start();
+            }
+
+            void stop()
+            {
+                Activation activation{ *this };
+                m_topology->stop();
+            }
+
+            bool started() const
+            {
+                return m_runtime->started(0);
+            }
+
+            template <typename EventType>
+            void processEvent(const EventType& evt)
+            {
+                Activation activation{ *this };
+                m_topology->processEvent(evt);
+            }
+
+            template <typename RangeType>
+            void processEvents(const RangeType& events)
+            {
+                Activation activation{ *this };
+                m_topology->processEvents(events);
+            }
+
+            template <typename EventType>
+            void deferEvent(const EventType& evt)
+            {
+                Activation activation{ *this };
+                m_topology->deferEvent(evt);
+            }
+
+            template <typename ...StateTypes>
+            bool checkStates()
+            {
+                Activation activation{ *this };
+                return m_topology->template checkStates<StateTypes...>();
+            }
+
+            StoreType* store()
+            {
+                return m_runtime->m_store.get();
+            }
+
+            const StoreType* store() const
+            {
+                return m_runtime->m_store.get();
+            }
+
+            QueueMetrics queueMetrics() const
+            {
+                return MetricsOf(*m_runtime);
+            }
+
+        private:
+            friend class StateMachine;
+
+            /**
+             * @brief   Activation
+             * @details Makes the instance's runtime, laid out for the current topology, the one run by the calling thread for the activation's lifetime
+             */
+            struct Activation
+            {
+                explicit Activation(Instance& instance)
+                    : m_runtime{ instance.m_topology->activate(*instance.m_runtime) }
+                    , m_scope{ m_runtime }
+                {
+                    ++m_runtime.m_running;
+                }
+
+                ~Activation()
+                {
+                    --m_runtime.m_running;
+                }
+
+                Runtime& m_runtime;
+                details::Runtime::Scope m_scope;
+            };
+
+            StateMachine* m_topology;
+
+            /**
+             * @brief   m_runtime
+             * @details The instance's runtime state, queues and store. Allocated, so that moving an instance keeps the runtime in place
+             */
+            std::unique_ptr<Runtime> m_runtime;
+        };
     };
 }
 
@@ -0,0 +1,632 @@
+#ifndef DSM_EXECUTOR_INCLUDED_
+#define DSM_EXECUTOR_INCLUDED_
+
+#include "dsm.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dsm
+{
+    class Executor;
+
+    namespace details
+    {
+        /**
+         * @brief   TaskLink
+         * @details Link of a strand's task queue
+         */
+        struct TaskLink
+        {
+            std::atomic<TaskLink*> m_next{ nullptr };
+        };
+
+        /**
+         * @brief   Task
+         * @details Event posted to a state machine through a strand
+         */
+        struct Task : TaskLink
+        {
+            using TProcessFunc = void(*)(void* machine, const dsm::EventBase& evt);
+
+            void* m_machine = nullptr;
+            TProcessFunc m_process = nullptr;
+            EventEnvelope m_evt;
+        };
+
+        /**
+         * @brief   SteadyNow
+         * @return  Returns the steady clock's current time, in nanoseconds
+         */
+        inline std::uint64_t SteadyNow()
+        {
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+    }
+
+    /**
+     * @brief   Strand
+     * @details Serializes the processing of the events posted to its state machines: a strand never runs on two workers at once.
+     *          A state machine, or an instance, shall only be posted to through a single strand. Instances of a shared topology
+     *          may be posted to through distinct strands, hence run concurrently on different workers.
+     *          Events are queued into a lock-free intrusive MPSC list (from D. Vyukov), and the strand is scheduled onto its executor's
+     *          workers as soon as it holds pending events, and stays owned by its worker until all of them have been processed
+     */
+    class Strand
+    {
+    public:
+        explicit Strand(Executor& executor);
+
+        Strand(const Strand&) = delete;
+        Strand& operator=(const Strand&) = delete;
+
+        /**
+         * @brief   ~Strand
+         * @details Waits for the events posted through the strand to be processed, which shall not be from within one of them
+         */
+        ~Strand();
+
+        /**
+         * @brief       postEvent
+         * @param[in]   machine: the state machine, or instance, to process the event
+         * @param[in]   evt: the event to post, copied into the strand
+         * @details     Posts the provided event from any thread, including from within a state machine run by the executor
+         */
+        template <typename MachineType, typename EventType>
+        void postEvent(MachineType& machine, const EventType& evt);
+
+    private:
+        friend class Executor;
+
+        template <typename MachineType>
+        static void Process(void* machine, const EventBase& evt)
+        {
+            static_cast<MachineType*>(machine)->processEvent(evt);
+        }
+
+        static void release(details::Task* task)
+        {
+            task->~Task();
+            details::EventPool<details::Task>::Release(task);
+        }
+
+        void push(details::TaskLink* link)
+        {
+            link->m_next.store(nullptr, std::memory_order_relaxed);
+            auto prev = m_tail.exchange(link, std::memory_order_seq_cst);
+            prev->m_next.store(link, std::memory_order_release);
+        }
+
+        /**
+         * @brief   pop
+         * @details Called by the worker running the strand only
+         * @return  Returns the oldest task, or nullptr if none or if a producer is still linking it
+         */
+        details::Task* pop()
+        {
+            auto head = m_head;
+            auto next = head->m_next.load(std::memory_order_acquire);
+
+            if (&m_stub == head)
+            {
+                if (nullptr == next) return nullptr;
+                m_head = next;
+                head = next;
+                next = next->m_next.load(std::memory_order_acquire);
+            }
+
+            if (next != nullptr)
+            {
+                m_head = next;
+                return static_cast<details::Task*>(head);
+            }
+
+            // Producer in progress
+            if (m_tail.load(std::memory_order_acquire) != head) return nullptr;
+
+            push(&m_stub);
+            next = head->m_next.load(std::memory_order_acquire);
+            if (nullptr == next) return nullptr;
+
+            m_head = next;
+            return static_cast<details::Task*>(head);
+        }
+
+        /**
+         * @brief       run
+         * @param[in]   budget: maximum number of events to process
+         * @return      Returns the number of processed events
+         */
+        std::size_t run(std::size_t budget)
+        {
+            std::size_t count = 0;
+
+            while (count < budget)
+            {
+                auto task = pop();
+                if (nullptr == task) break;
+
+                std::unique_ptr<details::Task, void(*)(details::Task*)> guard{ task, &release };
+                task->m_process(task->m_machine, *task->m_evt.get());
+                ++count;
+            }
+
+            m_processed.store(m_processed.load(std::memory_order_relaxed) + count, std::memory_order_seq_cst);
+            return count;
+        }
+
+        Executor& m_executor;
+
+        details::TaskLink m_stub;
+        details::TaskLink* m_head = &m_stub;
+        std::atomic<details::TaskLink*> m_tail{ &m_stub };
+
+        /**
+         * @brief   m_queued
+         * @details Number of events posted through the strand and not processed yet. The strand is scheduled when it rises from 0,
+         *          and is queued onto, or run by, a worker as long as it is not 0 again: only that worker reads the task queue
+         */
+        std::atomic<std::size_t> m_queued{ 0 };
+
+        /**
+         * @brief   m_posted
+         * @details Number of events posted through the strand so far
+         */
+        std::atomic<std::uint64_t> m_posted{ 0 };
+
+        /**
+         * @brief   m_processed
+         * @details Number of events processed so far, written by the worker running the strand only
+         */
+        std::atomic<std::uint64_t> m_processed{ 0 };
+
+        /**
+         * @brief   m_prev, m_next
+         * @details Links of the executor's list of strands
+         */
+        Strand* m_prev = nullptr;
+        Strand* m_next = nullptr;
+
+        /**
+         * @brief   m_readyAt
+         * @details Time the strand was last queued onto a worker, for queue latency metrics
+         */
+        std::uint64_t m_readyAt = 0;
+    };
+
+    /**
+     * @brief   WorkerMetrics
+     * @details Activity of a worker since the executor's start or the last metrics reset
+     */
+    struct WorkerMetrics
+    {
+        /**
+         * @brief   utilization
+         * @details Share of the elapsed time spent processing events, from 0 to 1
+         */
+        double utilization = 0.0;
+
+        /**
+         * @brief   events
+         * @details Number of processed events
+         */
+        std::uint64_t events = 0;
+
+        /**
+         * @brief   runs
+         * @details Number of strand runs, each one processing up to the executor's budget of events
+         */
+        std::uint64_t runs = 0;
+
+        /**
+         * @brief   steals
+         * @details Number of strands taken from other workers
+         */
+        std::uint64_t steals = 0;
+
+        /**
+         * @brief   meanLatency
+         * @details Mean time in nanoseconds between a strand being queued and being run
+         */
+        std::uint64_t meanLatency = 0;
+
+        /**
+         * @brief   maxLatency
+         * @details Maximum time in nanoseconds between a strand being queued and being run
+         */
+        std::uint64_t maxLatency = 0;
+    };
+
+    /**
+     * @brief   Executor
+     * @details Multiplexes many state machines over a pool of worker threads. Each worker has its own queue of ready strands:
+     *          strands scheduled from a worker are queued onto that worker, others are spread over all workers, and idle workers steal
+     *          strands from the others. A strand runs up to the budget of events at once, then yields its worker to the next ready strand
+     */
+    class Executor
+    {
+    public:
+        static constexpr std::size_t DefaultBudget = 64;
+
+        /**
+         * @brief       Executor
+         * @param[in]   workers: number of worker threads, the hardware concurrency by default
+         * @param[in]   budget: maximum number of events a strand processes before yielding its worker
+         */
+        explicit Executor(std::size_t workers = std::max(1u, std::thread::hardware_concurrency()), std::size_t budget = DefaultBudget)
+            : m_budget{ std::max<std::size_t>(1, budget) }
+        {
+            workers = std::max<std::size_t>(1, workers);
+            for (std::size_t index = 0; index < workers; ++index) m_workers.push_back(std::make_unique<Worker>());
+            for (std::size_t index = 0; index < workers; ++index) m_workers[index]->m_thread = std::thread{ [this, index]() { work(index); } };
+        }
+
+        Executor(const Executor&) = delete;
+        Executor& operator=(const Executor&) = delete;
+
+        /**
+         * @brief   ~Executor
+         * @details Processes the events posted so far, then stops the workers
+         */
+        ~Executor()
+        {
+            m_stopping.store(true, std::memory_order_seq_cst);
+            {
+                std::lock_guard<std::mutex> lock{ m_mutex };
+                m_cv.notify_all();
+            }
+
+            for (auto& worker : m_workers)
+            {
+                if (worker->m_thread.joinable()) worker->m_thread.join();
+            }
+        }
+
+        /**
+         * @brief   wait
+         * @details Blocks until every event posted so far, and those they posted meanwhile, has been processed.
+         *          Woken up by the worker running out of ready strands once the strands' event counts add up
+         */
+        void wait() const
+        {
+            std::unique_lock<std::mutex> lock{ m_mutex };
+            ++m_waiters;
+            m_idle.wait(lock, [this]() { return true == idle(); });
+            --m_waiters;
+        }
+
+        std::size_t workers() const
+        {
+            return m_workers.size();
+        }
+
+        /**
+         * @brief   metrics
+         * @return  Returns the activity of each worker
+         */
+        std::vector<WorkerMetrics> metrics() const
+        {
+            const auto now = details::SteadyNow();
+
+            std::vector<WorkerMetrics> result;
+            for (const auto& worker : m_workers)
+            {
+                WorkerMetrics metrics;
+                const auto elapsed = now - worker->m_since.load(std::memory_order_relaxed);
+                const auto runs = worker->m_runs.load(std::memory_order_relaxed);
+                metrics.utilization = (elapsed > 0) ? std::min(1.0, static_cast<double>(worker->m_busy.load(std::memory_order_relaxed)) / static_cast<double>(elapsed)) : 0.0;
+                metrics.events = worker->m_events.load(std::memory_order_relaxed);
+                metrics.runs = runs;
+                metrics.steals = worker->m_steals.load(std::memory_order_relaxed);
+                metrics.meanLatency = (runs > 0) ? worker->m_latency.load(std::memory_order_relaxed) / runs : 0;
+                metrics.maxLatency = worker->m_maxLatency.load(std::memory_order_relaxed);
+                result.push_back(metrics);
+            }
+
+            return result;
+        }
+
+        /**
+         * @brief   resetMetrics
+         * @details Restarts the workers' metrics. Counters updated meanwhile by a running worker may be lost
+         */
+        void resetMetrics()
+        {
+            const auto now = details::SteadyNow();
+            for (auto& worker : m_workers)
+            {
+                worker->m_since.store(now, std::memory_order_relaxed);
+                worker->m_busy.store(0, std::memory_order_relaxed);
+                worker->m_events.store(0, std::memory_order_relaxed);
+                worker->m_runs.store(0, std::memory_order_relaxed);
+                worker->m_steals.store(0, std::memory_order_relaxed);
+                worker->m_latency.store(0, std::memory_order_relaxed);
+                worker->m_maxLatency.store(0, std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        friend class Strand;
+
+        /**
+         * @brief   Worker
+         * @details Worker thread along with its queue of ready strands. Metrics are only written by the worker itself
+         */
+        struct Worker
+        {
+            std::mutex m_mutex;
+            std::deque<Strand*> m_ready;
+            std::atomic<std::size_t> m_size{ 0 };   // Size of m_ready, readable without locking
+            std::thread m_thread;
+            const Executor* m_executor = nullptr;
+
+            std::atomic<std::uint64_t> m_since{ details::SteadyNow() };
+            std::atomic<std::uint64_t> m_busy{ 0 };
+            std::atomic<std::uint64_t> m_events{ 0 };
+            std::atomic<std::uint64_t> m_runs{ 0 };
+            std::atomic<std::uint64_t> m_steals{ 0 };
+            std::atomic<std::uint64_t> m_latency{ 0 };
+            std::atomic<std::uint64_t> m_maxLatency{ 0 };
+        };
+
+        /**
+         * @brief   Current
+         * @return  Returns the worker running on the calling thread, if any
+         */
+        static Worker*& Current()
+        {
+            thread_local Worker* worker = nullptr;
+            return worker;
+        }
+
+        /**
+         * @brief       schedule
+         * @param[in]   strand: the strand holding pending events
+         * @details     Queues the strand onto the calling worker if it belongs to this executor, onto the next worker in turn otherwise
+         */
+        void schedule(Strand* strand)
+        {
+            Worker* worker = Current();
+            if (nullptr == worker || worker->m_executor != this)
+            {
+                // Round robin without any read-modify-write: concurrent schedulers may pick a same worker, which is harmless
+                const auto next = m_next.load(std::memory_order_relaxed);
+                m_next.store(next + 1, std::memory_order_relaxed);
+                worker = m_workers[next % m_workers.size()].get();
+            }
+
+            strand->m_readyAt = details::SteadyNow();
+            {
+                std::lock_guard<std::mutex> lock{ worker->m_mutex };
+                worker->m_ready.push_back(strand);
+                worker->m_size.store(worker->m_ready.size(), std::memory_order_relaxed);
+            }
+
+            // Pairs with work: either a worker going to sleep sees the strand, or the scheduler sees it sleeping
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_sleepers.load(std::memory_order_relaxed) > 0)
+            {
+                std::lock_guard<std::mutex> lock{ m_mutex };
+                m_cv.notify_one();
+            }
+        }
+
+        /**
+         * @brief       take
+         * @param[in]   index: the calling worker's index
+         * @return      Returns the next strand of the worker's queue, or one stolen from another worker, nullptr if none
+         */
+        Strand* take(std::size_t index)
+        {
+            auto& worker = *m_workers[index];
+            {
+                std::lock_guard<std::mutex> lock{ worker.m_mutex };
+                if (false == worker.m_ready.empty())
+                {
+                    auto strand = worker.m_ready.front();
+                    worker.m_ready.pop_front();
+                    worker.m_size.store(worker.m_ready.size(), std::memory_order_relaxed);
+                    return strand;
+                }
+            }
+
+            // Steal the most recently queued strand of the first busy worker
+            for (std::size_t offset = 1; offset < m_workers.size(); ++offset)
+            {
+                auto& victim = *m_workers[(index + offset) % m_workers.size()];
+                std::lock_guard<std::mutex> lock{ victim.m_mutex };
+                if (false == victim.m_ready.empty())
+                {
+                    auto strand = victim.m_ready.back();
+                    victim.m_ready.pop_back();
+                    victim.m_size.store(victim.m_ready.size(), std::memory_order_relaxed);
+                    worker.m_steals.fetch_add(1, std::memory_order_relaxed);
+                    return strand;
+                }
+            }
+
+            return nullptr;
+        }
+
+        /**
+         * @brief       work
+         * @param[in]   index: the worker's index
+         * @details     Worker thread: runs ready strands, sleeps when there is none, until the executor stops
+         */
+        void work(std::size_t index)
+        {
+            auto& worker = *m_workers[index];
+            worker.m_executor = this;
+            Current() = &worker;
+
+            for (;;)
+            {
+                Strand* strand = take(index);
+
+                if (nullptr == strand)
+                {
+                    std::unique_lock<std::mutex> lock{ m_mutex };
+
+                    // Waiters and the other workers, once stopping, only check the event counts when a worker runs out of strands
+                    const bool stopping = m_stopping.load(std::memory_order_relaxed);
+                    if ((m_waiters > 0 || true == stopping) && true == idle())
+                    {
+                        m_idle.notify_all();
+                        if (true == stopping)
+                        {
+                            m_cv.notify_all();
+                            break;
+                        }
+                    }
+
+                    m_sleepers.fetch_add(1, std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    m_cv.wait(lock, [this]() { return true == ready() || (true == m_stopping.load(std::memory_order_relaxed) && true == idle()); });
+                    m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+                    continue;
+                }
+
+                const auto start = details::SteadyNow();
+                const auto latency = start - std::min(start, strand->m_readyAt);
+
+                const auto count = strand->run(m_budget);
+
+                worker.m_busy.fetch_add(details::SteadyNow() - start, std::memory_order_relaxed);
+                worker.m_events.fetch_add(count, std::memory_order_relaxed);
+                worker.m_runs.fetch_add(1, std::memory_order_relaxed);
+                worker.m_latency.fetch_add(latency, std::memory_order_relaxed);
+                if (latency > worker.m_maxLatency.load(std::memory_order_relaxed)) worker.m_maxLatency.store(latency, std::memory_order_relaxed);
+
+                // A strand still holding events, including ones a producer is linking, is queued behind the worker's other strands.
+                // Otherwise the next producer schedules it: the strand may be destroyed from then on and is not accessed anymore
+                if (strand->m_queued.fetch_sub(count, std::memory_order_acq_rel) > count) schedule(strand);
+            }
+
+            Current() = nullptr;
+        }
+
+        const std::size_t m_budget;
+        std::vector<std::unique_ptr<Worker>> m_workers;
+
+        /**
+         * @brief   m_next
+         * @details Worker onto which the next strand scheduled from outside the executor is queued
+         */
+        std::atomic<std::size_t> m_next{ 0 };
+
+        /**
+         * @brief       ready
+         * @return      true if a strand is queued onto any worker
+         */
+        bool ready() const
+        {
+            for (const auto& worker : m_workers)
+            {
+                if (worker->m_size.load(std::memory_order_relaxed) > 0) return true;
+            }
+
+            return false;
+        }
+
+        /**
+         * @brief   idle
+         * @details Adds up the events processed by every strand, then those posted to them. Events are counted as posted
+         *          before being processed, and as processed once the events they posted are counted, hence both sums are
+         *          equal only if no event is left to process
+         * @return  true if every posted event has been processed
+         */
+        bool idle() const
+        {
+            std::lock_guard<std::mutex> lock{ m_strandsMutex };
+
+            std::uint64_t processed = 0;
+            for (auto strand = m_strands; strand != nullptr; strand = strand->m_next) processed += strand->m_processed.load(std::memory_order_seq_cst);
+
+            std::uint64_t posted = 0;
+            for (auto strand = m_strands; strand != nullptr; strand = strand->m_next) posted += strand->m_posted.load(std::memory_order_seq_cst);
+
+            return processed == posted;
+        }
+
+        void attach(Strand* strand)
+        {
+            std::lock_guard<std::mutex> lock{ m_strandsMutex };
+            strand->m_next = m_strands;
+            if (m_strands != nullptr) m_strands->m_prev = strand;
+            m_strands = strand;
+        }
+
+        void detach(Strand* strand)
+        {
+            std::lock_guard<std::mutex> lock{ m_strandsMutex };
+            if (strand->m_prev != nullptr) strand->m_prev->m_next = strand->m_next;
+            else m_strands = strand->m_next;
+            if (strand->m_next != nullptr) strand->m_next->m_prev = strand->m_prev;
+        }
+
+        /**
+         * @brief   m_strands
+         * @details Strands of the executor, whose event counts are only added up when waiting
+         */
+        Strand* m_strands = nullptr;
+        mutable std::mutex m_strandsMutex;
+
+        std::atomic<std::size_t> m_sleepers{ 0 };
+        mutable std::size_t m_waiters = 0;  // Guarded by m_mutex
+        std::atomic<bool> m_stopping{ false };
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cv;
+        mutable std::condition_variable m_idle;
+    };
+
+    inline Strand::Strand(Executor& executor)
+        : m_executor{ executor }
+    {
+        m_executor.attach(this);
+    }
+
+    inline Strand::~Strand()
+    {
+        while (m_queued.load(std::memory_order_acquire) > 0) std::this_thread::yield();
+        while (auto task = pop()) release(task);
+        m_executor.detach(this);
+    }
+
+    template <typename MachineType, typename EventType>
+    void Strand::postEvent(MachineType& machine, const EventType& evt)
+    {
+        static_assert(details::is_event_v<EventType>, "EventType must inherit from Event");
+
+        void* block = details::EventPool<details::Task>::Allocate();
+        auto task = new (block) details::Task();
+        try
+        {
+            task->m_evt.emplace(evt);
+        }
+        catch (...)
+        {
+            release(task);
+            throw;
+        }
+        task->m_machine = &machine;
+        task->m_process = &Process<MachineType>;
+
+        // Counted before being linked, so that the strand is never released by its worker while holding the task
+        m_posted.fetch_add(1, std::memory_order_relaxed);
+        const auto queued = m_queued.fetch_add(1, std::memory_order_acq_rel);
+        push(task);
+
+        if (0 == queued) m_executor.schedule(this);
+    }
+}
+
+#endif
@@ -0,0 +1,244 @@
+#ifndef DSM_INBOX_INCLUDED_
+#define DSM_INBOX_INCLUDED_
+
+#include "dsm.hpp"
+#include "bounded_queue.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace dsm
+{
+    /**
+     * @brief   WaitPolicy
+     * @details Behavior of Inbox::run once the inbox is empty, and of producers once it is full
+     */
+    enum class WaitPolicy
+    {
+        Block = 0,      // The owning thread sleeps until an event is posted, producers until a slot is freed
+        BusyPoll = 1    // The owning thread and producers keep polling, yielding between polls, for the lowest latency
+    };
+
+    /**
+     * @brief   Inbox
+     * @details Thread-safe event ingress of a state machine, or of a state machine instance, owned by a single thread.
+     *          Any thread posts events into a preallocated lock-free ring buffer (see details::BoundedQueue)
+     *          without touching the machine, and the owning thread drains it through run or runOnce, processing each event to completion
+     *          before the next one. Events of a same producer are processed in posting order.
+     *          A producer finding the inbox full waits for a free slot, according to the wait policy, hence the owning thread shall not post into its own inbox:
+     *          states post through the machine's postEvent instead
+     */
+    template <typename MachineType>
+    class Inbox
+    {
+    public:
+        static constexpr std::size_t DefaultCapacity = 1024;
+
+        /**
+         * @brief       Inbox
+         * @param[in]   machine: the state machine, or instance, processing the posted events
+         * @param[in]   capacity: number of events the ring buffer can hold, rounded up to a power of two
+         * @param[in]   policy: wait policy of run
+         */
+        explicit Inbox(MachineType& machine, std::size_t capacity = DefaultCapacity, WaitPolicy policy = WaitPolicy::Block)
+            : m_machine{ machine }
+            , m_queue{ capacity }
+            , m_policy{ policy }
+        {}
+
+        Inbox(const Inbox&) = delete;
+        Inbox& operator=(const Inbox&) = delete;
+
+        /**
+         * @brief       postEvent
+         * @param[in]   evt: the event to post, copied into the inbox
+         * @details     Posts the provided event from any thread. Waits for a free slot if the inbox is full
+         */
+        template <typename EventType>
+        void postEvent(const EventType& evt)
+        {
+            static_assert(details::is_event_v<EventType>, "EventType must inherit from Event");
+
+            TSlot* slot = acquire();
+
+            try
+            {
+                slot->m_value.emplace(evt);
+            }
+            catch (...)
+            {
+                // Empty slots are skipped by the owning thread
+                release(slot);
+                throw;
+            }
+
+            release(slot);
+        }
+
+        /**
+         * @brief   runOnce
+         * @details Processes, on the owning thread, the events posted so far, up to the inbox's capacity
+         * @return  Returns the number of processed events
+         */
+        std::size_t runOnce()
+        {
+            std::size_t count = 0;
+            std::size_t popped = 0;
+
+            for (std::size_t i = 0; i < m_queue.capacity(); ++i)
+            {
+                auto posted = m_queue.front();
+                if (nullptr == posted) break;
+
+                // Frees the slot before processing, without any allocation
+                details::EventEnvelope evt{ std::move(*posted) };
+                m_queue.pop();
+                ++popped;
+
+                // Blocked producers are woken up once half the slots are free, the ones about to block are caught after the loop
+                if (popped == m_queue.capacity() / 2 && m_blocked.load(std::memory_order_relaxed) > 0) wakeUpProducers();
+
+                if (false == bool(evt)) continue;
+
+                m_machine.processEvent(*evt.get());
+                ++count;
+            }
+
+            if (popped > 0)
+            {
+                // Pairs with acquire: either a producer about to block sees the freed slots, or the owning thread sees it blocked
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (m_blocked.load(std::memory_order_relaxed) > 0) wakeUpProducers();
+            }
+
+            return count;
+        }
+
+        /**
+         * @brief   run
+         * @details Processes posted events on the calling thread, which becomes the owning one, waiting for new ones according to the wait policy.
+         *          Returns once stop is called and the events posted before are processed
+         */
+        void run()
+        {
+            for (;;)
+            {
+                const bool stopping = m_stopping.exchange(false, std::memory_order_acq_rel);
+
+                runOnce();
+
+                if (true == stopping) return;
+
+                wait();
+            }
+        }
+
+        /**
+         * @brief   stop
+         * @details Requests run to return, from any thread
+         */
+        void stop()
+        {
+            m_stopping.store(true, std::memory_order_seq_cst);
+            wakeUp();
+        }
+
+        std::size_t capacity() const
+        {
+            return m_queue.capacity();
+        }
+
+        WaitPolicy policy() const
+        {
+            return m_policy;
+        }
+
+    private:
+        using TSlot = typename details::BoundedQueue<details::EventEnvelope>::Slot;
+
+        /**
+         * @brief   acquire
+         * @details Claims the next free slot, waiting for the owning thread to free one if the inbox is full
+         */
+        TSlot* acquire()
+        {
+            for (;;)
+            {
+                TSlot* slot = m_queue.tryAcquire();
+                if (slot != nullptr) return slot;
+
+                // Full
+                if (WaitPolicy::BusyPoll == m_policy)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock{ m_mutex };
+                m_blocked.fetch_add(1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                m_notFull.wait(lock, [this, &slot]() { return nullptr != (slot = m_queue.tryAcquire()); });
+                m_blocked.fetch_sub(1, std::memory_order_relaxed);
+                return slot;
+            }
+        }
+
+        void release(TSlot* slot)
+        {
+            m_queue.publish(slot);
+
+            // Pairs with wait: either the owning thread sees the event, or the producer sees it sleeping
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (true == m_sleeping.load(std::memory_order_seq_cst)) wakeUp();
+        }
+
+        /**
+         * @brief   wait
+         * @details Waits on the owning thread for an event to be posted, or for stop to be called
+         */
+        void wait()
+        {
+            if (WaitPolicy::BusyPoll == m_policy)
+            {
+                while (false == m_queue.ready() && false == m_stopping.load(std::memory_order_acquire)) std::this_thread::yield();
+                return;
+            }
+
+            std::unique_lock<std::mutex> lock{ m_mutex };
+            m_sleeping.store(true, std::memory_order_seq_cst);
+            m_cv.wait(lock, [this]() { return true == m_queue.ready() || true == m_stopping.load(std::memory_order_seq_cst); });
+            m_sleeping.store(false, std::memory_order_relaxed);
+        }
+
+        void wakeUp()
+        {
+            std::lock_guard<std::mutex> lock{ m_mutex };
+            m_cv.notify_one();
+        }
+
+        void wakeUpProducers()
+        {
+            std::lock_guard<std::mutex> lock{ m_mutex };
+            m_notFull.notify_all();
+        }
+
+        MachineType& m_machine;
+        details::BoundedQueue<details::EventEnvelope> m_queue;
+        const WaitPolicy m_policy;
+
+        alignas(64) std::atomic<bool> m_sleeping{ false };
+        std::atomic<bool> m_stopping{ false };
+        std::atomic<std::size_t> m_blocked{ 0 };    // Producers waiting for a free slot
+
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::condition_variable m_notFull;
+    };
+}
+
+#endif
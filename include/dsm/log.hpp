@@ -1,8 +1,16 @@
 #ifndef LOG_INTERFACE
 #define LOG_INTERFACE
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <optional>
+#include <ostream>
+#include <streambuf>
 #include <string>
+#include <string_view>
+#include <type_traits>
 
 #define cstr(str) u8##str
 
@@ -14,10 +22,11 @@ namespace Log
         eInfo,
         eWarning,
         eError,
-        eFatal
+        eFatal,
+        eOff // Threshold only: disables all levels
     };
 
-    const char* LevelToStr(LogLevel level)
+    inline const char* LevelToStr(LogLevel level)
     {
         switch (level)
         {
@@ -31,6 +40,8 @@ namespace Log
                 return " - Error - ";
             case eFatal:
                 return " - Fatal - ";
+            default:
+                break;
         }
 
         return " - Unknown - ";
@@ -38,41 +49,379 @@ namespace Log
 
     struct ILogger
     {
-        virtual void writeLog(const std::string& module, LogLevel level, const std::string& msg) = 0;
+        virtual ~ILogger() = default;
+
+        /**
+         * @brief   writeLog
+         * @details Outputs a record. The provided views are only valid for the duration of the call.
+         *          Implementations shall override either this overload or the std::string one
+         */
+        virtual void writeLog(std::string_view module, LogLevel level, std::string_view msg)
+        {
+            writeLog(std::string(module), level, std::string(msg));
+        }
+
+        /**
+         * @brief   writeLog
+         * @details Outputs a record. Kept for sinks written against the former interface, it forwards to the std::string_view
+         *          overload by default. Sinks only overriding this overload pay for a copy of each record
+         */
+        virtual void writeLog(const std::string& module, LogLevel level, const std::string& msg)
+        {
+            writeLog(std::string_view(module), level, std::string_view(msg));
+        }
+
+        /**
+         * @brief   writeLog
+         * @details Outputs a record given as C strings, which would otherwise match both overloads above equally well
+         */
+        void writeLog(const char* module, LogLevel level, const char* msg)
+        {
+            writeLog(std::string_view(module), level, std::string_view(msg));
+        }
+    };
+
+    /**
+     * @brief   LineBuffer
+     * @details Stream buffer writing into a fixed size array. Characters beyond the capacity are discarded
+     */
+    class LineBuffer : public std::streambuf
+    {
+    public:
+        static constexpr std::size_t Capacity = 512;
+
+        LineBuffer()
+        {
+            reset();
+        }
+
+        void reset()
+        {
+            setp(m_buffer, m_buffer + Capacity);
+        }
+
+        std::string_view view() const
+        {
+            return std::string_view(pbase(), static_cast<std::size_t>(pptr() - pbase()));
+        }
+
+    private:
+        int_type overflow(int_type ch) override
+        {
+            // Buffer full: silently truncate
+            return traits_type::not_eof(ch);
+        }
+
+        char m_buffer[Capacity];
+    };
+
+    /**
+     * @brief   LineStream
+     * @details Output stream over a LineBuffer, so that formatting a record never allocates.
+     *          Records longer than the buffer's capacity are truncated
+     */
+    class LineStream : private LineBuffer, public std::ostream
+    {
+    public:
+        LineStream()
+            : std::ostream{ static_cast<LineBuffer*>(this) }
+        {}
+
+        LineStream(const LineStream&) = delete;
+        LineStream& operator=(const LineStream&) = delete;
+
+        /**
+         * @brief   reset
+         * @details Empties the stream and clears its state flags
+         */
+        void reset()
+        {
+            LineBuffer::reset();
+            clear();
+        }
+
+        /**
+         * @brief   view
+         * @return  Returns a view on the formatted record
+         */
+        std::string_view view() const
+        {
+            return LineBuffer::view();
+        }
+    };
+
+    /**
+     * @brief   LocalLine
+     * @details Claims the calling thread's LineStream, emptied, for the lifetime of the object.
+     *          A record formatted while another one is being formatted on the same thread (e.g. from a streamed
+     *          argument's operator<<) gets a stream of its own instead, leaving the outer record untouched
+     */
+    class LocalLine
+    {
+    public:
+        LocalLine()
+        {
+            if (0 == Depth()++)
+            {
+                m_stream = &Shared();
+                m_stream->reset();
+            }
+            else
+            {
+                m_stream = &m_nested.emplace();
+            }
+        }
+
+        ~LocalLine()
+        {
+            --Depth();
+        }
+
+        LocalLine(const LocalLine&) = delete;
+        LocalLine& operator=(const LocalLine&) = delete;
+
+        /**
+         * @brief   stream
+         * @return  Returns the claimed stream
+         */
+        LineStream& stream()
+        {
+            return *m_stream;
+        }
+
+    private:
+        static LineStream& Shared()
+        {
+            thread_local LineStream stream;
+            return stream;
+        }
+
+        static std::size_t& Depth()
+        {
+            thread_local std::size_t depth = 0;
+            return depth;
+        }
+
+        LineStream* m_stream = nullptr;
+        std::optional<LineStream> m_nested = {};
     };
 
     template <typename LoggerType>
     using is_logger = std::enable_if_t<std::is_base_of_v<ILogger, LoggerType> && std::is_default_constructible_v<LoggerType>>;
 
+    /**
+     * @brief   Logger
+     * @details Process-wide logging entry point for LoggerType. It forwards records to its sink, which is a
+     *          LoggerType instance by default, and may be replaced at runtime by any ILogger implementation
+     */
     template <typename LoggerType, typename = is_logger<LoggerType>>
     class Logger
     {
     private:
-        static ILogger* m_logger;
+        static ILogger& DefaultSink()
+        {
+            // Thread-safe initialization guaranteed by the standard
+            static LoggerType logger;
+            return logger;
+        }
+
+        static std::atomic<ILogger*>& Sink()
+        {
+            // nullptr stands for the default sink, only created once used
+            static std::atomic<ILogger*> sink{ nullptr };
+            return sink;
+        }
+
+        static std::atomic<LogLevel>& Level()
+        {
+            static std::atomic<LogLevel> level{ eDebug };
+            return level;
+        }
 
     public:
+        /**
+         * @brief   GetInstance
+         * @return  Returns the current sink, creating the default one if no sink is installed
+         */
         static ILogger* GetInstance()
         {
-            if (m_logger != nullptr) return m_logger;
-            return new LoggerType();
+            auto sink = Sink().load(std::memory_order_acquire);
+            return sink != nullptr ? sink : &DefaultSink();
+        }
+
+        /**
+         * @brief   SetSink
+         * @details Installs the provided sink, or restores the default one if nullptr. The default sink is not created by this call.
+         *          The sink is not owned and must outlive its installation, including pending log calls from other threads
+         * @return  Returns the previously installed sink, nullptr if it was the default one
+         */
+        static ILogger* SetSink(ILogger* sink)
+        {
+            return Sink().exchange(sink, std::memory_order_acq_rel);
+        }
+
+        /**
+         * @brief   SetLevel
+         * @details Sets the runtime minimum level. Records below this level are discarded before being formatted
+         */
+        static void SetLevel(LogLevel level)
+        {
+            Level().store(level, std::memory_order_relaxed);
+        }
+
+        static LogLevel GetLevel()
+        {
+            return Level().load(std::memory_order_relaxed);
         }
-    };
 
-    template <typename LoggerType, typename Tag>
-    ILogger* Logger<LoggerType, Tag>::m_logger = nullptr;
+        static bool IsEnabled(LogLevel level)
+        {
+            return level >= GetLevel();
+        }
+    };
 
     struct EmptyLogger : ILogger
     {
-        void writeLog(const std::string& module, LogLevel level, const std::string& msg) override {}
+        using ILogger::writeLog;
+
+        void writeLog(std::string_view module, LogLevel level, std::string_view msg) override {}
     };
 
+    /**
+     * @brief   is_enabled_v
+     * @details Whether the provided logger type may output anything at all. Log points using a disabled logger compile to nothing
+     */
+    template <typename LoggerType>
+    inline constexpr bool is_enabled_v = !std::is_same_v<LoggerType, EmptyLogger>;
+
     struct ConsoleLogger : ILogger
     {
-        void writeLog(const std::string& module, LogLevel level, const std::string& msg) override
+        using ILogger::writeLog;
+
+        void writeLog(std::string_view module, LogLevel level, std::string_view msg) override
         {
             std::cout << module << LevelToStr(level) << msg << std::endl;
         }
     };
+
+    /**
+     * @brief   TracePoint
+     * @details State machine trace points, recorded as raw identifiers rather than formatted text
+     */
+    enum class TracePoint : std::uint8_t
+    {
+        Entry = 0,  // State entered
+        Exit,       // State exited
+        Dispatch,   // Event processed by the state machine
+        Post,       // Event posted from within a state
+        Defer       // Event deferred
+    };
+
+    inline const char* TracePointToStr(TracePoint point)
+    {
+        switch (point)
+        {
+            case TracePoint::Entry:
+                return "Entry";
+            case TracePoint::Exit:
+                return "Exit";
+            case TracePoint::Dispatch:
+                return "Dispatch";
+            case TracePoint::Post:
+                return "Post";
+            case TracePoint::Defer:
+                return "Defer";
+            default:
+                break;
+        }
+
+        return "Unknown";
+    }
+
+    /**
+     * @brief   InvalidTraceId
+     * @details Identifier used when a trace point has no event (e.g. a state entered at start)
+     */
+    inline constexpr std::uint32_t InvalidTraceId = 0xFFFFFFFF;
+
+    struct ITracer
+    {
+        virtual ~ITracer() = default;
+
+        /**
+         * @brief       trace
+         * @param[in]   point: the trace point
+         * @param[in]   stateId: dense process-wide identifier of the state's type
+         * @param[in]   stateName: the state's name
+         * @param[in]   region: the state's region index
+         * @param[in]   eventId: dense process-wide identifier of the event's type, or InvalidTraceId
+         * @param[in]   eventName: the event's name
+         * @details     Records a trace point. Names are provided so that implementations may record them once per identifier.
+         *              The provided views are only valid for the duration of the call
+         */
+        virtual void trace(TracePoint point, std::uint32_t stateId, std::string_view stateName, int region, std::uint32_t eventId, std::string_view eventName) = 0;
+    };
+
+    template <typename TracerType>
+    using is_tracer = std::enable_if_t<std::is_base_of_v<ITracer, TracerType> && std::is_default_constructible_v<TracerType>>;
+
+    /**
+     * @brief   Tracer
+     * @details Process-wide tracing entry point for TracerType. It forwards trace points to its sink, which is a
+     *          TracerType instance by default, and may be replaced at runtime by any ITracer implementation
+     */
+    template <typename TracerType, typename = is_tracer<TracerType>>
+    class Tracer
+    {
+    private:
+        static ITracer& DefaultSink()
+        {
+            // Thread-safe initialization guaranteed by the standard
+            static TracerType tracer;
+            return tracer;
+        }
+
+        static std::atomic<ITracer*>& Sink()
+        {
+            // nullptr stands for the default sink, only created once used
+            static std::atomic<ITracer*> sink{ nullptr };
+            return sink;
+        }
+
+    public:
+        /**
+         * @brief   GetInstance
+         * @return  Returns the current sink, creating the default one if no sink is installed
+         */
+        static ITracer* GetInstance()
+        {
+            auto sink = Sink().load(std::memory_order_acquire);
+            return sink != nullptr ? sink : &DefaultSink();
+        }
+
+        /**
+         * @brief   SetSink
+         * @details Installs the provided sink, or restores the default one if nullptr. The default sink is not created by this call.
+         *          The sink is not owned and must outlive its installation, including pending trace calls from other threads
+         * @return  Returns the previously installed sink, nullptr if it was the default one
+         */
+        static ITracer* SetSink(ITracer* sink)
+        {
+            return Sink().exchange(sink, std::memory_order_acq_rel);
+        }
+    };
+
+    struct EmptyTracer : ITracer
+    {
+        void trace(TracePoint point, std::uint32_t stateId, std::string_view stateName, int region, std::uint32_t eventId, std::string_view eventName) override {}
+    };
+
+    /**
+     * @brief   is_tracer_enabled_v
+     * @details Whether the provided tracer type may record anything at all. Trace points using a disabled tracer compile to nothing
+     */
+    template <typename TracerType>
+    inline constexpr bool is_tracer_enabled_v = !std::is_same_v<TracerType, EmptyTracer>;
 }
 
 #endif
@@ -0,0 +1,168 @@
+#ifndef DSM_REGION_POOL_INCLUDED_
+#define DSM_REGION_POOL_INCLUDED_
+
+#include "dsm.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dsm
+{
+    /**
+     * @brief   RegionPool
+     * @details Region scheduler running the independent regions of a state on a pool of helper threads, along with the calling thread.
+     *          Helpers sleep between runs. Each region is claimed by the first thread to get to it, the calling thread returning
+     *          once all of them completed. A pool runs the regions of one state machine at a time: the regions of another one
+     *          meanwhile run one after another on its calling thread
+     */
+    class RegionPool : public IRegionScheduler
+    {
+    public:
+        /**
+         * @brief       RegionPool
+         * @param[in]   helpers: number of helper threads, the hardware concurrency minus the calling thread by default
+         */
+        explicit RegionPool(std::size_t helpers = std::max(1u, std::thread::hardware_concurrency()) - 1)
+        {
+            for (std::size_t index = 0; index < helpers; ++index) m_helpers.emplace_back([this]() { help(); });
+        }
+
+        RegionPool(const RegionPool&) = delete;
+        RegionPool& operator=(const RegionPool&) = delete;
+
+        ~RegionPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock{ m_mutex };
+                m_stopping = true;
+            }
+
+            m_wakeUp.notify_all();
+            for (auto& helper : m_helpers) helper.join();
+        }
+
+        /**
+         * @brief       run
+         * @param[in]   count: number of tasks
+         * @param[in]   task: the task, called with each index in [0, count)
+         * @param[in]   context: the task's context
+         * @details     Runs the tasks on the helpers and the calling thread, and returns once all of them completed
+         */
+        void run(std::size_t count, TTask task, void* context) override
+        {
+            if (true == m_helpers.empty() || count < 2 || true == m_busy.exchange(true, std::memory_order_acquire))
+            {
+                for (std::size_t index = 0; index < count; ++index) task(context, index);
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock{ m_mutex };
+                m_task = task;
+                m_context = context;
+                m_count = count;
+                m_next.store(0, std::memory_order_relaxed);
+                m_remaining.store(count, std::memory_order_relaxed);
+                ++m_generation;
+            }
+
+            m_wakeUp.notify_all();
+
+            work(task, context, count);
+
+            {
+                // Helpers having joined the run are waited for, so that none of them claims a task of the next run
+                std::unique_lock<std::mutex> lock{ m_mutex };
+                m_done.wait(lock, [this]() { return 0 == m_remaining.load(std::memory_order_acquire) && 0 == m_active; });
+                m_task = nullptr;
+            }
+
+            m_busy.store(false, std::memory_order_release);
+        }
+
+        std::size_t helpers() const
+        {
+            return m_helpers.size();
+        }
+
+    private:
+        void work(TTask task, void* context, std::size_t count)
+        {
+            for (auto index = m_next.fetch_add(1, std::memory_order_relaxed); index < count; index = m_next.fetch_add(1, std::memory_order_relaxed))
+            {
+                task(context, index);
+                m_remaining.fetch_sub(1, std::memory_order_acq_rel);
+            }
+        }
+
+        void help()
+        {
+            std::uint64_t generation = 0;
+            std::unique_lock<std::mutex> lock{ m_mutex };
+
+            while (true)
+            {
+                m_wakeUp.wait(lock, [this, &generation]() { return true == m_stopping || (m_task != nullptr && generation != m_generation); });
+                if (true == m_stopping) return;
+
+                generation = m_generation;
+                const auto task = m_task;
+                const auto context = m_context;
+                const auto count = m_count;
+                ++m_active;
+
+                lock.unlock();
+                work(task, context, count);
+                lock.lock();
+
+                if (0 == --m_active && 0 == m_remaining.load(std::memory_order_acquire)) m_done.notify_one();
+            }
+        }
+
+        std::vector<std::thread> m_helpers;
+
+        /**
+         * @brief   m_busy
+         * @details Whether the pool is running the regions of a state machine
+         */
+        std::atomic<bool> m_busy{ false };
+
+        /**
+         * @brief   m_next
+         * @details Next task to claim
+         */
+        std::atomic<std::size_t> m_next{ 0 };
+
+        /**
+         * @brief   m_remaining
+         * @details Number of tasks not completed yet
+         */
+        std::atomic<std::size_t> m_remaining{ 0 };
+
+        std::mutex m_mutex;
+        std::condition_variable m_wakeUp;
+        std::condition_variable m_done;
+
+        // Current run, guarded by m_mutex
+        TTask m_task = nullptr;
+        void* m_context = nullptr;
+        std::size_t m_count = 0;
+        std::uint64_t m_generation = 0;
+
+        /**
+         * @brief   m_active
+         * @details Number of helpers having joined the current run, guarded by m_mutex
+         */
+        std::size_t m_active = 0;
+
+        bool m_stopping = false;
+    };
+}
+
+#endif
@@ -0,0 +1,603 @@
+#ifndef DSM_SHARDS_INCLUDED_
+#define DSM_SHARDS_INCLUDED_
+
+#include "dsm.hpp"
+#include "inbox.hpp"
+#include "bounded_queue.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+namespace dsm
+{
+    namespace details
+    {
+        /**
+         * @brief   Delivery
+         * @details Event posted to a state machine of a shard
+         */
+        struct Delivery
+        {
+            using TProcessFunc = void(*)(void* machine, const dsm::EventBase& evt);
+
+            void* m_machine = nullptr;
+            TProcessFunc m_process = nullptr;
+            EventEnvelope m_evt;
+        };
+
+        /**
+         * @brief   SpscRing
+         * @details Preallocated single-producer single-consumer ring buffer. Each side caches the other side's position,
+         *          so that it only reads the shared one when the ring looks full, or empty
+         */
+        template <typename Type>
+        class SpscRing
+        {
+        public:
+            explicit SpscRing(std::size_t capacity)
+                : m_capacity{ RoundUp(capacity) }
+                , m_mask{ m_capacity - 1 }
+                , m_slots{ new Type[m_capacity] }
+            {}
+
+            SpscRing(const SpscRing&) = delete;
+            SpscRing& operator=(const SpscRing&) = delete;
+
+            /**
+             * @brief       push
+             * @param[in]   value: the value to move into the ring, left untouched if full
+             * @return      true if pushed, false if full. Called by the producer only
+             */
+            bool push(Type& value)
+            {
+                const auto tail = m_tail.load(std::memory_order_relaxed);
+                if (tail - m_cachedHead == m_capacity)
+                {
+                    m_cachedHead = m_head.load(std::memory_order_acquire);
+                    if (tail - m_cachedHead == m_capacity) return false;
+                }
+
+                m_slots[tail & m_mask] = std::move(value);
+                m_tail.store(tail + 1, std::memory_order_release);
+                return true;
+            }
+
+            /**
+             * @brief       pop
+             * @param[out]  value: the popped value
+             * @return      true if popped, false if empty. Called by the consumer only
+             */
+            bool pop(Type& value)
+            {
+                const auto head = m_head.load(std::memory_order_relaxed);
+                if (head == m_cachedTail)
+                {
+                    m_cachedTail = m_tail.load(std::memory_order_acquire);
+                    if (head == m_cachedTail) return false;
+                }
+
+                value = std::move(m_slots[head & m_mask]);
+                m_head.store(head + 1, std::memory_order_release);
+                return true;
+            }
+
+            /**
+             * @brief   empty
+             * @return  true if nothing is pushed, false otherwise. Called by the consumer only
+             */
+            bool empty() const
+            {
+                return m_head.load(std::memory_order_relaxed) == m_tail.load(std::memory_order_seq_cst);
+            }
+
+            /**
+             * @brief   full
+             * @return  true if no value may be pushed, false otherwise. Called by the producer only
+             */
+            bool full() const
+            {
+                return m_tail.load(std::memory_order_relaxed) - m_head.load(std::memory_order_seq_cst) == m_capacity;
+            }
+
+            /**
+             * @brief   wantRoom
+             * @details Asks the consumer to report its next pops through roomWanted. Called by the producer only
+             */
+            void wantRoom()
+            {
+                m_roomWanted.store(true, std::memory_order_seq_cst);
+            }
+
+            /**
+             * @brief   roomWanted
+             * @return  true, once, if the producer asked for room since the last call. Called by the consumer only, after popping
+             */
+            bool roomWanted()
+            {
+                // Pairs with the producer's check of fullness after wantRoom
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                return true == m_roomWanted.load(std::memory_order_relaxed) && true == m_roomWanted.exchange(false, std::memory_order_relaxed);
+            }
+
+        private:
+            const std::size_t m_capacity;
+            const std::size_t m_mask;
+            std::unique_ptr<Type[]> m_slots;
+
+            alignas(64) std::atomic<std::size_t> m_head{ 0 };
+            std::size_t m_cachedTail = 0;
+            std::atomic<bool> m_roomWanted{ false };
+
+            alignas(64) std::atomic<std::size_t> m_tail{ 0 };
+            std::size_t m_cachedHead = 0;
+        };
+    }
+
+    /**
+     * @brief   Endpoint
+     * @details State machine, or instance, attached to a shard of a ShardedRuntime
+     */
+    struct Endpoint
+    {
+        std::size_t shard = 0;
+        void* machine = nullptr;
+        details::Delivery::TProcessFunc process = nullptr;
+    };
+
+    /**
+     * @brief   ShardedRuntime
+     * @details Thread-per-core runtime: each shard runs on its own thread, pinned to one CPU, and processes the events posted to the
+     *          state machines attached to it. Posting:
+     *          - from a shard to one of its own state machines goes through the shard's local queue, without any lock nor atomic read-modify-write
+     *          - from a shard to another one goes through the preallocated SPSC ring buffer dedicated to that pair of shards.
+     *            Events not fitting are kept by the posting shard, in order, until the ring buffer frees up. A sleeping shard
+     *            is woken up by the destination once it frees room
+     *          - from any other thread goes through the target shard's mutex-protected ingress queue
+     *          Events from a same source to a same state machine are processed in posting order. A state machine, or an instance, shall be attached
+     *          to a single shard, and shall only be run by it once attached. Instances of a shared topology may be attached to different shards
+     */
+    class ShardedRuntime
+    {
+    public:
+        static constexpr std::size_t DefaultCapacity = 1024;
+
+        /**
+         * @brief       ShardedRuntime
+         * @param[in]   shards: number of shards, the hardware concurrency by default
+         * @param[in]   capacity: number of events each cross-shard ring buffer can hold, rounded up to a power of two
+         * @param[in]   policy: behavior of idle shards, either sleeping or busy polling
+         * @param[in]   pin: whether each shard's thread is pinned to a CPU, shard i running on CPU i modulo the hardware concurrency
+         */
+        explicit ShardedRuntime(std::size_t shards = std::max(1u, std::thread::hardware_concurrency()), std::size_t capacity = DefaultCapacity,
+            WaitPolicy policy = WaitPolicy::BusyPoll, bool pin = true)
+            : m_policy{ policy }
+        {
+            shards = std::max<std::size_t>(1, shards);
+            for (std::size_t index = 0; index < shards; ++index) m_shards.push_back(std::make_unique<Shard>(*this, index, shards, capacity));
+            for (auto& shard : m_shards) shard->m_thread = std::thread{ [this, &shard, pin]() { run(*shard, pin); } };
+        }
+
+        ShardedRuntime(const ShardedRuntime&) = delete;
+        ShardedRuntime& operator=(const ShardedRuntime&) = delete;
+
+        /**
+         * @brief   ~ShardedRuntime
+         * @details Stops the shards. Events not processed yet are discarded
+         */
+        ~ShardedRuntime()
+        {
+            m_running.store(false, std::memory_order_seq_cst);
+            for (auto& shard : m_shards) shard->wakeUp();
+            for (auto& shard : m_shards)
+            {
+                if (shard->m_thread.joinable()) shard->m_thread.join();
+            }
+        }
+
+        /**
+         * @brief       attach
+         * @param[in]   machine: the state machine, or instance, to run
+         * @param[in]   shard: the shard running it
+         * @return      Returns the endpoint to post events to
+         */
+        template <typename MachineType>
+        Endpoint attach(MachineType& machine, std::size_t shard)
+        {
+            return Endpoint{ shard % m_shards.size(), &machine, &Process<MachineType> };
+        }
+
+        /**
+         * @brief       postEvent
+         * @param[in]   target: the state machine's endpoint
+         * @param[in]   evt: the event to post, copied into the runtime
+         * @details     Posts the provided event from any thread, including from within a state machine run by a shard
+         */
+        template <typename EventType>
+        void postEvent(const Endpoint& target, const EventType& evt)
+        {
+            static_assert(details::is_event_v<EventType>, "EventType must inherit from Event");
+
+            details::Delivery delivery;
+            delivery.m_evt.emplace(evt);
+            delivery.m_machine = target.machine;
+            delivery.m_process = target.process;
+
+            auto& destination = *m_shards[target.shard];
+            Shard* source = Current();
+
+            if (nullptr == source || &source->m_runtime != this)
+            {
+                m_externalPosted.fetch_add(1, std::memory_order_relaxed);
+                destination.inject(std::move(delivery));
+                return;
+            }
+
+            source->m_posted.store(source->m_posted.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+            if (source == &destination)
+            {
+                source->m_local.emplace(std::move(delivery));
+                return;
+            }
+
+            // Keeps the posting order behind events waiting for room
+            auto& overflow = source->m_overflow[target.shard];
+            if (false == overflow.empty() || false == destination.m_mailboxes[source->m_index]->push(delivery))
+            {
+                overflow.emplace(std::move(delivery));
+                return;
+            }
+
+            if (WaitPolicy::Block == m_policy) destination.notify();
+        }
+
+        /**
+         * @brief   wait
+         * @details Blocks until every event posted so far, and those they posted meanwhile, has been processed.
+         *          Woken up by the shard running out of events once the counts add up. Shall not be called from a shard
+         */
+        void wait() const
+        {
+            std::unique_lock<std::mutex> lock{ m_waitMutex };
+            m_waiters.fetch_add(1, std::memory_order_seq_cst);
+            m_waitCv.wait(lock, [this]() { return true == done(); });
+            m_waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        std::size_t shards() const
+        {
+            return m_shards.size();
+        }
+
+        /**
+         * @brief       pinned
+         * @param[in]   shard: the shard's index
+         * @return      true if the shard's thread is pinned to a CPU, false otherwise
+         */
+        bool pinned(std::size_t shard) const
+        {
+            return m_shards[shard]->m_pinned.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @brief       processed
+         * @param[in]   shard: the shard's index
+         * @return      Returns the number of events processed by the shard
+         */
+        std::uint64_t processed(std::size_t shard) const
+        {
+            return m_shards[shard]->m_processed.load(std::memory_order_relaxed);
+        }
+
+    private:
+        /**
+         * @brief   Shard
+         * @details Shard thread along with its queues. Counters are only written by the shard itself
+         */
+        struct Shard
+        {
+            Shard(ShardedRuntime& runtime, std::size_t index, std::size_t shards, std::size_t capacity)
+                : m_runtime{ runtime }
+                , m_index{ index }
+                , m_overflow(shards)
+            {
+                for (std::size_t source = 0; source < shards; ++source)
+                {
+                    // No mailbox from a shard to itself
+                    m_mailboxes.push_back(source != index ? std::make_unique<details::SpscRing<details::Delivery>>(capacity) : nullptr);
+                }
+            }
+
+            void inject(details::Delivery&& delivery)
+            {
+                {
+                    std::lock_guard<std::mutex> lock{ m_mutex };
+                    m_ingress.push_back(std::move(delivery));
+                    m_injected.store(true, std::memory_order_seq_cst);
+                }
+                m_cv.notify_one();
+            }
+
+            /**
+             * @brief   notify
+             * @details Wakes up the shard if it sleeps. Called by the producer right after pushing into one of the shard's mailboxes
+             */
+            void notify()
+            {
+                // Pairs with run: either the shard sees the pushed event before sleeping, or the producer sees it sleeping
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (true == m_sleeping.load(std::memory_order_seq_cst)) wakeUp();
+            }
+
+            void wakeUp()
+            {
+                std::lock_guard<std::mutex> lock{ m_mutex };
+                m_cv.notify_one();
+            }
+
+            ShardedRuntime& m_runtime;
+            const std::size_t m_index;
+            std::thread m_thread;
+            std::atomic<bool> m_pinned{ false };
+
+            /**
+             * @brief   m_local
+             * @details Events posted by the shard to its own state machines
+             */
+            details::RingQueue<details::Delivery> m_local;
+
+            /**
+             * @brief   m_mailboxes
+             * @details Events posted by the other shards, indexed by source shard
+             */
+            std::vector<std::unique_ptr<details::SpscRing<details::Delivery>>> m_mailboxes;
+
+            /**
+             * @brief   m_overflow
+             * @details Events posted by the shard that did not fit into their destination's mailbox yet, indexed by destination shard
+             */
+            std::vector<details::RingQueue<details::Delivery>> m_overflow;
+
+            /**
+             * @brief   m_ingress
+             * @details Events posted by threads that are not shards
+             */
+            std::vector<details::Delivery> m_ingress;
+            std::vector<details::Delivery> m_draining;
+            std::atomic<bool> m_injected{ false };
+
+            alignas(64) std::atomic<std::uint64_t> m_posted{ 0 };
+            std::atomic<std::uint64_t> m_processed{ 0 };
+
+            std::atomic<bool> m_sleeping{ false };
+            std::mutex m_mutex;
+            std::condition_variable m_cv;
+        };
+
+        template <typename MachineType>
+        static void Process(void* machine, const EventBase& evt)
+        {
+            static_cast<MachineType*>(machine)->processEvent(evt);
+        }
+
+        /**
+         * @brief   Current
+         * @return  Returns the shard running on the calling thread, if any
+         */
+        static Shard*& Current()
+        {
+            thread_local Shard* shard = nullptr;
+            return shard;
+        }
+
+        /**
+         * @brief       Pin
+         * @param[in]   cpu: the CPU to run the calling thread on
+         * @return      true if pinned, false if not supported or refused
+         */
+        static bool Pin(std::size_t cpu)
+        {
+#if defined(__linux__)
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            return 0 == pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#elif defined(_WIN32)
+            return 0 != SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR{ 1 } << (cpu % (8 * sizeof(DWORD_PTR))));
+#else
+            (void)cpu;
+            return false;
+#endif
+        }
+
+        void deliver(Shard& shard, details::Delivery& delivery)
+        {
+            delivery.m_process(delivery.m_machine, *delivery.m_evt.get());
+            delivery.m_evt.reset();
+            shard.m_processed.store(shard.m_processed.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        /**
+         * @brief       poll
+         * @param[in]   shard: the calling shard
+         * @details     Processes the events of the local queue, mailboxes and ingress queue, then moves waiting events into their mailbox
+         * @return      Returns the number of processed events
+         */
+        std::size_t poll(Shard& shard)
+        {
+            std::size_t count = 0;
+            details::Delivery delivery;
+
+            // Events posted meanwhile are processed on the next poll
+            for (auto pending = shard.m_local.size(); pending > 0; --pending, ++count)
+            {
+                delivery = shard.m_local.pop();
+                deliver(shard, delivery);
+            }
+
+            for (auto& mailbox : shard.m_mailboxes)
+            {
+                if (nullptr == mailbox) continue;
+                for (std::size_t budget = DefaultCapacity; budget > 0 && true == mailbox->pop(delivery); --budget, ++count) deliver(shard, delivery);
+            }
+
+            if (true == shard.m_injected.load(std::memory_order_acquire))
+            {
+                {
+                    std::lock_guard<std::mutex> lock{ shard.m_mutex };
+                    std::swap(shard.m_ingress, shard.m_draining);
+                    shard.m_injected.store(false, std::memory_order_relaxed);
+                }
+
+                for (auto& injected : shard.m_draining) deliver(shard, injected);
+                count += shard.m_draining.size();
+                shard.m_draining.clear();
+            }
+
+            for (std::size_t source = 0; source < shard.m_mailboxes.size(); ++source)
+            {
+                auto& mailbox = shard.m_mailboxes[source];
+                if (mailbox != nullptr && WaitPolicy::Block == m_policy && true == mailbox->roomWanted()) m_shards[source]->notify();
+            }
+
+            for (std::size_t destination = 0; destination < m_shards.size(); ++destination)
+            {
+                auto& overflow = shard.m_overflow[destination];
+                if (true == overflow.empty()) continue;
+
+                auto& mailbox = *m_shards[destination]->m_mailboxes[shard.m_index];
+                const auto waiting = overflow.size();
+                while (false == overflow.empty() && true == mailbox.push(overflow.front())) overflow.pop();
+
+                if (WaitPolicy::Block == m_policy)
+                {
+                    if (overflow.size() < waiting) m_shards[destination]->notify();
+                    // The destination wakes the shard up once it frees room
+                    if (false == overflow.empty()) mailbox.wantRoom();
+                }
+            }
+
+            return count;
+        }
+
+        /**
+         * @brief       idle
+         * @param[in]   shard: the calling shard
+         * @return      true if the shard has nothing to process, nor to move into a mailbox with room, false otherwise
+         */
+        bool idle(const Shard& shard) const
+        {
+            if (false == shard.m_local.empty() || true == shard.m_injected.load(std::memory_order_seq_cst)) return false;
+            for (const auto& mailbox : shard.m_mailboxes)
+            {
+                if (mailbox != nullptr && false == mailbox->empty()) return false;
+            }
+            for (std::size_t destination = 0; destination < m_shards.size(); ++destination)
+            {
+                if (false == shard.m_overflow[destination].empty() && false == m_shards[destination]->m_mailboxes[shard.m_index]->full()) return false;
+            }
+            return true;
+        }
+
+        /**
+         * @brief   done
+         * @details Adds up the events processed by every shard, then those posted. Events are counted as posted before being
+         *          processed, and as processed once the events they posted are counted, hence both sums are equal only if
+         *          no event is left to process
+         * @return  true if every posted event has been processed
+         */
+        bool done() const
+        {
+            std::uint64_t processed = 0;
+            for (const auto& shard : m_shards) processed += shard->m_processed.load(std::memory_order_seq_cst);
+
+            std::uint64_t posted = m_externalPosted.load(std::memory_order_seq_cst);
+            for (const auto& shard : m_shards) posted += shard->m_posted.load(std::memory_order_seq_cst);
+
+            return posted == processed;
+        }
+
+        /**
+         * @brief   notifyWaiters
+         * @details Wakes up the threads waiting for every event to be processed, if so. Called by a shard running out of events
+         */
+        void notifyWaiters() const
+        {
+            // Pairs with wait: either the waiter sees the events processed so far, or the shard sees it waiting
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (0 == m_waiters.load(std::memory_order_relaxed) || false == done()) return;
+
+            std::lock_guard<std::mutex> lock{ m_waitMutex };
+            m_waitCv.notify_all();
+        }
+
+        /**
+         * @brief       run
+         * @param[in]   shard: the shard
+         * @param[in]   pin: whether to pin the shard's thread
+         * @details     Shard thread: polls its queues, sleeping or busy polling when idle, until the runtime stops
+         */
+        void run(Shard& shard, bool pin)
+        {
+            Current() = &shard;
+            if (true == pin) shard.m_pinned.store(Pin(shard.m_index % std::max(1u, std::thread::hardware_concurrency())), std::memory_order_release);
+
+            while (true == m_running.load(std::memory_order_acquire))
+            {
+                if (poll(shard) > 0) continue;
+
+                notifyWaiters();
+
+                if (WaitPolicy::BusyPoll == m_policy)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock{ shard.m_mutex };
+                shard.m_sleeping.store(true, std::memory_order_seq_cst);
+                // Producers fence their push against the sleeping flag: the timed wait is a safety net only
+                shard.m_cv.wait_for(lock, std::chrono::milliseconds(1), [this, &shard]() {
+                    return false == m_running.load(std::memory_order_seq_cst) || false == idle(shard);
+                });
+                shard.m_sleeping.store(false, std::memory_order_relaxed);
+            }
+
+            Current() = nullptr;
+        }
+
+        const WaitPolicy m_policy;
+        std::vector<std::unique_ptr<Shard>> m_shards;
+
+        /**
+         * @brief   m_externalPosted
+         * @details Number of events posted by threads that are not shards
+         */
+        alignas(64) std::atomic<std::uint64_t> m_externalPosted{ 0 };
+        std::atomic<bool> m_running{ true };
+
+        mutable std::atomic<std::size_t> m_waiters{ 0 };
+        mutable std::mutex m_waitMutex;
+        mutable std::condition_variable m_waitCv;
+    };
+}
+
+#endif
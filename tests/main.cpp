@@ -1,4 +1,20 @@
+#include "dsm/log.hpp"
+
+// Enables trace points, which are discarded unless a test installs its own sink
+struct TestTracer : Log::ITracer
+{
+    void trace(Log::TracePoint point, std::uint32_t stateId, std::string_view stateName, int region, std::uint32_t eventId, std::string_view eventName) override {}
+};
+
+#define DSM_TRACER TestTracer
+
 #include "dsm/dsm.hpp"
+#include "dsm/async_logger.hpp"
+#include "dsm/binary_tracer.hpp"
+#include "dsm/inbox.hpp"
+#include "dsm/executor.hpp"
+#include "dsm/shards.hpp"
+#include "dsm/region_pool.hpp"
 
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
@@ -10,6 +26,9 @@ using ::testing::InvokeWithoutArgs;
 
 #include <string>
 #include <stdexcept>
+#include <fstream>
+#include <random>
+#include <thread>
 
 using namespace dsm;
 
@@ -52,6 +71,7 @@ struct s1 : State<s1, sm>
     MOCK_METHOD(void, onError, (std::exception_ptr));
     MOCK_METHOD(TStates, getStates, ());
     MOCK_METHOD(TTransitions, getTransitions, ());
+    MOCK_METHOD(TDeferredEvents, getDeferredEvents, ());
     MOCK_METHOD(void, onEvent1, (const e1&));
 };
 
@@ -97,6 +117,137 @@ struct s8 : State<s8, sm>
 {
 };
 
+struct FlatStore
+{
+    std::string log;
+    std::size_t guards = 0;
+};
+
+struct flat_sm : StateMachine<flat_sm, FlatStore> {};
+
+// Records its entry, exit, guard and action calls. Guards fail once in three calls
+template <int Index>
+struct flat_state : State<flat_state<Index>, flat_sm>
+{
+    void onEntry() override { this->store()->log += " +" + std::to_string(Index); }
+    void onExit() override { this->store()->log += " -" + std::to_string(Index); }
+
+    template <typename EventType>
+    bool guard(const EventType&)
+    {
+        this->store()->log += " ?" + std::to_string(Index);
+        return 0 != ++this->store()->guards % 3;
+    }
+
+    template <typename EventType>
+    void action(const EventType&) { this->store()->log += " !" + std::to_string(Index); }
+};
+
+struct numbered : Event<numbered>
+{
+    numbered(std::size_t producer, std::size_t number) : producer{ producer }, number{ number } {}
+
+    std::size_t producer;
+    std::size_t number;
+};
+
+struct InboxStore
+{
+    std::vector<std::size_t> next;
+    std::size_t outOfOrder = 0;
+    std::size_t processed = 0;
+};
+
+struct inbox_sm : StateMachine<inbox_sm, InboxStore> {};
+
+// Checks that the events of each producer come in posting order
+struct inbox_state : State<inbox_state, inbox_sm>
+{
+    void onNumbered(const numbered& evt)
+    {
+        auto& next = this->store()->next;
+        if (evt.producer >= next.size()) next.resize(evt.producer + 1, 0);
+        if (evt.number != next[evt.producer]) ++this->store()->outOfOrder;
+        next[evt.producer] = evt.number + 1;
+        ++this->store()->processed;
+    }
+};
+
+struct relayed : Event<relayed>
+{
+    explicit relayed(std::size_t remaining) : remaining{ remaining } {}
+
+    std::size_t remaining;
+};
+
+struct RelayStore
+{
+    ShardedRuntime* runtime = nullptr;
+    Endpoint next;
+    std::size_t processed = 0;
+};
+
+struct relay_sm : StateMachine<relay_sm, RelayStore> {};
+
+// Relays the event to the next state machine until it runs out
+struct relay_state : State<relay_state, relay_sm>
+{
+    void onRelayed(const relayed& evt)
+    {
+        ++this->store()->processed;
+        if (evt.remaining > 0) this->store()->runtime->postEvent(this->store()->next, relayed{ evt.remaining - 1 });
+    }
+};
+
+struct tick : Event<tick> {};
+struct shutdown : Event<shutdown> {};
+
+struct region_done : Event<region_done>
+{
+    explicit region_done(int region) : region{ region } {}
+
+    int region;
+};
+
+struct DeviceStore
+{
+    // Whether the first four regions wait for each other when ticked, which only succeeds once they run concurrently
+    bool meet = false;
+    std::atomic<int> arrived{ 0 };
+    std::atomic<int> met{ 0 };
+    std::vector<int> done;
+};
+
+struct device_sm : StateMachine<device_sm, DeviceStore> {};
+
+struct device : State<device, device_sm>
+{
+    void onDone(const region_done& evt) { this->store()->done.push_back(evt.region); }
+};
+
+struct off : State<off, device_sm> {};
+
+template <int Index>
+struct idle : State<idle<Index>, device_sm>
+{
+    void onTick(const tick&)
+    {
+        auto store = this->store();
+        if (true == store->meet && Index < 4)
+        {
+            ++store->arrived;
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{ 5 };
+            while (store->arrived.load() < 4 && std::chrono::steady_clock::now() < deadline) std::this_thread::yield();
+            if (store->arrived.load() >= 4) ++store->met;
+        }
+
+        this->postEvent(region_done{ Index });
+    }
+};
+
+template <int Index>
+struct busy : State<busy<Index>, device_sm> {};
+
 struct Visitor : IStateVisitor
 {
     std::string searchedState;
@@ -641,6 +792,42 @@ TEST_F(DsmFixture, test_post_event_on_entry)
     ASSERT_TRUE(event1Reached);
 }
 
+TEST_F(DsmFixture, test_process_events)
+{
+    _sm.addState<NiceMock<s0>, Entry>();
+    _sm.addState<NiceMock<s1>>();
+
+    _sm.addTransition<s0, e0, s0, &s0::onEvent0>();
+    _sm.addTransition<s0, e1, s1>();
+    _sm.addTransition<s1, e2, s0>();
+
+    int onEvent0Calls = 0;
+    s0* _s0 = _sm.getState<s0>();
+    ON_CALL(*_s0, onEvent0(_)).WillByDefault(Invoke([&]() { ++onEvent0Calls; return _s0->postEvent(e1{}); }));
+
+    // Not started: ignored
+    const std::vector<e0> batch(3);
+    _sm.processEvents(batch);
+    ASSERT_EQ(0, onEvent0Calls);
+
+    _sm.start();
+
+    // Each event completes, along with the events it posted, before the next one: e2 finds s1 and goes back to s0
+    const e0 first;
+    const e2 second;
+    const std::vector<const EventBase*> mixed{ &first, &second };
+    _sm.processEvents(mixed);
+    ASSERT_EQ(1, onEvent0Calls);
+    ASSERT_TRUE((_sm.checkStates<s0>()));
+    ASSERT_EQ(1u, _sm.queueMetrics().totalPosted);
+
+    // Only the first e0 is handled by s0, the others find s1
+    _sm.processEvents(batch);
+    ASSERT_EQ(2, onEvent0Calls);
+    ASSERT_TRUE((_sm.checkStates<s1>()));
+    ASSERT_EQ(0u, _sm.queueMetrics().posted);
+}
+
 TEST_F(DsmFixture, test_error_on_entry)
 {
     _sm.addState<NiceMock<s0>, Entry>();
@@ -915,53 +1102,1635 @@ TEST_F(DsmFixture, test_defer_event)
     ASSERT_TRUE((_sm.checkStates<s1>()));
 }
 
-TEST_F(DsmFixture, test_sm_visitor)
+TEST_F(DsmFixture, test_queue_metrics)
 {
-    _sm.addState<NiceMock<s0>, Entry>("s0");
-    _sm.addState<s0, NiceMock<s1>, Entry>("s1");
-    _sm.addState<s1, NiceMock<s2>, Entry>("s2");
+    _sm.addState<NiceMock<s0>, Entry>();
+    _sm.addState<NiceMock<s1>>();
+
+    _sm.addTransition<s0, e0, s0, &s0::onEvent0>();
+    _sm.addTransition<s1, e1, s1, &s1::onEvent1>();
+    _sm.addTransition<s0, e2, s1>();
+
+    int onEvent1Calls = 0;
+    s1* _s1 = _sm.getState<s1>();
+    ON_CALL(*_s1, onEvent1(_)).WillByDefault(Invoke([&]() { ++onEvent1Calls; }));
 
     _sm.start();
+    for (int i = 0; i < 3; ++i) _sm.deferEvent(e1{});
 
-    Visitor v{ "s2" };
-    _sm.visit(v);
+    auto metrics = _sm.queueMetrics();
+    ASSERT_EQ(3u, metrics.posted);
+    ASSERT_EQ(0u, metrics.deferred);
+    ASSERT_EQ(3u, metrics.maxPosted);
+    ASSERT_EQ(3u, metrics.totalPosted);
 
-    ASSERT_TRUE(v.found);
-    ASSERT_TRUE((v.states == std::vector<std::string>{ "sm", "s0", "s1", "s2" }));
+    // Not handled yet: moved to the deferred events
+    _sm.processEvent(e0{});
+    metrics = _sm.queueMetrics();
+    ASSERT_EQ(0u, metrics.posted);
+    ASSERT_EQ(3u, metrics.deferred);
+    ASSERT_EQ(3u, metrics.maxDeferred);
+    ASSERT_EQ(3u, metrics.totalDeferred);
+    ASSERT_EQ(0, onEvent1Calls);
+
+    _sm.processEvent(e2{});
+    metrics = _sm.queueMetrics();
+    ASSERT_EQ(0u, metrics.deferred);
+    ASSERT_EQ(3u, metrics.maxDeferred);
+    ASSERT_EQ(3, onEvent1Calls);
+
+    _sm.resetQueueMetrics();
+    metrics = _sm.queueMetrics();
+    ASSERT_EQ(0u, metrics.maxPosted);
+    ASSERT_EQ(0u, metrics.maxDeferred);
+    ASSERT_EQ(0u, metrics.totalPosted);
+    ASSERT_EQ(0u, metrics.totalDeferred);
 }
 
-TEST_F(DsmFixture, test_posted_transition)
+TEST_F(DsmFixture, test_deferred_retry_on_configuration_change)
 {
-    auto _e0 = new e0{};
-    auto _cb = [](const e0&) -> bool { return true; };
-    auto _tr = new details::Transition<e0>{ _cb };
-    details::PostedTransition _ptr1{ _e0, true };
-    details::PostedTransition _ptr2{ _tr, true };
+    _sm.addState<NiceMock<s0>, Entry>();
+    _sm.addState<NiceMock<s6>>();
 
-    ASSERT_NE(nullptr, _ptr1.m_evt);
-    ASSERT_EQ(nullptr, _ptr1.m_transition);
-    ASSERT_TRUE(_ptr1.m_deferred);
-    ASSERT_EQ(nullptr, _ptr2.m_evt);
-    ASSERT_NE(nullptr, _ptr2.m_transition);
-    ASSERT_TRUE(_ptr2.m_deferred);
+    _sm.addTransition<s0, e3, s6>();
+    _sm.addTransition<s6, e3, s0>();
+    _sm.addTransition<s6, e0, s6, &s6::onEvent0>();
+    _sm.addTransition<s6, e1, s6, &s6::onEvent1, &s6::guard>();
+    _sm.addTransition<s6, e2, s6, &s6::onEvent2>();
 
-    details::PostedTransition _ptr3{ std::move(_ptr1) };
-    details::PostedTransition _ptr4;
-    _ptr4 = std::move(_ptr2);
+    int guardCalls = 0;
+    bool allow = false;
+    s6* _s6 = _sm.getState<s6>();
+    ON_CALL(*_s6, guard(_)).WillByDefault(Invoke([&]() { ++guardCalls; return allow; }));
 
-    ASSERT_EQ(nullptr, _ptr1.m_evt);
-    ASSERT_EQ(nullptr, _ptr1.m_transition);
-    ASSERT_FALSE(_ptr1.m_deferred);
-    ASSERT_EQ(nullptr, _ptr2.m_evt);
-    ASSERT_EQ(nullptr, _ptr2.m_transition);
-    ASSERT_FALSE(_ptr2.m_deferred);
+    _sm.start();
+    _sm.processEvent(e3{});
+    ASSERT_TRUE((_sm.checkStates<s6>()));
 
-    ASSERT_NE(nullptr, _ptr3.m_evt);
-    ASSERT_EQ(nullptr, _ptr3.m_transition);
-    ASSERT_TRUE(_ptr3.m_deferred);
-    ASSERT_EQ(nullptr, _ptr4.m_evt);
-    ASSERT_NE(nullptr, _ptr4.m_transition);
-    ASSERT_TRUE(_ptr3.m_deferred);
+    // Rejected on deferral, then on its first try from the run-to-completion queue
+    _sm.deferEvent(e1{});
+    _sm.processEvent(e2{});
+    ASSERT_EQ(2, guardCalls);
+    ASSERT_EQ(1u, _sm.queueMetrics().deferred);
+
+    // Internal transitions don't change the configuration: no retry
+    _sm.processEvent(e2{});
+    _sm.processEvent(e2{});
+    ASSERT_EQ(2, guardCalls);
+
+    // Entering a state handling the deferred event retries it
+    _sm.processEvent(e3{});
+    ASSERT_EQ(2, guardCalls);
+    _sm.processEvent(e3{});
+    ASSERT_EQ(3, guardCalls);
+
+    allow = true;
+    _sm.processEvent(e2{});
+    ASSERT_EQ(3, guardCalls);
+    ASSERT_EQ(1u, _sm.queueMetrics().deferred);
+
+    _sm.processEvent(e3{});
+    EXPECT_CALL(*_s6, onEvent1(_)).Times(1);
+    _sm.processEvent(e3{});
+    ASSERT_EQ(0u, _sm.queueMetrics().deferred);
+    ::testing::Mock::VerifyAndClearExpectations(_s6);
+
+    // Deferred events of different types are retried in deferring order
+    _sm.processEvent(e3{});
+    ASSERT_TRUE((_sm.checkStates<s0>()));
+    _sm.deferEvent(e1{});
+    _sm.deferEvent(e0{});
+    _sm.deferEvent(e1{});
+    _sm.processEvent(e2{});
+    ASSERT_EQ(3u, _sm.queueMetrics().deferred);
+
+    {
+        ::testing::InSequence seq;
+        EXPECT_CALL(*_s6, onEvent1(_)).Times(1);
+        EXPECT_CALL(*_s6, onEvent0(_)).Times(1);
+        EXPECT_CALL(*_s6, onEvent1(_)).Times(1);
+    }
+    _sm.processEvent(e3{});
+    ASSERT_EQ(0u, _sm.queueMetrics().deferred);
+}
+
+TEST_F(DsmFixture, test_deferred_retry_chain)
+{
+    _sm.addState<NiceMock<s0>, Entry>();
+    _sm.addState<NiceMock<s1>>();
+    _sm.addState<NiceMock<s2>>();
+    _sm.addState<NiceMock<s3>>();
+
+    _sm.addTransition<s0, e1, s1>();
+    _sm.addTransition<s1, e2, s2>();
+    _sm.addTransition<s2, e3, s3>();
+
+    _sm.start();
+    _sm.deferEvent(e2{});
+    _sm.deferEvent(e3{});
+    _sm.processEvent(e0{});
+    ASSERT_EQ(2u, _sm.queueMetrics().deferred);
+
+    // e2 retried on entry to s1, then e3 on entry to s2, within the same run-to-completion step
+    _sm.processEvent(e1{});
+    ASSERT_TRUE((_sm.checkStates<s3>()));
+    ASSERT_EQ(0u, _sm.queueMetrics().deferred);
+}
+
+TEST_F(DsmFixture, test_deferred_events_declaration)
+{
+    _sm.addState<NiceMock<s0>, Entry>();
+    _sm.addState<NiceMock<s1>>();
+
+    _sm.addTransition<s0, e0, s1>();
+    _sm.addTransition<s1, e1, s1, &s1::onEvent1>();
+    _sm.addTransition<s1, e2, s0>();
+    _sm.addDeferredEvent<s0, e1>();
+
+    s1* _s1 = _sm.getState<s1>();
+    ON_CALL(*_s1, getDeferredEvents()).WillByDefault(Invoke([&](){ return TDeferredEvents{ _s1->createDeferredEvent<e3>() }; }));
+    _sm.setup();
+
+    _sm.start();
+
+    // Queued without being processed while s0 is active
+    EXPECT_CALL(*_s1, onEvent1(_)).Times(0);
+    _sm.processEvent(e1{});
+    _sm.postEvent(e1{});
+    ASSERT_EQ(2u, _sm.queueMetrics().deferred);
+    ::testing::Mock::VerifyAndClearExpectations(_s1);
+
+    // Released on exit from s0, then handled by s1
+    EXPECT_CALL(*_s1, onEvent1(_)).Times(2);
+    _sm.processEvent(e0{});
+    ASSERT_TRUE((_sm.checkStates<s1>()));
+    ASSERT_EQ(0u, _sm.queueMetrics().deferred);
+    ::testing::Mock::VerifyAndClearExpectations(_s1);
+
+    // Released on exit from s1, then dropped since no state handles it
+    _sm.processEvent(e3{});
+    ASSERT_EQ(1u, _sm.queueMetrics().deferred);
+    _sm.processEvent(e2{});
+    ASSERT_TRUE((_sm.checkStates<s0>()));
+    ASSERT_EQ(0u, _sm.queueMetrics().deferred);
+}
+
+TEST_F(DsmFixture, test_deferred_events_precedence)
+{
+    _sm.addState<NiceMock<s0>, Entry>();
+    _sm.addState<s0, NiceMock<s1>, Entry>();
+    _sm.addState<s0, NiceMock<s2>>();
+    _sm.addState<s0, NiceMock<s4>, 1, Entry>();
+    _sm.addState<s0, NiceMock<s5>, 1>();
+
+    _sm.addTransition<s1, e1, s2>();
+    _sm.addTransition<s2, e0, s1>();
+    _sm.addTransition<s4, e2, s5>();
+    _sm.addDeferredEvent<s0, e1>();
+    _sm.addDeferredEvent<s1, e2>();
+
+    _sm.start();
+
+    // Orthogonal: deferred by s1 in region 0, consumed by s4 in region 1
+    _sm.processEvent(e2{});
+    ASSERT_TRUE((_sm.checkStates<s0, s5>()));
+    ASSERT_EQ(0u, _sm.queueMetrics().deferred);
+
+    // Nested: deferred by s0, consumed by its active sub-state s1
+    _sm.processEvent(e1{});
+    ASSERT_TRUE((_sm.checkStates<s0, s2>()));
+    ASSERT_EQ(0u, _sm.queueMetrics().deferred);
+
+    // Deferred once no active state consumes it, then retried on entry to s1 while s0 still defers it
+    _sm.processEvent(e1{});
+    ASSERT_EQ(1u, _sm.queueMetrics().deferred);
+    _sm.processEvent(e0{});
+    ASSERT_TRUE((_sm.checkStates<s0, s2>()));
+    ASSERT_EQ(0u, _sm.queueMetrics().deferred);
+}
+
+TEST_F(DsmFixture, test_deferred_events_active_handlers)
+{
+    _sm.addState<NiceMock<s0>, Entry>();
+    _sm.addState<s0, NiceMock<s6>, Entry>();
+    _sm.addState<s0, NiceMock<s2>>();
+
+    _sm.addTransition<s6, e1, s6, &s6::guard, s2>();
+    _sm.addDeferredEvent<s0, e1>();
+
+    s6* _s6 = _sm.getState<s6>();
+    EXPECT_CALL(*_s6, guard(_)).Times(2).WillOnce(Return(false)).WillOnce(Return(true));
+
+    _sm.start();
+
+    // Guarded handler active: tried first, deferred once its guard fails
+    _sm.processEvent(e1{});
+    ASSERT_TRUE((_sm.checkStates<s0, s6>()));
+    ASSERT_EQ(1u, _sm.queueMetrics().deferred);
+
+    _sm.processEvent(e1{});
+    ASSERT_TRUE((_sm.checkStates<s0, s2>()));
+    ASSERT_EQ(1u, _sm.queueMetrics().deferred);
+
+    // No active handler: deferred without being processed
+    _sm.processEvent(e1{});
+    ASSERT_TRUE((_sm.checkStates<s0, s2>()));
+    ASSERT_EQ(2u, _sm.queueMetrics().deferred);
+}
+
+TEST_F(DsmFixture, test_deferred_events_declaration_errors)
+{
+    EXPECT_CALL(_sm, onError(_)).Times(3);
+    _sm.addState<NiceMock<s0>, Entry>();
+    _sm.addState<NiceMock<s1>>();
+
+    _sm.addTransition<s0, e0, s1>();
+    _sm.addDeferredEvent<s0, e1>();
+
+    // A state cannot both defer and handle an event
+    _sm.addDeferredEvent<s0, e0>();
+    _sm.addTransition<s0, e1, s1>();
+
+    // Unknown state
+    _sm.addDeferredEvent<s2, e1>();
+
+    s1* _s1 = _sm.getState<s1>();
+    EXPECT_CALL(*_s1, onError(_)).Times(1);
+    ON_CALL(*_s1, getDeferredEvents()).WillByDefault(Invoke([&](){ return TDeferredEvents{ _s1->createDeferredEvent<e2>(), _s1->createDeferredEvent<e2>() }; }));
+    _sm.setup();
+}
+
+TEST_F(DsmFixture, test_state_index)
+{
+    EXPECT_CALL(_sm, onError(_)).Times(1);
+    _sm.addState<NiceMock<s0>, Entry>();
+    _sm.addState<s0, NiceMock<s1>, Entry>();
+    _sm.addState<NiceMock<s2>>();
+    _sm.addState<s2, s3>();
+
+    s0* _s0 = _sm.getState<s0>();
+    s1* _s1 = _sm.getState<s1>();
+    ASSERT_NE(nullptr, _s1);
+    ASSERT_NE(nullptr, (_sm.getState<s3>()));
+    ASSERT_EQ(nullptr, (_sm.getState<s4>()));
+    ASSERT_TRUE(_s0->contains(_s1));
+    ASSERT_FALSE(_s1->contains(_s0));
+    ASSERT_FALSE(_s0->contains(_sm.getState<s3>()));
+
+    // Action state must be an ancestor of the source state
+    _sm.addTransition<s1, e0, s0, &s0::onEvent0>();
+    _sm.addTransition<s3, e0, s0, &s0::onEvent0>();
+    _sm.addTransition<s1, e1, s3>();
+
+    _sm.start();
+    ASSERT_TRUE((_sm.checkStates<s0, s1>()));
+    _sm.processEvent(e1{});
+    ASSERT_TRUE((_sm.checkStates<s2, s3>()));
+    _sm.stop();
+
+    // Cleared states are removed from the index
+    _sm.clear();
+    ASSERT_EQ(nullptr, (_sm.getState<s1>()));
+    ASSERT_EQ(nullptr, (_sm.getState<s3>()));
+
+    _sm.addState<NiceMock<s1>, Entry>();
+    ASSERT_NE(nullptr, (_sm.getState<s1>()));
+    ASSERT_EQ(&_sm, (_sm.getState<sm>()));
+}
+
+TEST_F(DsmFixture, test_state_numbering)
+{
+    EXPECT_CALL(_sm, onError(_)).Times(3);
+    _sm.addState<NiceMock<s0>, Entry>();
+    _sm.addState<s0, NiceMock<s1>, Entry>();
+    _sm.addState<s0, NiceMock<s2>>();
+    _sm.addState<s0, s3, 1, Entry>();
+    _sm.addState<NiceMock<s4>>();
+
+    s0* _s0 = _sm.getState<s0>();
+    s1* _s1 = _sm.getState<s1>();
+    s3* _s3 = _sm.getState<s3>();
+    s4* _s4 = _sm.getState<s4>();
+
+    // Nested source and destination
+    _sm.addTransition<s0, e3, s1>();
+    _sm.addTransition<s1, e3, s0>();
+    // Crossing regions
+    _sm.addTransition<s1, e2, s3>();
+
+    _sm.addTransition<s1, e0, s2>();
+    _sm.addTransition<s2, e1, s4>();
+    _sm.addTransition<s4, e1, s1>();
+
+    // Numbered on start: same answers as the ancestors search
+    ASSERT_TRUE(_s0->contains(_s3));
+    ASSERT_FALSE(_s4->contains(_s1));
+    _sm.start();
+    ASSERT_TRUE(_s0->contains(_s3));
+    ASSERT_TRUE(_sm.contains(_s3));
+    ASSERT_TRUE(_s1->contains(_s1));
+    ASSERT_FALSE(_s1->contains(_s0));
+    ASSERT_FALSE(_s4->contains(_s1));
+    ASSERT_FALSE(_s3->contains(_s1));
+
+    ASSERT_TRUE((_sm.checkStates<s0, s1>()));
+    ASSERT_TRUE((_sm.checkStates<s0, s3>()));
+    _sm.processEvent(e0{});
+    ASSERT_TRUE((_sm.checkStates<s0, s2>()));
+    ASSERT_TRUE((_sm.checkStates<s0, s3>()));
+    _sm.processEvent(e1{});
+    ASSERT_TRUE((_sm.checkStates<s4>()));
+    _sm.processEvent(e1{});
+    ASSERT_TRUE((_sm.checkStates<s0, s1>()));
+    ASSERT_TRUE((_sm.checkStates<s0, s3>()));
+}
+
+TEST_F(DsmFixture, test_transition_path)
+{
+    _sm.addState<NiceMock<s0>, Entry>();
+    _sm.addState<s0, NiceMock<s2>, Entry>();
+    _sm.addState<s2, NiceMock<s3>, Entry>();
+    _sm.addState<NiceMock<s1>>();
+    _sm.addState<s1, NiceMock<s4>, Entry>();
+    _sm.addState<s1, s5>();
+    _sm.addState<s1, NiceMock<s6>, 1, Entry>();
+    _sm.addState<s4, s7, Entry>();
+    _sm.addState<s4, s8>();
+
+    // Entry chains: s1, s4, s8 / s0, s2, s3 / s5 / s4
+    _sm.addTransition<s3, e0, s8>();
+    _sm.addTransition<s8, e1, s3>();
+    _sm.addTransition<s8, e3, s5>();
+    _sm.addTransition<s5, e3, s4>();
+
+    // The history of the regions enclosing the common ancestor propagates along the entry chain
+    _sm.setHistory<sm>(History::Deep);
+
+    _sm.start();
+    ASSERT_TRUE((_sm.checkStates<s0, s2, s3>()));
+    _sm.processEvent(e0{});
+    ASSERT_TRUE((_sm.checkStates<s1, s4, s8>()));
+    ASSERT_TRUE((_sm.checkStates<s1, s6>()));
+    _sm.processEvent(e3{});
+    ASSERT_TRUE((_sm.checkStates<s1, s5>()));
+    ASSERT_TRUE((_sm.checkStates<s1, s6>()));
+    _sm.processEvent(e3{});
+    ASSERT_TRUE((_sm.checkStates<s1, s4, s8>()));
+    _sm.processEvent(e1{});
+    ASSERT_TRUE((_sm.checkStates<s0, s2, s3>()));
+
+    // Runtime transitions, from the top-sm and from a state
+    _sm.transit<s7>();
+    ASSERT_TRUE((_sm.checkStates<s1, s4, s7>()));
+    ASSERT_TRUE((_sm.checkStates<s1, s6>()));
+    _sm.getState<s7>()->transit<s3>();
+    ASSERT_TRUE((_sm.checkStates<s0, s2, s3>()));
+}
+
+TEST_F(DsmFixture, test_subtree_events)
+{
+    details::EventSet set;
+    set.insert(3);
+    set.insert(130);
+    ASSERT_TRUE(set.contains(3));
+    ASSERT_TRUE(set.contains(130));
+    ASSERT_FALSE(set.contains(4));
+    ASSERT_FALSE(set.contains(1000));
+    details::EventSet other;
+    other.insert(4);
+    other.merge(set);
+    ASSERT_TRUE(other.contains(4));
+    ASSERT_TRUE(other.contains(130));
+
+    _sm.addState<NiceMock<s0>, Entry>();
+    _sm.addState<s0, NiceMock<s1>, Entry>();
+    _sm.addState<s0, NiceMock<s6>, 1, Entry>();
+    _sm.addState<NiceMock<s2>>();
+
+    _sm.addTransition<s6, e2, s6, &s6::onEvent2>();
+    _sm.addTransition<s1, e0, s2>();
+    // Handled by an inactive state only
+    _sm.addTransition<s2, e1, s0>();
+
+    s6* _s6 = _sm.getState<s6>();
+    EXPECT_CALL(*_s6, onEvent2(_)).Times(2);
+
+    _sm.start();
+    _sm.processEvent(e2{});
+    _sm.processEvent(e1{});
+    ASSERT_TRUE((_sm.checkStates<s0, s1>()));
+    // Not handled by any state
+    _sm.processEvent(e3{});
+    ASSERT_TRUE((_sm.checkStates<s0, s1>()));
+    _sm.processEvent(e2{});
+
+    _sm.processEvent(e0{});
+    ASSERT_TRUE((_sm.checkStates<s2>()));
+    _sm.processEvent(e2{});
+    _sm.processEvent(e1{});
+    ASSERT_TRUE((_sm.checkStates<s0, s1>()));
+    ASSERT_TRUE((_sm.checkStates<s0, s6>()));
+}
+
+TEST_F(DsmFixture, test_layout)
+{
+    _sm.addState<NiceMock<s0>, Entry>();
+    _sm.addState<s0, NiceMock<s1>, Entry>();
+    _sm.addState<s0, NiceMock<s2>>();
+    _sm.addState<s0, NiceMock<s6>, 1, Entry>();
+    _sm.addState<s3>();
+    _sm.setHistory<s0, 0>(History::Deep);
+
+    _sm.addTransition<s1, e0, s2>();
+    _sm.addTransition<s6, e2, s6, &s6::onEvent2>();
+    _sm.addTransition<s0, e1, s3>();
+    _sm.addTransition<s3, e1, s0>();
+
+    s6* _s6 = _sm.getState<s6>();
+    EXPECT_CALL(*_s6, onEvent2(_)).Times(3);
+
+    _sm.start();
+    _sm.processEvent(e0{});
+    ASSERT_TRUE((_sm.checkStates<s0, s2>()));
+    _sm.processEvent(e2{});
+
+    // Current sub-states restored from history are laid out as well
+    _sm.processEvent(e1{});
+    ASSERT_TRUE((_sm.checkStates<s3>()));
+    _sm.processEvent(e2{});
+    _sm.processEvent(e1{});
+    ASSERT_TRUE((_sm.checkStates<s0, s2>()));
+    ASSERT_TRUE((_sm.checkStates<s0, s6>()));
+    _sm.processEvent(e2{});
+
+    // Topology changed while stopped: laid out again on start
+    _sm.stop();
+    _sm.addState<s0, s4>();
+    _sm.addTransition<s2, e0, s4>();
+    _sm.addTransition<s4, e3, s1>();
+    _sm.start();
+    ASSERT_TRUE((_sm.checkStates<s0, s2>()));
+    _sm.processEvent(e0{});
+    ASSERT_TRUE((_sm.checkStates<s0, s4>()));
+    _sm.processEvent(e3{});
+    ASSERT_TRUE((_sm.checkStates<s0, s1>()));
+    _sm.processEvent(e2{});
+}
+
+/**
+ * Nested and orthogonal regions, shallow and deep history, internal and external transitions, guards and actions
+ */
+static void BuildFlatSm(flat_sm& machine)
+{
+    using f0 = flat_state<0>; using f1 = flat_state<1>; using f2 = flat_state<2>; using f3 = flat_state<3>;
+    using f4 = flat_state<4>; using f5 = flat_state<5>; using f6 = flat_state<6>; using f7 = flat_state<7>;
+    using f8 = flat_state<8>; using f9 = flat_state<9>; using f10 = flat_state<10>; using f11 = flat_state<11>;
+
+    machine.addState<f0, Entry>();
+    machine.addState<f1>();
+    machine.addState<f0, f2, Entry>();
+    machine.addState<f0, f3>();
+    machine.addState<f3, f8, Entry>();
+    machine.addState<f3, f9>();
+    machine.addState<f0, f4, 1, Entry>();
+    machine.addState<f0, f5, 1>();
+    machine.addState<f1, f6, Entry>();
+    machine.addState<f1, f7>();
+    machine.addState<f7, f10, Entry>();
+    machine.addState<f7, f11>();
+
+    machine.addTransition<f2, e0, f2, &f2::action<e0>, &f2::guard<e0>, f3>();
+    machine.addTransition<f3, e0, f2>();
+    machine.addTransition<f8, e1, f8, &f8::action<e1>, &f8::guard<e1>, f9>();
+    machine.addTransition<f9, e1, f8>();
+    machine.addTransition<f4, e0, f4, &f4::action<e0>, &f4::guard<e0>, f5>();
+    machine.addTransition<f5, e0, f4>();
+    machine.addTransition<f9, e2, f9, &f9::action<e2>, &f9::guard<e2>, f1>();
+    machine.addTransition<f5, e3, f7>();
+    machine.addTransition<f1, e2, f1, &f1::action<e2>, &f1::guard<e2>, f0>();
+    machine.addTransition<f10, e1, f11>();
+    machine.addTransition<f11, e1, f10>();
+    machine.addTransition<f6, e3, f6, &f6::action<e3>, &f6::guard<e3>, f11>();
+    // Internal transitions, the first one shadowing f5's
+    machine.addTransition<f0, e3, f0, &f0::action<e3>, &f0::guard<e3>>();
+    machine.addTransition<f4, e2, f4, &f4::action<e2>>();
+
+    machine.setHistory<f0>(History::Shallow);
+    machine.setHistory<f1>(History::Deep);
+}
+
+TEST_F(DsmFixture, test_flat_machine)
+{
+    flat_sm interpreted;
+    flat_sm compiled;
+    flat_sm limited;
+    BuildFlatSm(interpreted);
+    BuildFlatSm(compiled);
+    BuildFlatSm(limited);
+
+    ASSERT_TRUE(compiled.compile());
+    ASSERT_TRUE(compiled.compiled());
+    ASSERT_FALSE(limited.compile(2));
+    ASSERT_FALSE(limited.compiled());
+    ASSERT_FALSE(interpreted.compiled());
+
+    std::vector<flat_sm*> machines{ &interpreted, &compiled, &limited };
+    for (auto machine : machines) machine->start();
+    ASSERT_EQ(interpreted.store()->log, compiled.store()->log);
+
+    // Same randomized event stream, with runtime transitions and restarts the table does not know about
+    std::mt19937 generator{ 42 };
+    std::uniform_int_distribution<int> distribution{ 0, 99 };
+    for (int i = 0; i < 20000; ++i)
+    {
+        const int draw = distribution(generator);
+        for (auto machine : machines)
+        {
+            if (draw < 24) machine->processEvent(e0{});
+            else if (draw < 48) machine->processEvent(e1{});
+            else if (draw < 72) machine->processEvent(e2{});
+            else if (draw < 96) machine->processEvent(e3{});
+            else if (draw < 98) machine->transit<flat_state<9>>();
+            else if (draw < 99) machine->getState<flat_state<11>>()->transit<flat_state<6>>();
+            else
+            {
+                machine->stop();
+                machine->start();
+            }
+        }
+
+        ASSERT_EQ(interpreted.store()->log, compiled.store()->log) << "after " << i << " events";
+        ASSERT_EQ(interpreted.store()->log, limited.store()->log) << "after " << i << " events";
+    }
+
+    ASSERT_TRUE(compiled.compiled());
+
+    // Rebuilt on start after a topology change
+    compiled.stop();
+    compiled.addTransition<flat_state<2>, e2, flat_state<3>>();
+    ASSERT_TRUE(compiled.compiled());
+    compiled.start();
+    compiled.processEvent(e2{});
+    ASSERT_TRUE((compiled.checkStates<flat_state<0>, flat_state<3>>()));
+}
+
+TEST_F(DsmFixture, test_shared_topology)
+{
+    flat_sm topology;
+    flat_sm compiledTopology;
+    BuildFlatSm(topology);
+    BuildFlatSm(compiledTopology);
+    ASSERT_TRUE(compiledTopology.compile());
+
+    // Standalone machines as a reference, and instances of both topologies, each one with its own event stream
+    constexpr std::size_t Count = 3;
+    std::vector<std::unique_ptr<flat_sm>> machines;
+    std::vector<flat_sm::Instance> instances;
+    std::vector<flat_sm::Instance> compiledInstances;
+    std::vector<std::mt19937> generators;
+    for (std::size_t k = 0; k < Count; ++k)
+    {
+        machines.push_back(std::make_unique<flat_sm>());
+        BuildFlatSm(*machines.back());
+        instances.emplace_back(topology);
+        compiledInstances.emplace_back(compiledTopology);
+        generators.emplace_back(static_cast<std::mt19937::result_type>(k));
+
+        machines[k]->start();
+        instances[k].start();
+        compiledInstances[k].start();
+        ASSERT_TRUE(instances[k].started());
+    }
+
+    ASSERT_FALSE(topology.started());
+
+    std::uniform_int_distribution<int> distribution{ 0, 99 };
+    for (int i = 0; i < 5000; ++i)
+    {
+        for (std::size_t k = 0; k < Count; ++k)
+        {
+            const int draw = distribution(generators[k]);
+            auto apply = [draw](auto& machine) {
+                if (draw < 24) machine.processEvent(e0{});
+                else if (draw < 48) machine.processEvent(e1{});
+                else if (draw < 72) machine.processEvent(e2{});
+                else if (draw < 98) machine.processEvent(e3{});
+                else
+                {
+                    machine.stop();
+                    machine.start();
+                }
+            };
+
+            apply(*machines[k]);
+            apply(instances[k]);
+            apply(compiledInstances[k]);
+
+            ASSERT_EQ(machines[k]->store()->log, instances[k].store()->log) << "instance " << k << " after " << i << " events";
+            ASSERT_EQ(machines[k]->store()->log, compiledInstances[k].store()->log) << "instance " << k << " after " << i << " events";
+        }
+    }
+
+    ASSERT_NE(instances[0].store()->log, instances[1].store()->log);
+    ASSERT_FALSE(topology.started());
+
+    // Runtime state kept by the instance only
+    machines[0]->stop();
+    instances[0].stop();
+    ASSERT_FALSE(instances[0].started());
+    ASSERT_FALSE(instances[0].checkStates<flat_state<1>>());
+    machines[0]->start();
+    instances[0].start();
+    ASSERT_EQ(machines[0]->store()->log, instances[0].store()->log);
+    ASSERT_EQ(machines[0]->checkStates<flat_state<0>>(), instances[0].checkStates<flat_state<0>>());
+    ASSERT_EQ(machines[0]->checkStates<flat_state<1>>(), instances[0].checkStates<flat_state<1>>());
+
+    // A topology started by itself runs independently of its instances
+    flat_sm reference;
+    BuildFlatSm(reference);
+    reference.start();
+    topology.start();
+    ASSERT_EQ(reference.store()->log, topology.store()->log);
+    ASSERT_TRUE(topology.started());
+    machines[1]->processEvent(e0{});
+    instances[1].processEvent(e0{});
+    ASSERT_EQ(machines[1]->store()->log, instances[1].store()->log);
+    ASSERT_EQ(reference.store()->log, topology.store()->log);
+    topology.stop();
+
+    // Instances are reset after a topology change
+    topology.addTransition<flat_state<2>, e2, flat_state<3>>();
+    instances[1].processEvent(e0{});
+    ASSERT_FALSE(instances[1].started());
+    instances[1].start();
+    ASSERT_TRUE(instances[1].started());
+}
+
+TEST_F(DsmFixture, test_concurrent_instances)
+{
+    flat_sm topology;
+    flat_sm compiledTopology;
+    BuildFlatSm(topology);
+    BuildFlatSm(compiledTopology);
+    ASSERT_TRUE(compiledTopology.compile());
+
+    // Each thread runs its own instances of both topologies, and a standalone machine as a reference
+    constexpr std::size_t Count = 4;
+    std::vector<std::unique_ptr<flat_sm>> machines;
+    std::vector<flat_sm::Instance> instances;
+    std::vector<flat_sm::Instance> compiledInstances;
+    for (std::size_t k = 0; k < Count; ++k)
+    {
+        machines.push_back(std::make_unique<flat_sm>());
+        BuildFlatSm(*machines.back());
+        instances.emplace_back(topology);
+        compiledInstances.emplace_back(compiledTopology);
+    }
+
+    std::atomic<std::size_t> mismatches{ 0 };
+    auto run = [&mismatches](std::mt19937::result_type seed, std::vector<flat_sm*> machines, auto&... others) {
+        std::mt19937 generator{ seed };
+        std::uniform_int_distribution<int> distribution{ 0, 99 };
+        for (auto machine : machines) machine->start();
+        (others.start(), ...);
+
+        for (int i = 0; i < 5000; ++i)
+        {
+            const int draw = distribution(generator);
+            auto apply = [draw](auto& machine) {
+                if (draw < 24) machine.processEvent(e0{});
+                else if (draw < 48) machine.processEvent(e1{});
+                else if (draw < 72) machine.processEvent(e2{});
+                else if (draw < 98) machine.processEvent(e3{});
+                else
+                {
+                    machine.stop();
+                    machine.start();
+                }
+            };
+
+            for (auto machine : machines) apply(*machine);
+            (apply(others), ...);
+
+            const auto& log = machines.front()->store()->log;
+            if (((log != others.store()->log) || ...)) ++mismatches;
+            for (auto machine : machines)
+            {
+                if (log != machine->store()->log) ++mismatches;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (std::size_t k = 0; k < Count; ++k)
+    {
+        threads.emplace_back([&, k]() { run(static_cast<std::mt19937::result_type>(k), { machines[k].get() }, instances[k], compiledInstances[k]); });
+    }
+
+    // Meanwhile, both topologies run by themselves
+    flat_sm reference;
+    BuildFlatSm(reference);
+    run(static_cast<std::mt19937::result_type>(Count), { &reference, &topology, &compiledTopology });
+
+    for (auto& thread : threads) thread.join();
+
+    ASSERT_EQ(0u, mismatches.load());
+    for (std::size_t k = 0; k < Count; ++k)
+    {
+        ASSERT_EQ(machines[k]->store()->log, instances[k].store()->log);
+        ASSERT_EQ(machines[k]->store()->log, compiledInstances[k].store()->log);
+    }
+    ASSERT_NE(instances[0].store()->log, instances[1].store()->log);
+}
+
+TEST_F(DsmFixture, test_instance_deferred_events)
+{
+    using f0 = flat_state<0>; using f1 = flat_state<1>; using f2 = flat_state<2>;
+
+    flat_sm topology;
+    topology.addState<f0, Entry>();
+    topology.addState<f1>();
+    topology.addState<f2>();
+    topology.addTransition<f0, e2, f2>();
+    topology.addTransition<f2, e3, f1>();
+
+    flat_sm::Instance x{ topology };
+    flat_sm::Instance y{ topology };
+    x.start();
+    y.start();
+    y.processEvent(e2{});
+    ASSERT_TRUE(y.checkStates<f2>());
+
+    // Kept by the instance deferring it, not delivered to the next one bound
+    x.deferEvent(e3{});
+    ASSERT_EQ(1u, x.queueMetrics().posted);
+    y.processEvent(e0{});
+    ASSERT_TRUE(y.checkStates<f2>());
+    ASSERT_EQ(0u, y.queueMetrics().posted);
+
+    x.processEvent(e2{});
+    ASSERT_TRUE(x.checkStates<f1>());
+    ASSERT_EQ(0u, x.queueMetrics().posted);
+}
+
+TEST_F(DsmFixture, test_instance_clone)
+{
+    flat_sm topology;
+    BuildFlatSm(topology);
+
+    // Started prototype holding deferred events that no active state handles yet, one of them not tried again yet
+    flat_sm::Instance prototype{ topology };
+    prototype.start();
+    prototype.deferEvent(e1{});
+    prototype.processEvent(e2{});
+    prototype.deferEvent(e1{});
+    ASSERT_EQ(1u, prototype.queueMetrics().deferred);
+    ASSERT_EQ(1u, prototype.queueMetrics().posted);
+
+    // Clones resume where the prototype stands, without entering any state
+    auto clone = prototype.clone();
+    flat_sm::Instance copy{ prototype };
+    ASSERT_TRUE(clone.started());
+    ASSERT_EQ(prototype.store()->log, clone.store()->log);
+    ASSERT_EQ(prototype.store()->log, copy.store()->log);
+    ASSERT_EQ(1u, clone.queueMetrics().deferred);
+    ASSERT_EQ(1u, clone.queueMetrics().posted);
+
+    // Then run on their own: same event stream, same behavior, separate stores
+    std::mt19937 generator{ 7 };
+    std::uniform_int_distribution<int> distribution{ 0, 3 };
+    for (int i = 0; i < 2000; ++i)
+    {
+        const int draw = distribution(generator);
+        for (auto instance : { &prototype, &clone })
+        {
+            if (0 == draw) instance->processEvent(e0{});
+            else if (1 == draw) instance->processEvent(e1{});
+            else if (2 == draw) instance->processEvent(e2{});
+            else instance->processEvent(e3{});
+        }
+        ASSERT_EQ(prototype.store()->log, clone.store()->log) << "after " << i << " events";
+    }
+
+    ASSERT_EQ(0u, clone.queueMetrics().posted + clone.queueMetrics().deferred);
+    ASSERT_EQ(2u, copy.queueMetrics().posted + copy.queueMetrics().deferred);
+    ASSERT_NE(prototype.store()->log, copy.store()->log);
+
+    // Stopped prototypes clone into stopped instances
+    prototype.stop();
+    copy = prototype;
+    ASSERT_FALSE(copy.started());
+    ASSERT_EQ(prototype.store()->log, copy.store()->log);
+    copy.start();
+    ASSERT_TRUE(copy.started());
+}
+
+TEST_F(DsmFixture, test_inbox)
+{
+    constexpr std::size_t Producers = 4;
+    constexpr std::size_t Events = 5000;
+
+    for (auto policy : { WaitPolicy::Block, WaitPolicy::BusyPoll })
+    {
+        inbox_sm machine;
+        machine.addState<inbox_state, Entry>();
+        machine.addTransition<inbox_state, numbered, inbox_state, &inbox_state::onNumbered>();
+        machine.start();
+
+        // Small inbox, so that producers wait for free slots
+        Inbox<inbox_sm> inbox{ machine, 64, policy };
+        ASSERT_EQ(64u, inbox.capacity());
+        ASSERT_EQ(0u, inbox.runOnce());
+
+        std::vector<std::thread> producers;
+        for (std::size_t producer = 0; producer < Producers; ++producer)
+        {
+            producers.emplace_back([&inbox, producer]() {
+                for (std::size_t number = 0; number < Events; ++number) inbox.postEvent(numbered{ producer, number });
+            });
+        }
+
+        std::thread stopper{ [&producers, &inbox]() {
+            for (auto& producer : producers) producer.join();
+            inbox.stop();
+        } };
+
+        // Events posted before stop are processed before run returns
+        inbox.run();
+        stopper.join();
+
+        ASSERT_EQ(Producers * Events, machine.store()->processed);
+        ASSERT_EQ(0u, machine.store()->outOfOrder);
+    }
+
+    // Instances of a shared topology
+    inbox_sm topology;
+    topology.addState<inbox_state, Entry>();
+    topology.addTransition<inbox_state, numbered, inbox_state, &inbox_state::onNumbered>();
+
+    inbox_sm::Instance instance{ topology };
+    instance.start();
+
+    Inbox<inbox_sm::Instance> inbox{ instance };
+    std::thread producer{ [&inbox]() {
+        for (std::size_t number = 0; number < Events; ++number) inbox.postEvent(numbered{ 0, number });
+        inbox.stop();
+    } };
+
+    inbox.run();
+    producer.join();
+
+    ASSERT_EQ(Events, instance.store()->processed);
+    ASSERT_EQ(0u, instance.store()->outOfOrder);
+}
+
+TEST_F(DsmFixture, test_executor)
+{
+    constexpr std::size_t Producers = 4;
+    constexpr std::size_t Machines = 50;
+    constexpr std::size_t Events = 200;
+
+    // Small budget, so that strands are often rescheduled and stolen
+    Executor executor{ 4, 8 };
+    ASSERT_EQ(4u, executor.workers());
+
+    std::vector<std::unique_ptr<inbox_sm>> machines;
+    std::vector<std::unique_ptr<Strand>> strands;
+    for (std::size_t i = 0; i < Machines; ++i)
+    {
+        machines.push_back(std::make_unique<inbox_sm>());
+        machines.back()->addState<inbox_state, Entry>();
+        machines.back()->addTransition<inbox_state, numbered, inbox_state, &inbox_state::onNumbered>();
+        machines.back()->start();
+        strands.push_back(std::make_unique<Strand>(executor));
+    }
+
+    // Instances of a shared topology, each one posted to through its own strand
+    inbox_sm topology;
+    topology.addState<inbox_state, Entry>();
+    topology.addTransition<inbox_state, numbered, inbox_state, &inbox_state::onNumbered>();
+
+    std::vector<inbox_sm::Instance> instances;
+    std::vector<std::unique_ptr<Strand>> instanceStrands;
+    for (std::size_t i = 0; i < 4; ++i)
+    {
+        instances.emplace_back(topology);
+        instances.back().start();
+        instanceStrands.push_back(std::make_unique<Strand>(executor));
+    }
+
+    std::vector<std::thread> producers;
+    for (std::size_t producer = 0; producer < Producers; ++producer)
+    {
+        producers.emplace_back([&, producer]() {
+            for (std::size_t number = 0; number < Events; ++number)
+            {
+                for (std::size_t i = 0; i < Machines; ++i) strands[i]->postEvent(*machines[i], numbered{ producer, number });
+                for (std::size_t i = 0; i < instances.size(); ++i) instanceStrands[i]->postEvent(instances[i], numbered{ producer, number });
+            }
+        });
+    }
+
+    for (auto& producer : producers) producer.join();
+    executor.wait();
+
+    for (const auto& machine : machines)
+    {
+        ASSERT_EQ(Producers * Events, machine->store()->processed);
+        ASSERT_EQ(0u, machine->store()->outOfOrder);
+    }
+
+    for (const auto& instance : instances)
+    {
+        ASSERT_EQ(Producers * Events, instance.store()->processed);
+        ASSERT_EQ(0u, instance.store()->outOfOrder);
+    }
+
+    std::uint64_t processed = 0;
+    for (const auto& metrics : executor.metrics())
+    {
+        processed += metrics.events;
+        ASSERT_LE(metrics.utilization, 1.0);
+        ASSERT_LE(metrics.meanLatency, metrics.maxLatency);
+    }
+    ASSERT_EQ(Producers * Events * (Machines + instances.size()), processed);
+
+    executor.resetMetrics();
+    for (const auto& metrics : executor.metrics()) ASSERT_EQ(0u, metrics.events);
+}
+
+TEST_F(DsmFixture, test_executor_strand_lifetime)
+{
+    // Each run exhausts the budget: strands are released by their worker before wait returns.
+    // A single worker, so that the machine may be posted to through several strands
+    Executor executor{ 1, 1 };
+
+    inbox_sm machine;
+    machine.addState<inbox_state, Entry>();
+    machine.addTransition<inbox_state, numbered, inbox_state, &inbox_state::onNumbered>();
+    machine.start();
+
+    for (int round = 0; round < 2; ++round)
+    {
+        std::vector<std::unique_ptr<Strand>> strands;
+        for (std::size_t i = 0; i < 10000; ++i)
+        {
+            strands.push_back(std::make_unique<Strand>(executor));
+            strands.back()->postEvent(machine, numbered{ 0, 10000 * round + i });
+        }
+
+        executor.wait();
+    }
+
+    ASSERT_EQ(20000u, machine.store()->processed);
+
+    // Destroyed right after posting: waits for its event
+    {
+        Strand strand{ executor };
+        strand.postEvent(machine, numbered{ 0, 20000 });
+    }
+    ASSERT_EQ(20001u, machine.store()->processed);
+}
+
+TEST_F(DsmFixture, test_sharded_runtime)
+{
+    constexpr std::size_t Machines = 12;
+    constexpr std::size_t Hops = 200;
+    constexpr std::size_t Events = 2000;
+
+    for (auto policy : { WaitPolicy::BusyPoll, WaitPolicy::Block })
+    {
+        // Small mailboxes, so that events overflow
+        ShardedRuntime runtime{ 3, 4, policy, false };
+        ASSERT_EQ(3u, runtime.shards());
+        ASSERT_FALSE(runtime.pinned(0));
+
+        // Ring of relays spread over the shards, neighbours sharing a shard once in a while
+        std::vector<std::unique_ptr<relay_sm>> relays;
+        std::vector<Endpoint> endpoints;
+        for (std::size_t i = 0; i < Machines; ++i)
+        {
+            relays.push_back(std::make_unique<relay_sm>());
+            relays.back()->addState<relay_state, Entry>();
+            relays.back()->addTransition<relay_state, relayed, relay_state, &relay_state::onRelayed>();
+            relays.back()->start();
+            endpoints.push_back(runtime.attach(*relays.back(), i / 2));
+        }
+        for (std::size_t i = 0; i < Machines; ++i)
+        {
+            relays[i]->store()->runtime = &runtime;
+            relays[i]->store()->next = endpoints[(i + 1) % Machines];
+        }
+
+        // Ordered events from several external threads
+        inbox_sm machine;
+        machine.addState<inbox_state, Entry>();
+        machine.addTransition<inbox_state, numbered, inbox_state, &inbox_state::onNumbered>();
+        machine.start();
+        const auto endpoint = runtime.attach(machine, 1);
+
+        std::vector<std::thread> producers;
+        for (std::size_t producer = 0; producer < 2; ++producer)
+        {
+            producers.emplace_back([&, producer]() {
+                for (std::size_t number = 0; number < Events; ++number) runtime.postEvent(endpoint, numbered{ producer, number });
+            });
+        }
+
+        for (std::size_t i = 0; i < Machines; ++i) runtime.postEvent(endpoints[i], relayed{ Hops });
+        for (auto& producer : producers) producer.join();
+        runtime.wait();
+
+        std::size_t processed = 0;
+        for (const auto& relay : relays) processed += relay->store()->processed;
+        ASSERT_EQ(Machines * (Hops + 1), processed);
+
+        ASSERT_EQ(2 * Events, machine.store()->processed);
+        ASSERT_EQ(0u, machine.store()->outOfOrder);
+
+        std::uint64_t total = 0;
+        for (std::size_t shard = 0; shard < runtime.shards(); ++shard) total += runtime.processed(shard);
+        ASSERT_EQ(processed + 2 * Events, total);
+    }
+}
+
+TEST_F(DsmFixture, test_concurrent_regions)
+{
+    auto build = [](device_sm& machine) {
+        machine.addState<device, Entry>();
+        machine.addState<off>();
+        machine.addState<device, idle<0>, 0, Entry>();
+        machine.addState<device, busy<0>, 0>();
+        machine.addState<device, idle<1>, 1, Entry>();
+        machine.addState<device, busy<1>, 1>();
+        machine.addState<device, idle<2>, 2, Entry>();
+        machine.addState<device, busy<2>, 2>();
+        machine.addState<device, idle<3>, 3, Entry>();
+        machine.addState<device, busy<3>, 3>();
+        machine.addState<device, idle<4>, 4, Entry>();
+        machine.addTransition<idle<0>, tick, idle<0>, &idle<0>::onTick, busy<0>>();
+        machine.addTransition<idle<1>, tick, idle<1>, &idle<1>::onTick, busy<1>>();
+        machine.addTransition<idle<2>, tick, idle<2>, &idle<2>::onTick, busy<2>>();
+        machine.addTransition<idle<3>, tick, idle<3>, &idle<3>::onTick, busy<3>>();
+        machine.addTransition<idle<4>, tick, idle<4>, &idle<4>::onTick>();
+        machine.addTransition<idle<4>, shutdown, off>();
+        machine.addTransition<device, region_done, device, &device::onDone>();
+
+        // The last region leaves the device state: it runs alone
+        machine.setIndependent<device, 0>();
+        machine.setIndependent<device, 1>();
+        machine.setIndependent<device, 2>();
+        machine.setIndependent<device, 3>();
+        machine.setIndependent<device, 4>();
+    };
+
+    // Reference: regions run one after another
+    device_sm sequential;
+    build(sequential);
+    sequential.start();
+    sequential.processEvent(tick{});
+    ASSERT_THAT(sequential.store()->done, ::testing::ElementsAre(0, 1, 2, 3, 4));
+
+    RegionPool pool{ 3 };
+    ASSERT_EQ(3u, pool.helpers());
+
+    device_sm concurrent;
+    build(concurrent);
+    concurrent.setRegionScheduler(&pool);
+    concurrent.store()->meet = true;
+    concurrent.start();
+    concurrent.processEvent(tick{});
+
+    // All independent regions ran at once, their posted events being processed in region order
+    ASSERT_EQ(4, concurrent.store()->met.load());
+    ASSERT_THAT(concurrent.store()->done, ::testing::ElementsAre(0, 1, 2, 3, 4));
+    ASSERT_TRUE((concurrent.checkStates<device, busy<0>>()));
+    ASSERT_TRUE((concurrent.checkStates<device, busy<3>>()));
+    ASSERT_TRUE((concurrent.checkStates<device, idle<4>>()));
+
+    concurrent.processEvent(shutdown{});
+    ASSERT_TRUE((concurrent.checkStates<off>()));
+
+    // Back to one after another
+    concurrent.setRegionScheduler(nullptr);
+    concurrent.store()->meet = false;
+    concurrent.store()->done.clear();
+    concurrent.stop();
+    concurrent.start();
+    concurrent.processEvent(tick{});
+    ASSERT_THAT(concurrent.store()->done, ::testing::ElementsAre(0, 1, 2, 3, 4));
+}
+
+TEST_F(DsmFixture, test_run_to_completion_containers)
+{
+    details::RingQueue<std::string> ring{ 2 };
+    ASSERT_EQ(2u, ring.capacity());
+
+    // Wrap around then grow while wrapped
+    ring.emplace("a");
+    ring.emplace("b");
+    ASSERT_EQ("a", ring.pop());
+    ring.emplace("c");
+    ring.emplace("d");
+    ASSERT_EQ(4u, ring.capacity());
+    ASSERT_EQ(3u, ring.size());
+    ASSERT_EQ("b", ring.pop());
+    ASSERT_EQ("c", ring.pop());
+    ASSERT_EQ("d", ring.pop());
+    ASSERT_TRUE(ring.empty());
+
+    details::NodeList<std::string> list;
+    auto a = list.push_back("a");
+    auto b = list.push_back("b");
+    list.push_back("c");
+
+    // Removal from the middle
+    ASSERT_EQ("c", list.erase(b)->m_value);
+    ASSERT_EQ(2u, list.size());
+    ASSERT_EQ(a, list.front());
+    ASSERT_EQ("c", list.front()->m_next->m_value);
+
+    // Removed nodes are reused
+    ASSERT_EQ(b, list.push_back("d"));
+    ASSERT_EQ(nullptr, list.erase(b));
+    ASSERT_EQ("c", list.erase(a)->m_value);
+    list.clear();
+    ASSERT_TRUE(list.empty());
+    ASSERT_EQ(nullptr, list.front());
+}
+
+TEST_F(DsmFixture, test_sm_visitor)
+{
+    _sm.addState<NiceMock<s0>, Entry>("s0");
+    _sm.addState<s0, NiceMock<s1>, Entry>("s1");
+    _sm.addState<s1, NiceMock<s2>, Entry>("s2");
+
+    _sm.start();
+
+    Visitor v{ "s2" };
+    _sm.visit(v);
+
+    ASSERT_TRUE(v.found);
+    ASSERT_TRUE((v.states == std::vector<std::string>{ "sm", "s0", "s1", "s2" }));
+}
+
+TEST_F(DsmFixture, test_posted_transition)
+{
+    details::PostedTransition _ptr1{ e0{}, true };
+    details::PostedTransition _ptr2{ &_sm, {} };
+
+    ASSERT_TRUE(bool(_ptr1.m_evt));
+    ASSERT_FALSE(_ptr1.isTransition());
+    ASSERT_TRUE(_ptr1.m_deferred);
+    ASSERT_FALSE(bool(_ptr2.m_evt));
+    ASSERT_TRUE(_ptr2.isTransition());
+    ASSERT_FALSE(_ptr2.m_deferred);
+
+    details::PostedTransition _ptr3{ std::move(_ptr1) };
+    details::PostedTransition _ptr4;
+    _ptr4 = std::move(_ptr2);
+
+    ASSERT_FALSE(bool(_ptr1.m_evt));
+    ASSERT_FALSE(_ptr1.isTransition());
+    ASSERT_FALSE(_ptr1.m_deferred);
+    ASSERT_FALSE(bool(_ptr2.m_evt));
+    ASSERT_FALSE(_ptr2.isTransition());
+    ASSERT_FALSE(_ptr2.m_deferred);
+
+    ASSERT_TRUE(bool(_ptr3.m_evt));
+    ASSERT_EQ("e0", _ptr3.m_evt.get()->name());
+    ASSERT_FALSE(_ptr3.isTransition());
+    ASSERT_TRUE(_ptr3.m_deferred);
+    ASSERT_FALSE(bool(_ptr4.m_evt));
+    ASSERT_TRUE(_ptr4.isTransition());
+    ASSERT_FALSE(_ptr4.m_deferred);
+}
+
+struct small_event : Event<small_event>
+{
+    static inline int alive = 0;
+
+    small_event() { ++alive; }
+    small_event(const small_event& other) : Event<small_event>{ other } { ++alive; }
+    ~small_event() { --alive; }
+};
+
+struct large_event : Event<large_event>
+{
+    static inline int alive = 0;
+
+    large_event() { ++alive; }
+    large_event(const large_event& other) : Event<large_event>{ other }, text{ other.text } { ++alive; }
+    ~large_event() { --alive; }
+
+    char payload[details::EventEnvelope::InlineSize] = {};
+    std::string text;
+};
+
+TEST_F(DsmFixture, test_event_envelope)
+{
+    ASSERT_TRUE(details::EventEnvelope::IsInline<small_event>());
+    ASSERT_FALSE(details::EventEnvelope::IsInline<large_event>());
+
+    // Inline events are moved along with their envelope
+    {
+        details::EventEnvelope envelope;
+        ASSERT_FALSE(bool(envelope));
+
+        envelope.assign(small_event{});
+        ASSERT_EQ(1, small_event::alive);
+        ASSERT_EQ("small_event", envelope.get()->name());
+
+        details::EventEnvelope other{ std::move(envelope) };
+        ASSERT_FALSE(bool(envelope));
+        ASSERT_TRUE(bool(other));
+        ASSERT_EQ(1, small_event::alive);
+
+        other.reset();
+        ASSERT_EQ(0, small_event::alive);
+
+        other.assign(small_event{});
+    }
+    ASSERT_EQ(0, small_event::alive);
+
+    // Pooled events are stolen by the destination envelope, and their blocks are reused
+    {
+        large_event evt;
+        evt.text = "some text long enough to be allocated on the heap";
+
+        details::EventEnvelope envelope;
+        envelope.assign(evt);
+        ASSERT_EQ(2, large_event::alive);
+        const auto block = envelope.get();
+
+        details::EventEnvelope other;
+        other = std::move(envelope);
+        ASSERT_FALSE(bool(envelope));
+        ASSERT_EQ(block, other.get());
+        ASSERT_EQ(evt.text, static_cast<const large_event*>(other.get())->text);
+        ASSERT_EQ(2, large_event::alive);
+
+        other.reset();
+        ASSERT_EQ(1, large_event::alive);
+
+        envelope.assign(evt);
+        ASSERT_EQ(block, envelope.get());
+    }
+    ASSERT_EQ(0, large_event::alive);
+
+    // Pooled blocks released by another thread go back to the allocating one, and may outlive it
+    {
+        large_event evt;
+        details::EventEnvelope first;
+        details::EventEnvelope second;
+        std::atomic<int> step{ 0 };
+        bool reused = false;
+
+        std::thread owner{ [&]() {
+            first.assign(evt);
+            const auto block = first.get();
+            step.store(1);
+            while (step.load() != 2) std::this_thread::yield();
+
+            second.assign(evt);
+            reused = (block == second.get());
+        } };
+
+        while (step.load() != 1) std::this_thread::yield();
+        first.reset();
+        step.store(2);
+        owner.join();
+
+        ASSERT_TRUE(reused);
+        ASSERT_EQ(2, large_event::alive);
+        second.reset();
+    }
+    ASSERT_EQ(0, large_event::alive);
+}
+
+TEST_F(DsmFixture, test_event_id)
+{
+    const auto id0 = details::EventId<e0>();
+    const auto id1 = details::EventId<e1>();
+    const auto id2 = details::EventId<e2>();
+
+    ASSERT_EQ(id0, details::EventId<e0>());
+    ASSERT_NE(id0, id1);
+    ASSERT_NE(id0, id2);
+    ASSERT_NE(id1, id2);
+    ASSERT_NE(details::InvalidEventId, id0);
+}
+
+TEST_F(DsmFixture, test_event_name)
+{
+    e0 _e0;
+    e0 _other;
+    e1 _e1;
+
+    ASSERT_EQ("e0", _e0.name());
+    ASSERT_EQ("e1", _e1.name());
+    // Name is stored once per event type
+    ASSERT_EQ(_e0.name().data(), _other.name().data());
+    ASSERT_EQ(_e0.name().data(), static_cast<const EventBase&>(_e0).name().data());
+    ASSERT_LE(sizeof(e0), 2 * sizeof(void*));
+}
+
+TEST_F(DsmFixture, test_log_level)
+{
+    static_assert(false == Log::is_enabled_v<Log::EmptyLogger>, "EmptyLogger must be compiled out");
+    static_assert(true == Log::is_enabled_v<Log::ConsoleLogger>, "ConsoleLogger must be enabled");
+    static_assert(false == DSM_LOG_ENABLED(Log::eFatal), "Default logger must be compiled out");
+
+    using Logger = Log::Logger<Log::ConsoleLogger>;
+
+    ASSERT_EQ(Log::eDebug, Logger::GetLevel());
+    ASSERT_TRUE(Logger::IsEnabled(Log::eDebug));
+
+    Logger::SetLevel(Log::eWarning);
+    ASSERT_FALSE(Logger::IsEnabled(Log::eInfo));
+    ASSERT_TRUE(Logger::IsEnabled(Log::eWarning));
+    ASSERT_TRUE(Logger::IsEnabled(Log::eFatal));
+
+    Logger::SetLevel(Log::eOff);
+    ASSERT_FALSE(Logger::IsEnabled(Log::eFatal));
+
+    Logger::SetLevel(Log::eDebug);
+}
+
+TEST_F(DsmFixture, test_logger_sink)
+{
+    struct Sink : Log::ILogger
+    {
+        std::vector<std::string> records;
+
+        void writeLog(std::string_view module, Log::LogLevel level, std::string_view msg) override
+        {
+            records.emplace_back(std::string(module) + Log::LevelToStr(level) + std::string(msg));
+        }
+    };
+
+    using Logger = Log::Logger<Log::ConsoleLogger>;
+
+    // Default sink is created once
+    auto defaultSink = Logger::GetInstance();
+    ASSERT_NE(nullptr, defaultSink);
+    ASSERT_EQ(defaultSink, Logger::GetInstance());
+
+    Sink sink;
+    ASSERT_EQ(nullptr, Logger::SetSink(&sink));
+    ASSERT_EQ(&sink, Logger::GetInstance());
+
+    {
+        Log::LocalLine line;
+        line.stream() << "value " << 42;
+        Logger::GetInstance()->writeLog("dsm", Log::eInfo, line.stream().view());
+    }
+    ASSERT_EQ(1u, sink.records.size());
+    ASSERT_EQ("dsm - Info - value 42", sink.records.front());
+
+    {
+        // Records are truncated rather than allocating
+        Log::LocalLine longLine;
+        longLine.stream() << std::string(2 * Log::LineBuffer::Capacity, 'x');
+        ASSERT_EQ(Log::LineBuffer::Capacity, longLine.stream().view().size());
+    }
+
+    ASSERT_EQ(&sink, Logger::SetSink(nullptr));
+    ASSERT_EQ(defaultSink, Logger::GetInstance());
+}
+
+struct LoggingArgument
+{
+    int value;
+};
+
+static std::ostream& operator<<(std::ostream& os, const LoggingArgument& arg)
+{
+    // Formats a record of its own while the outer one is being formatted
+    Log::LocalLine inner;
+    inner.stream() << "inner " << arg.value;
+    Log::Logger<Log::ConsoleLogger>::GetInstance()->writeLog("dsm", Log::eDebug, inner.stream().view());
+    return os << arg.value;
+}
+
+TEST_F(DsmFixture, test_logger_reentrant_formatting)
+{
+    struct Sink : Log::ILogger
+    {
+        std::vector<std::string> records;
+
+        void writeLog(std::string_view module, Log::LogLevel level, std::string_view msg) override
+        {
+            records.emplace_back(msg);
+        }
+    };
+
+    using Logger = Log::Logger<Log::ConsoleLogger>;
+
+    Sink sink;
+    Logger::SetSink(&sink);
+
+    {
+        Log::LocalLine outer;
+        outer.stream() << "outer " << LoggingArgument{ 1 } << " " << LoggingArgument{ 2 };
+        Logger::GetInstance()->writeLog("dsm", Log::eInfo, outer.stream().view());
+    }
+
+    Logger::SetSink(nullptr);
+
+    ASSERT_EQ((std::vector<std::string>{ "inner 1", "inner 2", "outer 1 2" }), sink.records);
+}
+
+TEST_F(DsmFixture, test_legacy_logger_sink)
+{
+    // Sink written against the former std::string interface
+    struct Sink : Log::ILogger
+    {
+        std::vector<std::string> records;
+
+        void writeLog(const std::string& module, Log::LogLevel level, const std::string& msg) override
+        {
+            records.emplace_back(module + Log::LevelToStr(level) + msg);
+        }
+    };
+
+    using Logger = Log::Logger<Log::ConsoleLogger>;
+
+    Sink sink;
+    Logger::SetSink(&sink);
+    Logger::GetInstance()->writeLog(std::string_view("dsm"), Log::eWarning, std::string_view("record"));
+    Logger::SetSink(nullptr);
+
+    ASSERT_EQ((std::vector<std::string>{ "dsm - Warning - record" }), sink.records);
+}
+
+static std::vector<std::string> ReadLines(const std::string& path)
+{
+    std::vector<std::string> lines;
+    std::ifstream file{ path };
+    for (std::string line; std::getline(file, line);) lines.push_back(line);
+    return lines;
+}
+
+TEST_F(DsmFixture, test_async_logger_drop)
+{
+    const std::string path = ::testing::TempDir() + "dsm_async_logger_drop.log";
+    constexpr std::size_t count = 1000;
+    std::uint64_t dropped = 0;
+
+    {
+        Log::AsyncLogger logger{ path, 8, Log::OverflowPolicy::Drop };
+        for (std::size_t i = 0; i < count; ++i) logger.writeLog("dsm", Log::eInfo, "record " + std::to_string(i));
+        logger.flush();
+        dropped = logger.dropped();
+        ASSERT_EQ(count, logger.written() + dropped);
+    }
+
+    auto lines = ReadLines(path);
+    ASSERT_EQ(count - dropped, lines.size());
+    for (const auto& line : lines) ASSERT_EQ(0u, line.find("dsm - Info - record "));
+}
+
+TEST_F(DsmFixture, test_async_logger_block)
+{
+    const std::string path = ::testing::TempDir() + "dsm_async_logger_block.log";
+    constexpr std::size_t count = 1000;
+
+    {
+        Log::AsyncLogger logger{ path, 2, Log::OverflowPolicy::Block };
+        for (std::size_t i = 0; i < count; ++i) logger.writeLog("dsm", Log::eWarning, "record " + std::to_string(i));
+        ASSERT_EQ(0u, logger.dropped());
+    }
+
+    auto lines = ReadLines(path);
+    ASSERT_EQ(count, lines.size());
+    for (std::size_t i = 0; i < count; ++i) ASSERT_EQ("dsm - Warning - record " + std::to_string(i), lines[i]);
+}
+
+TEST_F(DsmFixture, test_async_logger_unopened)
+{
+    const std::string path = ::testing::TempDir() + "dsm_missing_directory/dsm_async_logger.log";
+
+    ::testing::internal::CaptureStderr();
+    Log::AsyncLogger logger{ path };
+    ASSERT_NE(std::string::npos, ::testing::internal::GetCapturedStderr().find(path));
+    ASSERT_FALSE(logger.opened());
+
+    // Records going nowhere are not counted as written
+    logger.writeLog("dsm", Log::eInfo, "record");
+    logger.flush();
+    ASSERT_EQ(0u, logger.written());
+    ASSERT_EQ(0u, logger.dropped());
+}
+
+TEST_F(DsmFixture, test_binary_tracer)
+{
+    const std::string path = ::testing::TempDir() + "dsm_binary_tracer.trace";
+
+    {
+        Log::BinaryTracer tracer{ path, 2, Log::OverflowPolicy::Block };
+        auto previous = Log::Tracer<TestTracer>::SetSink(&tracer);
+
+        _sm.addState<s0, Entry>();
+        _sm.addState<s1>();
+        _sm.addTransition<s0, e1, s1>();
+        _sm.start();
+        _sm.processEvent(e1{});
+
+        Log::Tracer<TestTracer>::SetSink(previous);
+        ASSERT_EQ(0u, tracer.dropped());
+    }
+
+    Log::TraceReader reader;
+    ASSERT_TRUE(reader.load(path));
+
+    std::vector<std::string> lines;
+    for (const auto& point : reader.points())
+    {
+        // Strip the timestamp
+        const auto line = reader.format(point);
+        lines.push_back(line.substr(line.find(" us ") + 4));
+    }
+
+    const std::vector<std::string> expected{
+        "Entry state sm (region 0) event anonymous",
+        "Entry state s0 (region 0) event anonymous",
+        "Dispatch state sm (region 0) event e1",
+        "Exit state s0 (region 0) event e1",
+        "Entry state s1 (region 0) event e1"
+    };
+    ASSERT_EQ(expected, lines);
+
+    for (std::size_t i = 1; i < reader.points().size(); ++i)
+    {
+        ASSERT_LE(reader.points()[i - 1].timestamp, reader.points()[i].timestamp);
+    }
+
+    ASSERT_FALSE(reader.load(path + ".missing"));
+}
+
+TEST_F(DsmFixture, test_binary_tracer_dropped_names)
+{
+    const std::string path = ::testing::TempDir() + "dsm_binary_tracer_dropped_names.trace";
+    constexpr std::uint32_t count = 256;
+
+    {
+        Log::BinaryTracer tracer{ path, 2, Log::OverflowPolicy::Drop };
+
+        // Most name records are dropped
+        for (std::uint32_t id = 0; id < count; ++id) tracer.trace(Log::TracePoint::Entry, id, "s" + std::to_string(id), 0, Log::InvalidTraceId, "");
+        tracer.flush();
+
+        // Names dropped above are recorded again
+        for (std::uint32_t id = 0; id < count; ++id)
+        {
+            tracer.trace(Log::TracePoint::Exit, id, "s" + std::to_string(id), 0, Log::InvalidTraceId, "");
+            tracer.flush();
+        }
+    }
+
+    Log::TraceReader reader;
+    ASSERT_TRUE(reader.load(path));
+    for (std::uint32_t id = 0; id < count; ++id) ASSERT_EQ("s" + std::to_string(id), reader.stateName(id));
+}
+
+TEST_F(DsmFixture, test_binary_tracer_unopened)
+{
+    const std::string path = ::testing::TempDir() + "dsm_missing_directory/dsm_binary_tracer.trace";
+
+    ::testing::internal::CaptureStderr();
+    Log::BinaryTracer tracer{ path };
+    ASSERT_NE(std::string::npos, ::testing::internal::GetCapturedStderr().find(path));
+    ASSERT_FALSE(tracer.opened());
+}
+
+struct CountingTracer : Log::ITracer
+{
+    static inline std::size_t s_instances = 0;
+
+    CountingTracer()
+    {
+        ++s_instances;
+    }
+
+    void trace(Log::TracePoint point, std::uint32_t stateId, std::string_view stateName, int region, std::uint32_t eventId, std::string_view eventName) override {}
+};
+
+TEST_F(DsmFixture, test_tracer_default_sink_created_lazily)
+{
+    using Tracer = Log::Tracer<CountingTracer>;
+
+    TestTracer sink;
+    ASSERT_EQ(nullptr, Tracer::SetSink(&sink));
+    ASSERT_EQ(&sink, Tracer::GetInstance());
+    ASSERT_EQ(&sink, Tracer::SetSink(nullptr));
+    ASSERT_EQ(0u, CountingTracer::s_instances);
+
+    // Created on first use only
+    auto defaultSink = Tracer::GetInstance();
+    ASSERT_EQ(1u, CountingTracer::s_instances);
+    ASSERT_EQ(defaultSink, Tracer::GetInstance());
+    ASSERT_EQ(1u, CountingTracer::s_instances);
 }
 
 TEST_F(DsmFixture, test_add_transition_from_unknown_src_state)
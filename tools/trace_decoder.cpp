@@ -0,0 +1,29 @@
+#include "dsm/binary_tracer.hpp"
+
+#include <cstdio>
+
+/**
+ * Renders a binary trace file written by Log::BinaryTracer as text, one trace point per line
+ */
+int main(int argc, char** argv)
+{
+    if (argc != 2)
+    {
+        std::fprintf(stderr, "Usage: %s <trace file>\n", argv[0]);
+        return 2;
+    }
+
+    Log::TraceReader reader;
+    if (false == reader.load(argv[1]))
+    {
+        std::fprintf(stderr, "Failed to load trace file '%s'\n", argv[1]);
+        return 1;
+    }
+
+    for (const auto& point : reader.points())
+    {
+        std::printf("%s\n", reader.format(point).c_str());
+    }
+
+    return 0;
+}